@@ -89,7 +89,7 @@ def myMutateGaussian(individual, mu, sigma, indpb, normalizing_functions = None)
     return individual,   
 
 def myEaSimple(population, toolbox, cxpb, mutpb, ngen, stats=None,
-             halloffame=None, verbose=__debug__):
+             halloffame=None, verbose=__debug__, checkpoint=None, start_gen=1):
     """This algorithm reproduce the simplest evolutionary algorithm as
     presented in chapter 7 of [Back2000]_.
     :param population: A list of individuals.
@@ -103,6 +103,10 @@ def myEaSimple(population, toolbox, cxpb, mutpb, ngen, stats=None,
     :param halloffame: A :class:`~deap.tools.HallOfFame` object that will
                        contain the best individuals, optional.
     :param verbose: Whether or not to log the statistics.
+    :param checkpoint: A function called as ``checkpoint(gen, population, halloffame)``
+                       at the end of every generation, optional.
+    :param start_gen: The generation to start from, larger than one when resuming
+                      from a checkpoint.
     :returns: The final population
     :returns: A class:`~deap.tools.Logbook` with the statistics of the
               evolution
@@ -165,7 +169,7 @@ def myEaSimple(population, toolbox, cxpb, mutpb, ngen, stats=None,
         print logbook.stream
 
     # Begin the generational process
-    for gen in range(1, ngen + 1):
+    for gen in range(start_gen, ngen + 1):
 
         # Start timing this generation
         start_time = time.clock()
@@ -198,11 +202,15 @@ def myEaSimple(population, toolbox, cxpb, mutpb, ngen, stats=None,
         if verbose:
             print logbook.stream
 
+        # Store the state of the evolution so that it can be resumed
+        if checkpoint is not None:
+            checkpoint(gen, population, halloffame)
+
     return population, logbook     
 
 def minimize_deap(f, bounds, Nindividuals = 5000, Ngenerations = 20, Nhof = 50, 
                   generator_functions = None, normalizing_functions = None,
-                  sigma = None, **kwargs):
+                  sigma = None, population = None, halloffame = None, start_gen = 1, checkpoint = None, **kwargs):
     """
     Parameters
     ----------
@@ -222,6 +230,17 @@ def minimize_deap(f, bounds, Nindividuals = 5000, Ngenerations = 20, Nhof = 50,
         for some blending)
     sigma : Constant standard deviation for all coefficients in individual or 
         :term:`python:sequence` of standard deviations for the gaussian addition mutation.
+    population : list of dicts
+        The starting population (for instance loaded from a checkpoint), each
+        individual given as ``dict(c=coefficients, fitness=fitness values)``; the
+        fitness may be omitted, in which case it is evaluated again. If not
+        provided, a random population is generated
+    halloffame : list of dicts
+        The hall of fame to start from, in the same form as the population
+    start_gen : int
+        The first generation to run, larger than one when resuming from a checkpoint
+    checkpoint : function
+        Called as ``checkpoint(gen, population, halloffame)`` after every generation
     """
     N = len(bounds)
 
@@ -264,12 +283,27 @@ def minimize_deap(f, bounds, Nindividuals = 5000, Ngenerations = 20, Nhof = 50,
     toolbox.register("mutate", myMutateGaussian, mu = 0, sigma = sigma, indpb=1.0, normalizing_functions = normalizing_functions)
     toolbox.register("select", tools.selTournament, tournsize=3) # The greater the tournament size, the greater the selection pressure 
     
+    def restore(entries):
+        """ Rebuild individuals, with their fitness if it is known, from the form in which they are checkpointed """
+        inds = []
+        for entry in entries:
+            ind = creator.Individual(entry['c'])
+            if entry.get('fitness') is not None:
+                ind.fitness.values = tuple(entry['fitness'])
+            inds.append(ind)
+        return inds
+
     hof = tools.HallOfFame(Nhof)
+    if halloffame is not None:
+        hof.update(restore(halloffame))
     stats = tools.Statistics(lambda ind: ind.fitness.values)
     stats.register("min(fitness)", np.min)
     stats.register("stddev(fitness)", np.std)
     
-    pop = toolbox.population(n=Nindividuals)
+    if population is None:
+        pop = toolbox.population(n=Nindividuals)
+    else:
+        pop = restore(population)
     pop, log = myEaSimple(pop, 
                           toolbox, 
                           cxpb=0.5, # Crossover probability
@@ -277,6 +311,8 @@ def minimize_deap(f, bounds, Nindividuals = 5000, Ngenerations = 20, Nhof = 50,
                           ngen=Ngenerations, 
                           stats=stats, 
                           halloffame=hof, 
-                          verbose=True)
+                          verbose=True,
+                          checkpoint=checkpoint,
+                          start_gen=start_gen)
     best = max(pop, key=attrgetter("fitness"))
     return dict(best = best, pop = pop, hof = hof)
\ No newline at end of file
@@ -2,7 +2,7 @@
 Simple script to do the optimization
 """
 from __future__ import print_function
-import time, json, random
+import time, json, random, os
 
 
 # Munge the python path to make it load our module we compiled using pybind11
@@ -205,9 +205,30 @@ start_time = time.clock()
 
 print('About to fit', len(bounds), 'coefficients')
 
+# Checkpoint the fitter, the population, the hall of fame and the state of the
+# random number generator after every generation. Run with --resume to pick an
+# interrupted optimization back up from the last generation; otherwise a
+# checkpoint left over from an earlier run is discarded
+checkpoint_file = 'deap_checkpoint.bin'
+def to_entries(inds):
+    return [dict(c=list(ind), fitness=list(ind.fitness.values) if ind.fitness.valid else None) for ind in inds]
+def save_deap_checkpoint(gen, pop, hof):
+    state = dict(gen=gen, pop=to_entries(pop), hof=to_entries(hof), random_state=random.getstate())
+    cfc.save_checkpoint(checkpoint_file, json.dumps(state))
+population, halloffame, start_gen = None, None, 1
+if '--resume' in sys.argv and os.path.exists(checkpoint_file):
+    state = json.loads(cfc.load_checkpoint(checkpoint_file))
+    population, halloffame, start_gen = state['pop'], state['hof'], state['gen'] + 1
+    version, internal_state, gauss_next = state['random_state']
+    random.setstate((version, tuple(internal_state), gauss_next))
+    print('Resuming from generation', state['gen'])
+elif os.path.exists(checkpoint_file):
+    os.remove(checkpoint_file)
+
 # Minimize using deap (global optimization using evolutionary optimization)
 results = minimize_deap(objective, bounds, Nindividuals= 50*len(bounds), Ngenerations=40, Nhof = 50, args=(cfc, Nterms), 
-                        generator_functions=generator_functions, normalizing_functions=normalizing_functions, sigma=sigma)
+                        generator_functions=generator_functions, normalizing_functions=normalizing_functions, sigma=sigma,
+                        population=population, halloffame=halloffame, start_gen=start_gen, checkpoint=save_deap_checkpoint)
 
 # Print elapsed time for this first global optimization
 print((time.clock()-start_time)/3600.0, 'h for deap optimization')
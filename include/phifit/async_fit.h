@@ -0,0 +1,93 @@
+#ifndef PHIFIT_ASYNC_FIT_H
+#define PHIFIT_ASYNC_FIT_H
+
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+
+#include "phifit/optimizers.h"
+
+/// Where an asynchronous fit has got to
+enum FitStatus {
+    FIT_QUEUED = 0, ///< Waiting for threads from the thread budget
+    FIT_RUNNING, ///< The optimizer is running
+    FIT_CONVERGED, ///< Finished; a convergence criterion was satisfied
+    FIT_STOPPED, ///< Finished; the maximum number of iterations was reached
+    FIT_CANCELLED, ///< Finished; cancelled before it converged
+    FIT_FAILED ///< Finished; the fit threw an exception (rethrown by wait())
+};
+
+/// Get a short name for the status
+const char *fit_status_name(FitStatus status);
+
+/// A snapshot of the progress of an asynchronous fit
+struct FitProgress {
+    FitStatus status;
+    std::size_t iter, ///< The number of iterations taken so far
+                Nthreads; ///< The number of threads granted by the thread budget (0 while queued)
+    double SSE, ///< The sum of squares at the best coefficients so far
+           mu, ///< The damping parameter
+           elapsed_sec; ///< Wall time since the fit was started, including time spent queued
+    std::string error; ///< The error message if the fit failed
+    FitProgress() : status(FIT_QUEUED), iter(0), Nthreads(0), SSE(0), mu(0), elapsed_sec(0) {};
+};
+
+/**
+ A fit running on a thread of its own; returned by CoeffFitClass::run_async. The fitter that started it must 
+ not be used until the fit has finished. Destroying the handle cancels the fit and waits for it to finish.
+ */
+class FitHandle {
+public:
+    /// The fit itself, run on the thread of the handle
+    typedef std::function<void(FitHandle &)> Body;
+
+    FitHandle();
+    ~FitHandle();
+    /// Start body on the thread of the handle; can only be called once
+    void start(const Body &body);
+    /// A snapshot of the progress
+    FitProgress progress();
+    /// Ask the fit to stop; it stops at the end of the current iteration (a fit that is still queued stops waiting for its threads)
+    void cancel() { m_cancel = true; }
+    /// True once cancel() has been called
+    bool cancelled() const { return m_cancel; }
+    /// The flag that the optimizer polls to know if it should stop
+    const std::atomic<bool> *cancel_flag() const { return &m_cancel; }
+    /// True once the fit has finished
+    bool done();
+    /**
+     Wait for the fit to finish, or until timeout_sec has passed if it is not negative. Returns true if the fit has 
+     finished; the exception thrown by the fit, if there was one, is rethrown here
+     */
+    bool wait(double timeout_sec = -1);
+    /// The coefficients with the smallest sum of squares so far
+    std::vector<double> best_coefficients();
+
+    /// Called from the fit once it has been granted its threads
+    void set_running(std::size_t Nthreads);
+    /// Called from the fit after every iteration of the optimizer
+    void update(const PhiFitLMState &state);
+    /// Called from the fit when it is finished with the final coefficients
+    void finish(FitStatus status, const std::vector<double> &c);
+private:
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::atomic<bool> m_cancel;
+    bool m_done;
+    FitProgress m_progress;
+    std::vector<double> m_best;
+    std::exception_ptr m_error;
+    std::chrono::high_resolution_clock::time_point m_start;
+    FitHandle(const FitHandle &);
+    FitHandle &operator=(const FitHandle &);
+};
+
+#endif
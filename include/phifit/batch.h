@@ -0,0 +1,108 @@
+#ifndef PHIFIT_BATCH_H
+#define PHIFIT_BATCH_H
+
+#include <vector>
+#include <string>
+#include <map>
+#include <memory>
+#include <mutex>
+
+#include "phifit/fitter.h"
+#include "phifit/thread_budget.h"
+
+/// One fit to be carried out by the batch driver
+struct FitJob {
+    std::string name; ///< The name of the job, used in messages and the results
+    std::vector<std::string> data_paths; ///< The data files; their "data" arrays are concatenated and "about" is taken from the first one
+    std::vector<std::string> names; ///< If not empty, replaces the names of the fluids given in the data files
+    std::string departure_path, ///< File containing the departure function in the fit0 format (optional)
+                departure_name; ///< Name (or alias) of a departure function known to CoolProp (optional)
+    bool has_Fij; ///< True if Fij is to be set
+    double Fij; ///< The value of Fij
+    std::vector<std::vector<double> > c0; ///< The starting coefficients; a fit is carried out from each one, and the best is kept
+    short Nthreads; ///< The number of threads for the fit
+    std::string output_path; ///< The file that the results are written to
+    FitJob() : has_Fij(false), Fij(1.0), Nthreads(1) {};
+    /// The key that identifies the dataset; jobs with the same key share the same data
+    std::string dataset_key() const;
+};
+
+/// The contents of a job manifest
+struct FitManifest {
+    std::size_t Nthreads; ///< The total number of threads that all the running jobs may use together (0 for the number of hardware threads)
+    std::vector<FitJob> jobs;
+    FitManifest() : Nthreads(0) {};
+};
+
+/**
+ Read a job manifest; paths in the manifest are relative to the directory of the manifest. The manifest takes the form:
+
+     {
+        "max threads": 8,
+        "jobs": [
+            {
+                "name": "ammonia-water",
+                "data": ["ammonia-water/PTXY-Smolen.json", "ammonia-water/PVT-Muromachi.json"],
+                "names": ["Ammonia(Hui)", "Water"],
+                "departure": "fit0.json",
+                "Fij": 1.0,
+                "c0": [[0.9, 0.9, 1.05, 1.3], [1, 1, 1, 1]],
+                "threads": 2,
+                "output": "results/ammonia-water.json"
+            }
+        ]
+     }
+
+ Instead of "departure", "departure name" can be given to use a departure function known to CoolProp;
+ "c0" can also be given as a single array of coefficients
+ */
+FitManifest load_manifest(const std::string &path);
+
+/// Combine the data files into one JSON string that can be passed to CoeffFitClass
+std::string merge_datasets(const std::vector<std::string> &data_paths, const std::vector<std::string> &names);
+
+/// The loaded datasets, and the fitters built from them that are not in use, so that jobs with the same data can share them
+class DatasetCache {
+private:
+    std::mutex m_mutex;
+    std::map<std::string, std::shared_ptr<const std::string> > m_data;
+    std::map<std::string, std::vector<std::shared_ptr<CoeffFitClass> > > m_idle;
+public:
+    /// The merged data of the job, loaded on first use
+    std::shared_ptr<const std::string> data(const FitJob &job);
+    /**
+     Get a fitter for the job; an idle fitter of the same dataset is handed out if there is one and the job 
+     sets its own departure function (otherwise the departure function left by the previous job would be used)
+     */
+    std::shared_ptr<CoeffFitClass> checkout(const FitJob &job);
+    /**
+     Return a fitter to the cache once the job is finished with it; what the job may have left behind (quarantined 
+     and disabled points, the memo, the telemetry) is reset first, so that the next job starts as from a fresh fitter
+     */
+    void checkin(const FitJob &job, const std::shared_ptr<CoeffFitClass> &CFC);
+};
+
+/// A fitter checked out of a DatasetCache for a job; it is checked back in when the lease goes out of scope, also if the job throws
+class FitterLease {
+private:
+    DatasetCache &m_cache;
+    const FitJob &m_job;
+    std::shared_ptr<CoeffFitClass> m_CFC;
+    FitterLease(const FitterLease &);
+    FitterLease &operator=(const FitterLease &);
+public:
+    FitterLease(DatasetCache &cache, const FitJob &job) : m_cache(cache), m_job(job), m_CFC(cache.checkout(job)) {};
+    ~FitterLease();
+    CoeffFitClass *operator->() { return m_CFC.get(); }
+};
+
+/// Carry out a job (blocking) and write its results file; returns false if the job failed
+bool run_fit_job(const FitJob &job, DatasetCache &cache);
+
+/**
+ Carry out all the jobs, with as many running concurrently as the thread budget allows; each job holds 
+ its number of threads from the budget while it runs. Returns the number of jobs that failed.
+ */
+std::size_t run_fit_jobs(const std::vector<FitJob> &jobs, ThreadBudget &budget);
+
+#endif
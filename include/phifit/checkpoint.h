@@ -0,0 +1,30 @@
+#ifndef PHIFIT_CHECKPOINT_H
+#define PHIFIT_CHECKPOINT_H
+
+#include <vector>
+#include <string>
+#include <cstddef>
+
+#include "phifit/optimizers.h"
+
+/// Everything that is needed to pick a fit back up where it was left off
+struct FitCheckpoint {
+    std::size_t Noutputs; ///< The number of outputs in the evaluator that wrote the checkpoint
+    std::vector<double> c; ///< The current coefficients
+    std::string departure_JSON; ///< The departure function in the form accepted by CoeffFitClass::setup (empty if not a phifit departure function)
+    std::string departure_name; ///< The name passed to CoeffFitClass::set_departure_function_by_name (empty if it was not set by name)
+    double Fij; ///< The weight of the departure function
+    std::vector<double> rhoL, ///< The cached liquid densities of the PTXY outputs (mol/m^3)
+                        rhoV; ///< The cached vapor densities of the PTXY outputs (mol/m^3)
+    PhiFitLMState LM; ///< The state of the Levenberg-Marquardt iteration
+    std::string user_data; ///< Free-form data stored by the driver (for instance a DEAP population in JSON form)
+    FitCheckpoint() : Noutputs(0), Fij(0) {};
+};
+
+/// Write the checkpoint to a compact binary file; the file is written to a temporary file first and then moved into place
+void save_checkpoint(const std::string &path, const FitCheckpoint &checkpoint);
+
+/// Load a checkpoint written by save_checkpoint
+FitCheckpoint load_checkpoint(const std::string &path);
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef PHIFIT_CROSS_VALIDATION_H
+#define PHIFIT_CROSS_VALIDATION_H
+
+#include <vector>
+#include <string>
+#include <cstddef>
+
+/// Options for k-fold cross-validation
+struct CrossValidationOptions {
+    std::size_t k; ///< The number of folds
+    unsigned long long seed; ///< Seed of the shuffle that deals the points into folds
+    bool stratify; ///< If true, the points of each BibTeX source are spread evenly over the folds
+    short Nthreads; ///< Number of threads used for each residual pass (1 for serial)
+    std::vector<double> c0; ///< The initial guess of the coefficients of every fold
+    CrossValidationOptions() : k(5), seed(0), stratify(true), Nthreads(1) {};
+};
+
+/// The fit of one fold: trained on all the other folds, and tested on this one
+struct FoldResult {
+    std::size_t fold, ///< The index of the fold that was held out
+                Ntrain, ///< Number of residuals the fit was trained on
+                Nheld_out, ///< Number of residuals held out
+                iter; ///< Number of iterations of the optimizer
+    double SSE_train, ///< Sum of squares of the training points at the fitted coefficients
+           SSE_held_out; ///< Sum of squares of the held-out points at the fitted coefficients
+    bool converged; ///< True if the optimizer converged
+    std::vector<double> c; ///< The fitted coefficients
+    FoldResult() : fold(0), Ntrain(0), Nheld_out(0), iter(0), SSE_train(0), SSE_held_out(0), converged(false) {};
+};
+
+/// The result of k-fold cross-validation
+struct CrossValidationResult {
+    std::vector<FoldResult> folds;
+    std::vector<std::size_t> assignment; ///< The fold of each output (the outputs of a data point are in the same fold)
+    double elapsed_sec;
+    CrossValidationResult() : elapsed_sec(0) {};
+    /// The held-out sum of squares per held-out point, over all the folds
+    double held_out_MSE() const;
+    /// The training sum of squares per training point, over all the folds
+    double train_MSE() const;
+};
+
+/**
+ Deal the points into k folds. With stratification, the points of each source are shuffled and dealt out in turn, 
+ carrying on from where the previous source stopped, so that every source is spread over the folds and the fold 
+ sizes differ by at most one; otherwise all the points are shuffled together. The result depends only on the 
+ sources and the seed.
+
+ @param sources The BibTeX key of each point
+ @param k The number of folds
+ @param seed The seed of the shuffle
+ @param stratify If true, stratify by source
+ @returns The fold of each point
+ */
+std::vector<std::size_t> assign_folds(const std::vector<std::string> &sources, std::size_t k, unsigned long long seed, bool stratify = true);
+
+/// The result of cross-validation in JSON form
+std::string cross_validation_to_JSON(const CrossValidationResult &result);
+
+#endif
@@ -2,6 +2,9 @@
 #define DATA_GENERATION_H
 
 #include <string>
+#include <vector>
+#include <ostream>
+#include <cstddef>
 
 /// Options for the data generation script
 struct gen_JSON_data_options {
@@ -12,4 +15,43 @@ struct gen_JSON_data_options {
 /// Generate some data for fitting purposes
 std::string gen_JSON_data(const std::string &backend, const std::string &names, gen_JSON_data_options options = gen_JSON_data_options());
 
+/// A grid of N uniformly spaced values from min to max (inclusive)
+std::vector<double> linspace(double min, double max, std::size_t N);
+
+/// Options for the scalable data generator
+struct gen_data_options {
+    std::string backend, ///< The backend used to generate the data
+                names, ///< The fluids, separated by '&'
+                BibTeX; ///< The BibTeX key given to every point
+    std::vector<double> T, ///< Grid of temperatures (K)
+                        x0, ///< Grid of mole fractions of the first component
+                        p; ///< Grid of pressures (Pa); only used for the PRhoT points
+    bool PTXY, ///< Generate PTXY points at the bubble point of each (T, x0)
+         PRhoT, ///< Generate PRhoT points from a PT flash at each (T, x0, p)
+         critical, ///< Generate a critical point for each x0
+         density_guesses; ///< Give the PTXY points the densities of the phases as guess values (otherwise -1)
+    double sigma_T, ///< Standard deviation of the noise added to the temperature (K)
+           sigma_p, ///< Relative standard deviation of the noise added to the pressure
+           sigma_x, ///< Standard deviation of the noise added to the mole fractions
+           sigma_rho; ///< Relative standard deviation of the noise added to the density
+    unsigned long long seed; ///< Seed of the noise; the noise of each point depends only on the seed and the index of the point
+    short Nthreads; ///< The number of threads used to generate the data
+    gen_data_options() : backend("HEOS"), BibTeX("synthetic"), T(linspace(200, 240, 3)), x0(linspace(0.1, 0.9, 3)),
+        p(linspace(1e6, 5e6, 3)), PTXY(true), PRhoT(false), critical(false), density_guesses(false),
+        sigma_T(0), sigma_p(0), sigma_x(0), sigma_rho(0), seed(0), Nthreads(1) {};
+};
+
+/// Read the generator options from a JSON string; see the implementation for the keys
+gen_data_options gen_data_options_from_JSON(const std::string &JSON_string);
+
+/**
+ Generate data and stream it in JSON form (one point per line) without building a DOM in memory; this is 
+ the format read by CoeffFitClass.  The points are generated in parallel but are always written in the same
+ order, and states that cannot be calculated are skipped.  Returns the number of points written.
+ */
+std::size_t gen_data(const gen_data_options &options, std::ostream &os);
+
+/// Generate data and return it as a JSON string
+std::string gen_data(const gen_data_options &options);
+
 #endif
\ No newline at end of file
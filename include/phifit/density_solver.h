@@ -0,0 +1,73 @@
+#ifndef PHIFIT_DENSITY_SOLVER_H
+#define PHIFIT_DENSITY_SOLVER_H
+
+#include <vector>
+#include <functional>
+#include <cstddef>
+
+/// A batch of states whose densities are to be found from their temperature and pressure
+struct PTDensityBatch {
+    std::vector<double> T, ///< Temperatures (K)
+                        p, ///< Pressures (Pa)
+                        rho, ///< Molar densities (mol/m^3); the guesses going in, the solutions coming out
+                        rho_split; ///< Densities that separate the vapor-like from the liquid-like roots (mol/m^3), or 0 if the phase is not checked
+    std::vector<unsigned char> converged; ///< Whether the solver converged for each state
+    std::vector<std::size_t> Niter; ///< The number of iterations taken for each state
+    /// Number of states in the batch
+    std::size_t size() const { return T.size(); }
+    /**
+     Add a state to the batch
+     @param rho_split If positive, the solution must be on the same side of this density as the guess, so that a 
+     liquid guess does not end up on the vapor root or the other way around
+     */
+    void add(double T, double p, double rho_guess, double rho_split = 0) {
+        this->T.push_back(T); this->p.push_back(p); this->rho.push_back(rho_guess); this->rho_split.push_back(rho_split);
+        converged.push_back(0); Niter.push_back(0);
+    }
+    void clear() { T.clear(); p.clear(); rho.clear(); rho_split.clear(); converged.clear(); Niter.clear(); }
+};
+
+/// Options for the batched density solver
+struct PTDensitySolverOptions {
+    double rtol; ///< Convergence threshold on the relative error in pressure or the relative density step
+    double max_step; ///< The largest relative change in density allowed in one step
+    std::size_t Nmax; ///< Maximum number of iterations
+    PTDensitySolverOptions() : rtol(1e-12), max_step(0.5), Nmax(30) {};
+};
+
+/**
+ How loosely the densities are solved for while an optimizer is far from the optimum. The tolerance follows the 
+ progress of the optimizer: the relative change of the sum of squares or of the coefficients in its last step.
+ Off by default; a fit then solves for the densities to full precision throughout.
+ */
+struct AdaptiveToleranceOptions {
+    bool enabled; ///< If false, the densities are always solved for to full precision
+    double rtol_loose, ///< The loosest tolerance, used until the optimizer has made a step
+           safety; ///< The tolerance is this fraction of the progress, so that the error in the residuals stays well below the change a step makes
+    std::size_t Nmax_loose, ///< The iteration budget at the loosest tolerance; it grows to the full budget as the tolerance tightens
+                Nmax_polish; ///< Number of iterations allowed for the final pass at full precision
+    AdaptiveToleranceOptions() : enabled(false), rtol_loose(1e-6), safety(1e-2), Nmax_loose(10), Nmax_polish(10) {};
+    /**
+     The solver options for the given progress, rounded down to a whole decade of the tolerance so that they only 
+     change now and then; the options are never looser than rtol_loose nor tighter than full
+     */
+    PTDensitySolverOptions options(double progress, const PTDensitySolverOptions &full) const;
+};
+
+/**
+ Evaluate the pressure and dp/drho|T for the states whose indices are in active, at the densities in rho; the 
+ results are written at the same indices of p and dpdrho
+ */
+typedef std::function<void(const std::vector<std::size_t> &active, const std::vector<double> &rho, std::vector<double> &p, std::vector<double> &dpdrho)> PTDensityEvaluator;
+
+/**
+ Solve p(T, rho) = p for all the states of the batch at once with Newton's method; every iteration evaluates
+ all the states that are still active in one call, and states drop out of the active set as they converge or fail.
+ States that fail (non-positive dp/drho, non-finite values, a density on the other side of rho_split from the 
+ guess, or too many iterations) are left with converged = 0 so that the caller can fall back to another route. 
+ A converged density is within rtol of one at which dp/drho > 0 was checked. Returns the number of states that 
+ converged.
+ */
+std::size_t solve_PT_densities(PTDensityBatch &batch, const PTDensityEvaluator &eval, const PTDensitySolverOptions &opts = PTDensitySolverOptions());
+
+#endif
@@ -14,6 +14,8 @@ private:
 public:
     PhiFitDepartureFunction(rapidjson::Value &JSON_data) ;
     void update(double tau, double delta);
+    /// Evaluate the departure function and its derivatives into derivs without touching the state of this instance, so it can be called from several threads at once
+    void evaluate(double tau, double delta, CoolProp::HelmholtzDerivatives &derivs) const;
     rapidjson::Value to_JSON(rapidjson::Document &doc);
     void update_coeffs(const Coefficients &coeffs);
 };
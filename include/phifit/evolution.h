@@ -0,0 +1,90 @@
+#ifndef PHIFIT_EVOLUTION_H
+#define PHIFIT_EVOLUTION_H
+
+#include <vector>
+#include <string>
+#include <functional>
+#include <cstddef>
+
+#include "phifit/fitter.h"
+
+/// How one gene of an individual is generated and varied
+struct GeneSpec {
+    double lower, upper, ///< Bounds used to generate the gene, and to clamp integer genes
+           sigma; ///< Standard deviation of the Gaussian mutation
+    bool integer; ///< If true, the gene is generated with randint, and blended and mutated values are rounded and clamped to the bounds
+    GeneSpec(double lower = 0, double upper = 1, double sigma = 0.5, bool integer = false) : lower(lower), upper(upper), sigma(sigma), integer(integer) {};
+    /// The normalizing function of deap_optimize.py: identity, or round and clamp to the bounds for integer genes
+    double normalize(double x) const;
+};
+
+/**
+ The layout of an individual, as in fitter_py.py: the four parameters betaT, gammaT, betaV, gammaV, then n, t and 
+ d of each of the Nterms terms, then ldelta, cdelta, ltau and ctau, each split into u_dims[i] values for term i
+ */
+struct IndividualLayout {
+    std::size_t Nterms;
+    std::vector<std::size_t> u_dims;
+    IndividualLayout() : Nterms(0) {};
+    /// The number of genes of an individual
+    std::size_t size() const;
+    /// Split an individual into the binary interaction parameters and the coefficients of the departure function
+    void decode(const std::vector<double> &x, std::vector<double> &betagamma, Coefficients &coeffs) const;
+};
+
+/// One individual and its fitness (the sum of squares; lower is better)
+struct EvolutionIndividual {
+    std::vector<double> x;
+    double fitness;
+    bool valid; ///< False if the individual has been varied since it was last evaluated
+    EvolutionIndividual() : fitness(0), valid(false) {};
+};
+
+/// The statistics of one generation
+struct EvolutionGeneration {
+    std::size_t gen, Nevals;
+    double min_fitness, stddev_fitness, elapsed_sec;
+};
+
+/// Options for the evolutionary optimizer; the defaults are those of minimize_deap
+struct EvolutionOptions {
+    IndividualLayout layout;
+    std::vector<GeneSpec> genes; ///< One per gene of the individual
+    std::size_t Nindividuals, Ngenerations, Nhof, tournsize;
+    double cxpb, ///< Probability that each pair of offspring is blended
+           mutpb, ///< Probability that each offspring is mutated
+           alpha, ///< Extent of the blend beyond the parents
+           mu; ///< Mean of the Gaussian mutation
+    double nan_fitness, ///< Fitness given to an individual whose sum of squares is not a number
+           failed_fitness; ///< Fitness given to an individual whose evaluation threw
+    std::size_t Nworkers; ///< Number of individuals evaluated at once, each by its own clone of the fitter
+    short Nthreads; ///< Number of threads used for each evaluation (1 for serial)
+    unsigned long long seed; ///< Seed of the random number generator; a run is reproducible for a given seed
+    std::vector<std::vector<double> > population; ///< The starting population; generated at random if empty
+    std::function<void(const EvolutionGeneration &, const std::vector<EvolutionIndividual> &)> callback; ///< Called after every generation, optional
+    EvolutionOptions() : Nindividuals(5000), Ngenerations(20), Nhof(50), tournsize(3), cxpb(0.5), mutpb(0.3), alpha(0), mu(0),
+        nan_fitness(1e8), failed_fitness(1e10), Nworkers(1), Nthreads(1), seed(0) {};
+};
+
+/// The outcome of the evolutionary optimization
+struct EvolutionResult {
+    std::vector<EvolutionIndividual> population, ///< The final population
+                                     hall_of_fame; ///< The best distinct individuals seen, best first
+    std::vector<EvolutionGeneration> log;
+};
+
+/**
+ The evolutionary algorithm of myEaSimple in deap_optimize.py: tournament selection, blend crossover and 
+ Gaussian mutation (both with the normalizing functions of the genes), replacing the whole population every 
+ generation. The individuals of a generation that need evaluating are shared out between Nworkers clones of 
+ the fitter. Quarantine is turned off in the clones so that the fitness of an individual does not depend on 
+ which clone evaluated it, or on what it evaluated before. With adaptive tolerances (see 
+ CoeffFitClass::set_adaptive_tolerance), the densities are solved for loosely while the best fitness falls 
+ quickly, and the hall of fame is evaluated again at full precision at the end.
+
+ @param cfc The fitter, with its data and departure function set up; it is not modified
+ @param o The options
+ */
+EvolutionResult evolve(CoeffFitClass &cfc, const EvolutionOptions &o);
+
+#endif
@@ -3,35 +3,231 @@
 
 #include <vector>
 #include <string>
+#include <memory>
+#include <map>
+#include <cstdint>
 
 // Includes from NISTfit
 #include "NISTfit/abc.h"
 
 // Includes from phifit
 #include "phifit/data_structures.h"
+#include "phifit/optimizers.h"
+#include "phifit/telemetry.h"
+#include "phifit/worker_pool.h"
+#include "phifit/process_shards.h"
+#include "phifit/quarantine.h"
+#include "phifit/memo.h"
+#include "phifit/async_fit.h"
+#include "phifit/thread_budget.h"
+#include "phifit/validation.h"
+#include "phifit/cross_validation.h"
+#include "phifit/schedule.h"
+#include "phifit/density_solver.h"
+#include "phifit/prepare.h"
+
+namespace CoolProp { class HelmholtzEOSMixtureBackend; }
+struct FitCheckpoint;
 
 /// The function that actually does the fitting
 double simplefit(const std::string &JSON_data_string, const std::string &JSON_fit0_string, bool threading, short Nthreads, std::vector<double> &c0, std::vector<double> &cfinal);
 
+/// Wall time spent in each phase of fitting, accumulated over residual passes
+struct PhiFitPhaseTimes {
+    std::size_t Npasses; ///< Number of residual passes
+    double install_sec, ///< Installing the coefficients in the evaluator
+           evaluate_sec, ///< Evaluating the residuals and their derivatives (wall time of the parallel region)
+           assemble_sec, ///< Assembling the Jacobian matrix and the normal equations
+           solve_sec; ///< Solving the damped normal equations
+    std::vector<double> busy_sec, ///< Time each thread spent evaluating residuals
+                        idle_sec; ///< Time each thread spent waiting for the other threads to finish
+    PhiFitPhaseTimes() : Npasses(0), install_sec(0), evaluate_sec(0), assemble_sec(0), solve_sec(0) {};
+    /// Add the timing of a residual pass where thread i was busy for busy[i] of the wall time
+    void add_pass(double wall, const std::vector<double> &busy);
+};
+
+/// One entry of the optimizer trace: what the optimizer did in an iteration, and the time it took
+struct PhiFitTraceEntry : public PhiFitLMIteration {
+    double residual_sec, ///< Installing the coefficients and evaluating the residuals and their derivatives
+           jacobian_sec, ///< Assembling the Jacobian matrix and the normal equations
+           solve_sec; ///< Solving the damped normal equations
+    PhiFitTraceEntry() : residual_sec(0), jacobian_sec(0), solve_sec(0) {};
+};
+
 class CoeffFitClass
 {
 public:
     std::shared_ptr<NISTfit::AbstractEvaluator> m_eval;
     std::vector<double> m_cfinal;
     double m_elap_sec;
+    PhiFitLMState m_LM_state; ///< The state of the last (or current) Levenberg-Marquardt iteration
+    std::string m_checkpoint_path; ///< The file that checkpoints are written to while running
+    std::size_t m_checkpoint_every; ///< A checkpoint is written every this many iterations (0 for never)
+    PhiFitPhaseTimes m_phase_times; ///< Time spent in each phase of the last run
+    std::vector<PhiFitTraceEntry> m_trace; ///< One entry per iteration of the last run (and of any resumption of it)
+    std::shared_ptr<WorkerPool> m_pool; ///< The workers of evaluate_parallel; kept from one pass to the next, and rebuilt if the number of threads changes
+    bool m_pin_threads; ///< If true, the workers of the pool are pinned to CPUs
+    std::size_t m_Nprocesses; ///< If greater than zero, the optimizer evaluates the residuals in this many worker processes
+    std::shared_ptr<ProcessShards> m_shards; ///< The worker processes; forked on first use, and dropped whenever the model changes
+    bool m_streaming_normal_equations; ///< If true, the optimizer sums J^T*J and J^T*r as the residuals are evaluated rather than forming the Jacobian matrix
+    std::string m_data_JSON; ///< The data this instance was constructed from (the prepared version, if one was found in the cache)
+    std::string m_departure_name; ///< The name of the departure function, if it was set by name
+    std::shared_ptr<FitnessMemo> m_memo; ///< The sums of squares of candidates already evaluated; each clone has its own
 
-    /// Instantiator
-    CoeffFitClass(const std::string &JSON_data_string);
+    /** Instantiator
+     @param JSON_data_string The data in JSON form
+     @param slim_PRhoT If true, the PRhoT points share one mixture model and are evaluated directly from it, rather than each owning a full AbstractState
+     */
+    CoeffFitClass(const std::string &JSON_data_string, bool slim_PRhoT = true);
+    /** Instantiator that uses the prepared version of the dataset (validated, with density guesses) if there is one 
+     in the cache of the given options, which must name the same reference model that the dataset was prepared with
+     @param JSON_data_string The data in JSON form
+     @param cache The cache directory and reference model to look the prepared dataset up with
+     @param slim_PRhoT If true, the PRhoT points share one mixture model and are evaluated directly from it, rather than each owning a full AbstractState
+     */
+    CoeffFitClass(const std::string &JSON_data_string, const PrepareOptions &cache, bool slim_PRhoT = true);
+    /// Cancel the fit started by run_async, if it has not finished, and wait for it
+    ~CoeffFitClass();
     /// Setup the departure function
     void setup(const std::string &JSON_fit0_string);
     /// Setup the departure function using coefficients passed as a Coefficients class instance
     void setup(const Coefficients &coeffs);
     /// Run the optimizer
     void run(bool threading, short Nthreads, const std::vector<double> &c0);
+    /**
+     Run the optimizer on a thread of its own and return at once with a handle to the fit. The fit first takes its 
+     threads (one if threading is false) from the budget, waiting until they are free, so that fits started on 
+     several instances share the budget; a fit cancelled while it waits never takes them. This instance must not be 
+     used until the fit has finished; destroying it cancels the fit and waits for it to finish.
+     @param budget The thread budget, which the fit holds on to until it has finished
+     @param callback Optional function that is called (on the thread of the fit) after every iteration
+     */
+    std::shared_ptr<FitHandle> run_async(bool threading, short Nthreads, const std::vector<double> &c0, const std::shared_ptr<ThreadBudget> &budget = ThreadBudget::global(), const PhiFitLMCallback &callback = PhiFitLMCallback());
+    /**
+     Fit to a stratified subsample of the enabled data points first, then to progressively larger subsets, each 
+     stage starting from the coefficients of the one before. The points left out of a stage are disabled rather than 
+     unloaded, so nothing is reloaded between stages. After each stage, the densities of the phases of its PTXY points 
+     become their guess values, so that the next stage starts their flashes from there. All the points that were 
+     enabled are enabled again at the end.
+     */
+    FitScheduleResult run_schedule(bool threading, short Nthreads, const std::vector<double> &c0, const FitScheduleOptions &o = FitScheduleOptions());
+    /// Resume the optimizer from the state stored in a checkpoint file; a checkpoint written before the first step starts from the coefficients stored in it
+    void resume(bool threading, short Nthreads, const std::string &path);
+    /// Write a checkpoint to the given file every N iterations of the optimizer and at the end of the run (N = 0 to disable)
+    void set_checkpointing(const std::string &path, std::size_t N);
+    /// Write the state of the fitter (coefficients, departure function, cached densities, optimizer state) to file, along with free-form user data
+    void save_checkpoint(const std::string &path, const std::string &user_data = "");
+    /// Restore the state of the fitter from a file written by save_checkpoint, and return the user data stored with it
+    std::string load_checkpoint(const std::string &path);
     /// Just evaluate the residual vector (serially), and cache values internally
     void evaluate_serial(const std::vector<double> &c0);
     /// Just evaluate the residual vector (in parallel), and cache values internally
     void evaluate_parallel(const std::vector<double> &c0, short Nthreads);
+    /** Evaluate the residuals and sum the normal equations directly from the Jacobian rows of the outputs; with threading, 
+     each worker sums its own block and the partial sums are reduced in a fixed order, so the memory needed is 
+     O(P^2) per thread rather than a dense N x P Jacobian matrix
+     */
+    void evaluate_normal_equations(const std::vector<double> &c0, bool threading, short Nthreads, PhiFitNormalEquations &ne);
+    /// A new instance on the same data with the same departure function, Fij and evaluation settings, that can be evaluated independently of this one; it starts with an empty memo of the same size
+    std::shared_ptr<CoeffFitClass> clone();
+    /** Keep the sums of squares of the last capacity candidates evaluated by evaluate_sum_of_squares (0 to keep none), 
+     and their residuals too if store_residuals is true; this drops whatever the memo held
+     */
+    void set_memo(std::size_t capacity, bool store_residuals = false);
+    /** Evaluate the sum of squares at c0 with the current departure function and interaction parameters. If this 
+     candidate has already been evaluated, the value in the memo is returned and nothing is evaluated, so errorvec() 
+     and the outputs still hold the last evaluation that was carried out. The quarantine policy is part of the model 
+     in the memo, but other evaluation settings (batched densities, ...) are assumed not to change the result; call 
+     clear_memo() after changing them
+     */
+    double evaluate_sum_of_squares(const std::vector<double> &c0, short Nthreads = 1);
+    /// The residuals stored in the memo for c0 with the current model; empty if there are none
+    std::vector<double> memoized_residuals(const std::vector<double> &c0);
+    /// Hits, misses and size of the memo
+    FitnessMemo::Stats memo_stats() { return m_memo->stats(); }
+    /// Drop everything in the memo
+    void clear_memo() { m_memo->clear(); }
+    /// A new AbstractState of the model (departure function, interaction parameters) with the coefficients c
+    std::shared_ptr<CoolProp::AbstractState> model_state(const std::vector<double> &c);
+    /**
+     Evaluate every point at the coefficients c (in parallel if o.Nthreads > 1), quarantined or not, and compute 
+     the deviation statistics by data type and by BibTeX key; optionally evaluate the bubble curve of the model at 
+     each temperature of the PTXY data too. The outputs hold the evaluation at c afterwards.
+     */
+    ValidationReport validate(const std::vector<double> &c, const ValidationOptions &o = ValidationOptions());
+    /// The result of validate() in JSON form, as compact tables
+    std::string validation_to_JSON(const std::vector<double> &c, const ValidationOptions &o = ValidationOptions());
+    /**
+     k-fold cross-validation over the loaded outputs: the points are dealt into folds (stratified by BibTeX key), and 
+     for each fold a fit is trained on the other folds and tested on it. The k fits run concurrently, each with 
+     o.Nthreads threads of its own, so up to k*o.Nthreads threads are busy at once. The folds share the loaded data 
+     points with this instance; each fold only builds one AbstractState per thread. Every point is evaluated, 
+     without quarantine. The departure function and interaction parameters are those currently set; this instance 
+     is not evaluated.
+     */
+    CrossValidationResult cross_validate(const CrossValidationOptions &o);
+    /**
+     Load more data points (JSON in the same form as passed to the constructor) into this instance; only the new 
+     points are constructed, and they are given the current departure function and interaction parameters. 
+     Returns the identifiers of the new points.
+     */
+    std::vector<std::size_t> add_points(const std::string &JSON_data_string);
+    /// Drop the data points with the given identifiers (enabled or not) for good
+    void remove_points(const std::vector<std::size_t> &ids);
+    /// Take the data point out of the fit, or put it back; a disabled point keeps its state and cached densities
+    void set_point_enabled(std::size_t id, bool enabled);
+    /** The identifier of the data point of each residual, in order; the points are numbered from 0 in the order they 
+     were loaded, and the identifiers never change. A PTXY point has one residual for each component.
+     */
+    std::vector<std::size_t> point_ids();
+    /// The identifiers of the data points that are loaded but disabled
+    std::vector<std::size_t> disabled_point_ids();
+    /// The identifiers of the data points (enabled or not) with the given BibTeX key
+    std::vector<std::size_t> points_of_source(const std::string &BibTeX);
+    /// Set when points that keep failing are quarantined (skipped and given a penalty), and when they are retried; quarantine is off until a policy with max_failures > 0 is set
+    void set_quarantine_policy(const QuarantinePolicy &policy);
+    /// The indices of the outputs that are currently quarantined
+    std::vector<std::size_t> quarantined_points();
+    /// Release all the outputs from quarantine so that they are evaluated on the next pass
+    void release_quarantine();
+    /** Let each iteration of the optimizer try the damping parameter times each of the factors (0.1, 1 and 10, say), 
+     evaluating the candidates at once on replicas of this instance with the threads shared out between them (or one 
+     after the other on this instance when threading is off), and take the best; an empty list goes back to one step 
+     per iteration. The replicas are kept from one fit to the next. The quarantine of failing points is 
+     suspended while such a fit runs.
+     */
+    void set_damping_candidates(const std::vector<double> &factors);
+    /// Set how loosely the densities are solved for while an optimizer is far from the optimum (not at all unless o.enabled is set)
+    void set_adaptive_tolerance(const AdaptiveToleranceOptions &o);
+    /** Set the density solver options for an optimizer whose last step changed the sum of squares or the 
+     coefficients by the relative amount progress; a progress of 0 goes back to full precision
+     */
+    void adapt_solver_tolerance(double progress);
+    /// The density solver options in use
+    PTDensitySolverOptions solver_options();
+    /** Evaluate the residuals in N worker processes forked from this one (0 to evaluate in this process); each process 
+     holds a copy of the evaluator and works on a contiguous shard of the outputs. The processes are forked at the 
+     first evaluation, and again after any change to the departure function or the binary interaction parameters
+     */
+    void set_processes(std::size_t N);
+    /// Just evaluate the residual vector in the worker processes, and gather the values into this process
+    void evaluate_processes(const std::vector<double> &c0);
+    /** Pin (or stop pinning) the workers of the parallel evaluation to CPUs; the outputs are always split into the same 
+     contiguous block per worker, so pinning keeps the AbstractStates of each block in the cache of one core
+     */
+    void set_thread_pinning(bool pin);
+    /// If true (the default), the densities of the PTXY phases with guess values are solved for in one batch per thread, rather than by a PT flash per phase
+    void set_batch_PT_densities(bool batch);
+    /// Time spent in each phase of the last run
+    const PhiFitPhaseTimes &phase_times() { return m_phase_times; }
+    /// The optimizer trace of the last run, starting with the evaluation at the starting point
+    const std::vector<PhiFitTraceEntry> &trace() { return m_trace; }
+    /// The optimizer trace of the last run in JSON form
+    std::string trace_to_JSON();
+    /** Fit from c0 with each of the thread counts and report how the time is split between the phases of 
+     the fit, along with parallel efficiency and serial fraction, in JSON form
+     */
+    std::string scaling_report(const std::vector<double> &c0, const std::vector<short> &thread_counts);
     /// Accessor for final values
     std::vector<double> cfinal() { return m_cfinal; }
     /// Accessor for elapsed time
@@ -40,14 +236,49 @@ public:
     double sum_of_squares();
     /// Return the error vector from the evaluator
     std::vector<double> errorvec();
-    /// Return all the outputs in JSON form, in a form similar to the input JSON structure, plus any additional metadata desired
+    /// Return all the outputs in JSON form, in a form similar to the input JSON structure, plus any additional metadata desired (telemetry, and the optimizer trace if a fit has been run)
     std::string dump_outputs_to_JSON();
+    /// Return the evaluation counters (timing, flash types, failures) of each data point, in order
+    std::vector<PointTelemetry> point_telemetry();
+    /// Return the evaluation counters aggregated by data type and by BibTeX key
+    TelemetrySummary telemetry_summary();
+    /// Return the evaluation counters aggregated by data type and by BibTeX key in JSON form
+    std::string telemetry_to_JSON();
+    /// Reset the evaluation counters of all outputs
+    void reset_telemetry();
     /// Dump the departure function to JSON
     std::string departure_function_to_JSON();
     /// Set departure function by its name (or alias)
     void set_departure_function_by_name(const std::string &name);
     /// Set a binary interaction parameter
     void set_binary_interaction_double(const std::size_t i, const std::size_t j, const std::string &param, double val);
+private:
+    /// Run the optimizer from the current value of m_LM_state (or c0 if it is not initialized), stopping early if *cancel becomes true
+    void optimize(bool threading, short Nthreads, const std::vector<double> &c0, const std::atomic<bool> *cancel = nullptr, const PhiFitLMCallback &progress = PhiFitLMCallback(), const FitStage *stage = nullptr);
+    std::weak_ptr<FitHandle> m_async; ///< The fit started by run_async, if any
+    /// Evaluate the outputs on the worker pool; if parts is given, worker i also sums the normal equations of its block into (*parts)[i]
+    void parallel_pass(const std::vector<double> &c0, short Nthreads, std::vector<PhiFitNormalEquations> *parts);
+    /// A hash of everything other than the coefficients that determines the residuals (departure function, interaction parameters)
+    std::uint64_t model_key();
+    std::uint64_t m_model_key;
+    bool m_model_key_valid; ///< False when the model has changed since m_model_key was computed
+    std::map<std::string, double> m_interaction_params; ///< The interaction parameters set through set_binary_interaction_double
+    std::vector<std::string> m_added_JSON; ///< The data added by add_points, in order
+    std::vector<std::size_t> m_removed_ids; ///< The identifiers of the points dropped by remove_points
+    /// Give the AbstractState the departure function and interaction parameters of the model
+    void apply_model(CoolProp::HelmholtzEOSMixtureBackend *HEOS);
+    /// Restore the state of the fitter from a checkpoint read from path
+    void apply_checkpoint(const FitCheckpoint &checkpoint, const std::string &path);
+    /// Forget everything that depends on the set of points
+    void data_changed();
+    AdaptiveToleranceOptions m_adaptive_tolerance;
+    std::vector<double> m_damping_candidates; ///< The factors of the damping parameter tried in each iteration (empty for one)
+    std::vector<std::shared_ptr<CoeffFitClass> > m_replicas; ///< Evaluate the damping candidates; made when first needed, and dropped whenever the model or the data changes
+    std::shared_ptr<WorkerPool> m_candidate_pool; ///< One worker per damping candidate, each running its replica; rebuilt if the number of candidates changes
+    friend class CoeffFitResidualProvider;
+    PTDensitySolverOptions m_full_solver_options; ///< The options of the density solver at full precision
+    /// Use these options for the density solves from now on
+    void set_solver_options(const PTDensitySolverOptions &opts);
 };
 
 #endif
@@ -0,0 +1,60 @@
+#ifndef PHIFIT_MEMO_H
+#define PHIFIT_MEMO_H
+
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+/// 64-bit FNV-1a hash of a block of bytes, continuing from h
+std::uint64_t fnv1a_hash(const void *data, std::size_t N, std::uint64_t h = 14695981039346656037ULL);
+
+/**
+ A bounded cache of the sums of squares (and optionally the residuals) of candidates that have already been 
+ evaluated. A candidate is the vector of coefficients together with a key for everything else in the model 
+ (departure function, Fij, ...). When full, the least recently used entry is dropped. Safe to use from 
+ several threads at once.
+ */
+class FitnessMemo {
+public:
+    struct Entry {
+        std::vector<double> c;
+        std::uint64_t model_key;
+        double SSE;
+        std::vector<double> residuals; ///< Empty unless residuals are stored
+    };
+    struct Stats {
+        std::size_t hits, misses, size, capacity;
+        Stats() : hits(0), misses(0), size(0), capacity(0) {};
+        /// The fraction of lookups that were hits
+        double hit_rate() const { return (hits + misses > 0) ? static_cast<double>(hits)/(hits + misses) : 0.0; }
+    };
+    /**
+     @param capacity The largest number of entries kept (0 to store nothing)
+     @param store_residuals If true, the residuals of each candidate are kept along with its sum of squares
+     */
+    FitnessMemo(std::size_t capacity = 10000, bool store_residuals = false) : m_capacity(capacity), m_store_residuals(store_residuals), m_hits(0), m_misses(0) {};
+    /// Look up the candidate; if it is there, copy its entry into e and return true (the lookup counts towards the statistics if count is true)
+    bool find(const std::vector<double> &c, std::uint64_t model_key, Entry &e, bool count = true);
+    /// Add the result of an evaluation (the residuals are dropped unless they are stored)
+    void insert(const std::vector<double> &c, std::uint64_t model_key, double SSE, const std::vector<double> &residuals);
+    /// Whether the residuals are kept
+    bool store_residuals() const { return m_store_residuals; }
+    Stats stats();
+    /// Drop all the entries and zero the statistics
+    void clear();
+private:
+    typedef std::list<Entry> EntryList;
+    std::mutex m_mutex;
+    std::size_t m_capacity;
+    bool m_store_residuals;
+    std::size_t m_hits, m_misses;
+    EntryList m_entries; ///< Most recently used first
+    std::unordered_multimap<std::uint64_t, EntryList::iterator> m_index;
+    static std::uint64_t key(const std::vector<double> &c, std::uint64_t model_key);
+};
+
+#endif
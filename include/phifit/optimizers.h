@@ -0,0 +1,122 @@
+#ifndef PHIFIT_OPTIMIZERS_H
+#define PHIFIT_OPTIMIZERS_H
+
+#include <vector>
+#include <functional>
+#include <atomic>
+#include <cstddef>
+
+#include <Eigen/Dense>
+
+/// The normal equations J^T*J*h = -J^T*r built from one pass over the residuals
+struct PhiFitNormalEquations {
+    Eigen::MatrixXd JtJ; ///< J^T*J
+    Eigen::VectorXd Jtr; ///< J^T*r
+    double SSE; ///< r^T*r
+    PhiFitNormalEquations() : SSE(0) {};
+    /// Zero the sums for P coefficients
+    void reset(std::size_t P) { JtJ.setZero(P, P); Jtr.setZero(P); SSE = 0; }
+    /// Add one residual r with its row J of the Jacobian; only the lower triangle of J^T*J is summed until symmetrize() is called
+    void add_row(const double *J, double r) {
+        Eigen::Map<const Eigen::VectorXd> row(J, Jtr.size());
+        JtJ.selfadjointView<Eigen::Lower>().rankUpdate(row);
+        Jtr += r*row;
+        SSE += r*r;
+    }
+    /// Fill in the upper triangle of J^T*J once all the rows have been added
+    void symmetrize() { JtJ.triangularView<Eigen::StrictlyUpper>() = JtJ.transpose(); }
+};
+
+/**
+ Sum partial normal equations (from the threads of a pass, say) pairwise in a fixed tree order, so that the 
+ rounding of the sum does not depend on which thread finished first; the sum is left in parts[0]
+ */
+void reduce_normal_equations(std::vector<PhiFitNormalEquations> &parts);
+
+/// Anything that can evaluate the residuals at a set of coefficients and build the normal equations from them
+class PhiFitResidualProvider {
+public:
+    virtual ~PhiFitResidualProvider() {};
+    /// Evaluate the residuals (and their derivatives) at the coefficients c
+    virtual void evaluate(const std::vector<double> &c, PhiFitNormalEquations &ne) = 0;
+    /// Solve the damped normal equations (J^T*J + mu*I)*h = -J^T*r for the step h
+    virtual Eigen::VectorXd solve(const PhiFitNormalEquations &ne, double mu) {
+        Eigen::MatrixXd A = ne.JtJ;
+        A.diagonal().array() += mu;
+        return A.ldlt().solve(-ne.Jtr);
+    }
+    /// Solve the damped normal equations for each of the damping parameters mus, all from one eigendecomposition of J^T*J
+    virtual std::vector<Eigen::VectorXd> solve_candidates(const PhiFitNormalEquations &ne, const std::vector<double> &mus) {
+        Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> es(ne.JtJ);
+        Eigen::VectorXd g = es.eigenvectors().transpose()*ne.Jtr;
+        std::vector<Eigen::VectorXd> hs;
+        for (double mu : mus) {
+            hs.push_back(-es.eigenvectors()*(g.array()/(es.eigenvalues().array() + mu)).matrix());
+        }
+        return hs;
+    }
+    /// Evaluate the residuals at each set of coefficients in cs; by default one after the other
+    virtual void evaluate_candidates(const std::vector<std::vector<double> > &cs, std::vector<PhiFitNormalEquations> &nes) {
+        nes.resize(cs.size());
+        for (std::size_t i = 0; i < cs.size(); ++i) { evaluate(cs[i], nes[i]); }
+    }
+};
+
+/// Options for the Levenberg-Marquardt optimizer
+struct PhiFitLMOptions {
+    std::vector<double> c0; ///< The initial guess for the coefficients
+    double tau0, ///< Scaling of the initial damping parameter relative to the largest element on diagonal of J^T*J
+           omega, ///< Relaxation factor applied to each step
+           epsilon1, ///< Convergence threshold for the infinity-norm of the gradient J^T*r
+           epsilon2; ///< Convergence threshold for the norm of the step, relative to the norm of the coefficients
+    std::size_t Nmax; ///< Maximum number of iterations
+    const std::atomic<bool> *cancel; ///< If given, the iteration stops at the end of the iteration in which this becomes true
+    std::vector<double> mu_factors; ///< If not empty, each iteration tries the damping parameter times each of these factors, evaluated together, and takes the best step
+    PhiFitLMOptions() : tau0(1e-3), omega(1), epsilon1(1e-12), epsilon2(1e-10), Nmax(100), cancel(nullptr) {};
+};
+
+/// What happened in one iteration of the Levenberg-Marquardt optimizer
+struct PhiFitLMIteration {
+    std::size_t iter; ///< The number of iterations taken so far
+    bool start; ///< True for the evaluation at the starting point (or at the point an iteration was resumed from), where no step is taken
+    double SSE, ///< The sum of squares at the trial coefficients (at the current coefficients if the step was not evaluated)
+           mu, ///< The damping parameter the step was solved with
+           step_norm, ///< The norm of the step
+           gain; ///< The ratio of the actual to the predicted reduction of the sum of squares (NaN if the step was not evaluated)
+    bool accepted; ///< True if the step was accepted
+    PhiFitLMIteration() : iter(0), start(false), SSE(0), mu(0), step_norm(0), gain(0), accepted(false) {};
+};
+
+/// The complete state of the Levenberg-Marquardt iteration; this is all that is needed to resume an iteration
+struct PhiFitLMState {
+    std::vector<double> c; ///< The coefficients of the last accepted step
+    double SSE, ///< The sum of squares at c
+           mu, ///< The damping parameter
+           nu; ///< The growth factor of the damping parameter after a rejected step
+    std::size_t iter; ///< The number of iterations taken so far
+    bool initialized, ///< True once the damping parameter has been set from the first evaluation
+         converged; ///< True if a convergence criterion has been satisfied
+    PhiFitLMIteration last; ///< The most recent iteration (not needed to resume, so it is not checkpointed)
+    PhiFitLMState() : SSE(0), mu(0), nu(2), iter(0), initialized(false), converged(false) {};
+};
+
+/// Called after the evaluation at the starting point and after every iteration of the optimizer with the current state
+typedef std::function<void(const PhiFitLMState &)> PhiFitLMCallback;
+
+/**
+ Levenberg-Marquardt optimization with the gain-ratio damping update of Madsen, Nielsen and Tingleff,
+ "Methods for non-linear least squares problems", IMM, 2004
+
+ With several damping factors, the steps for all of them are solved for from one factorization of J^T*J and 
+ evaluated together (concurrently, if the provider can); the step with the lowest sum of squares among those that 
+ reduce it is accepted, and if none does, the damping grows from the largest one tried.
+
+ @param provider The class that evaluates the residuals
+ @param opts The options
+ @param state The state of the iteration; if it has not been initialized, the iteration starts from opts.c0,
+        otherwise the iteration picks up from the given state
+ @param callback Optional function that is called after the evaluation at the starting point and after every iteration
+ */
+void PhiFitLevenbergMarquardt(PhiFitResidualProvider &provider, const PhiFitLMOptions &opts, PhiFitLMState &state, const PhiFitLMCallback &callback = PhiFitLMCallback());
+
+#endif
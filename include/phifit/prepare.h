@@ -0,0 +1,35 @@
+#ifndef PHIFIT_PREPARE_H
+#define PHIFIT_PREPARE_H
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+/// Options for preparing a dataset, and where prepared datasets are cached
+struct PrepareOptions {
+    std::string schema_path, ///< The JSON schema the dataset is validated against (empty to skip validation)
+                cache_dir, ///< The directory that prepared datasets are written to and read from (empty for no cache)
+                departure_JSON; ///< The departure function of the reference model, in the fit0 form (empty for the default of CoolProp)
+    std::vector<double> c_ref; ///< The binary interaction parameters betaT, gammaT, betaV, gammaV of the reference model
+    short Nthreads; ///< The number of threads used to solve for the densities
+    PrepareOptions() : schema_path("data/data_schema.json"), c_ref(4, 1.0), Nthreads(1) {};
+};
+
+/// Check the dataset against the JSON schema, and throw if it does not conform
+void validate_dataset(const std::string &JSON_data, const std::string &schema_JSON);
+
+/// The cache key of the dataset: a hash of its contents, followed by a hash of the reference model
+std::string dataset_cache_key(const std::string &JSON_data, const PrepareOptions &o);
+
+/**
+ Validate the dataset, and fill in the liquid and vapor density guesses of the PTXY points that have none with 
+ the densities from a PT flash of the reference model, in parallel. If o.cache_dir is set and the dataset has 
+ already been prepared with the same reference model, the cached version is returned; otherwise the prepared 
+ dataset is written to the cache. Returns the prepared dataset.
+ */
+std::string prepare_dataset(const std::string &JSON_data, const PrepareOptions &o);
+
+/// The prepared version of the dataset from the cache of o, or an empty string if it is not there
+std::string find_prepared_dataset(const std::string &JSON_data, const PrepareOptions &o);
+
+#endif
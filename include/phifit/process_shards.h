@@ -0,0 +1,56 @@
+#ifndef PHIFIT_PROCESS_SHARDS_H
+#define PHIFIT_PROCESS_SHARDS_H
+
+#include <vector>
+#include <string>
+#include <functional>
+#include <cstddef>
+
+/**
+ A set of worker processes, forked from this one, that each evaluate one shard of the work. The coefficients 
+ are broadcast, and the results gathered, through one block of shared memory; pipes only carry the one-byte 
+ commands and the replies, each with a message of the shard that may be empty. Each worker process has a copy of the state of this process at the time of the fork,
+ so anything other than the coefficients that changes afterwards requires new workers.
+ Only available on POSIX platforms.
+ */
+class ProcessShards {
+public:
+    /**
+     The work of one shard, run in the worker process
+     @param shard The index of the shard
+     @param c The coefficients
+     @param out Where the shard writes its results (shard_sizes[shard] doubles)
+     @param message Text that is passed back along with the results (error messages, for instance); empty on entry
+     */
+    typedef std::function<void(std::size_t shard, const std::vector<double> &c, double *out, std::string &message)> Task;
+
+    /**
+     @param shard_sizes The number of doubles of results of each shard; one worker process is forked per shard
+     @param Ncoeffs The number of coefficients that are broadcast
+     @param task The work of each shard
+     */
+    ProcessShards(const std::vector<std::size_t> &shard_sizes, std::size_t Ncoeffs, const Task &task);
+    /// Tell the workers to exit, and wait for them
+    ~ProcessShards();
+    /// The number of shards (and worker processes)
+    std::size_t size() const { return m_offsets.size(); }
+    /// The number of coefficients
+    std::size_t Ncoeffs() const { return m_Ncoeffs; }
+    /// Broadcast the coefficients, and wait until all the shards have written their results; a task that threw is reported with its message
+    void run(const std::vector<double> &c);
+    /// The results of a shard from the last run
+    const double *result(std::size_t shard) const { return m_shared + m_offsets[shard]; }
+    /// The message of a shard from the last run
+    const std::string &message(std::size_t shard) const { return m_messages[shard]; }
+private:
+    std::size_t m_Ncoeffs, m_bytes;
+    std::vector<std::size_t> m_offsets; ///< Offset of the results of each shard (in doubles) in the shared block
+    double *m_shared; ///< [coefficients, results of shard 0, results of shard 1, ...]
+    std::vector<int> m_pids, m_command_fds, m_reply_fds;
+    std::vector<std::string> m_messages;
+    void stop();
+    ProcessShards(const ProcessShards &);
+    ProcessShards &operator=(const ProcessShards &);
+};
+
+#endif
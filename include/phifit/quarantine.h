@@ -0,0 +1,29 @@
+#ifndef PHIFIT_QUARANTINE_H
+#define PHIFIT_QUARANTINE_H
+
+#include <vector>
+#include <cstddef>
+
+/// When to stop evaluating a data point that keeps failing, and when to try it again; by default no point is ever quarantined
+struct QuarantinePolicy {
+    std::size_t max_failures; ///< A point is quarantined after this many consecutive failed evaluations (0 to never quarantine)
+    double penalty; ///< The calculated value given to a point that failed or is quarantined
+    double retry_shift; ///< A quarantined point is retried once the coefficients have moved by more than this (relative 2-norm) from where it last failed
+    std::size_t retry_every; ///< A quarantined point is retried after it has been skipped this many times (0 for never)
+    QuarantinePolicy() : max_failures(0), penalty(10000), retry_shift(0.01), retry_every(10) {};
+};
+
+/// The quarantine state of one data point
+struct PointQuarantine {
+    std::size_t Nconsecutive, ///< Number of consecutive failed evaluations
+                Nskipped; ///< Number of evaluations skipped since the point was quarantined (or last retried)
+    bool quarantined;
+    std::vector<double> c_failed; ///< The coefficients of the last failed evaluation
+    PointQuarantine() : Nconsecutive(0), Nskipped(0), quarantined(false) {};
+    /// Whether an evaluation at the coefficients c should be skipped; counts the skip if so
+    bool skip(const QuarantinePolicy &policy, const std::vector<double> &c);
+    /// Record the outcome of an evaluation at the coefficients c
+    void record(const QuarantinePolicy &policy, bool failed, const std::vector<double> &c);
+};
+
+#endif
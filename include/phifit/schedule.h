@@ -0,0 +1,74 @@
+#ifndef PHIFIT_SCHEDULE_H
+#define PHIFIT_SCHEDULE_H
+
+#include <vector>
+#include <string>
+#include <cstddef>
+
+#include "phifit/telemetry.h"
+
+/// One stage of a coarse-to-fine fit: the share of the data points to fit to, and when to stop
+struct FitStage {
+    double fraction; ///< The share of the data points in this stage, in (0, 1]; the points of a stage include those of the stages before it
+    double epsilon1, ///< Convergence threshold for the infinity-norm of the gradient J^T*r
+           epsilon2; ///< Convergence threshold for the norm of the step, relative to the norm of the coefficients
+    std::size_t Nmax; ///< Maximum number of iterations
+    FitStage(double fraction = 1, double epsilon1 = 1e-12, double epsilon2 = 1e-10, std::size_t Nmax = 100)
+        : fraction(fraction), epsilon1(epsilon1), epsilon2(epsilon2), Nmax(Nmax) {};
+};
+
+/// Options for a coarse-to-fine fit
+struct FitScheduleOptions {
+    std::vector<FitStage> stages; ///< The stages, with increasing fractions; the last stage must have all the points
+    unsigned long long seed; ///< Seed of the shuffle that orders the points of each source
+    bool stratify; ///< If true, each stage has the same share of the points of every BibTeX source
+    /// A quarter of the points, then half, each to loose tolerances, then all of them
+    FitScheduleOptions() : seed(0), stratify(true) {
+        stages.push_back(FitStage(0.25, 1e-6, 1e-5, 30));
+        stages.push_back(FitStage(0.5, 1e-8, 1e-7, 30));
+        stages.push_back(FitStage(1));
+    };
+};
+
+/// The fit of one stage
+struct StageResult {
+    std::size_t stage, ///< The index of the stage
+                Npoints, ///< Number of data points fitted to
+                Nresiduals, ///< Number of residuals fitted to
+                iter; ///< Number of iterations of the optimizer
+    double SSE, ///< Sum of squares of the points of the stage at the fitted coefficients
+           elapsed_sec; ///< Wall time of the stage
+    bool converged; ///< True if the optimizer converged
+    std::vector<double> c; ///< The fitted coefficients, from which the next stage starts
+    std::size_t Nflash[FLASH_TYPE_COUNT]; ///< Number of flash calculations of each type in this stage, over all its points
+    StageResult() : stage(0), Npoints(0), Nresiduals(0), iter(0), SSE(0), elapsed_sec(0), converged(false) {
+        for (std::size_t i = 0; i < FLASH_TYPE_COUNT; ++i) { Nflash[i] = 0; }
+    };
+};
+
+/// The result of a coarse-to-fine fit
+struct FitScheduleResult {
+    std::vector<StageResult> stages;
+    std::vector<std::size_t> first_stage; ///< The first stage in which each data point is fitted to
+    double elapsed_sec;
+    FitScheduleResult() : elapsed_sec(0) {};
+};
+
+/**
+ Work out the first stage in which each point is fitted to, so that stage s has the share fractions[s] of the
+ points. With stratification, the points of each source are shuffled and the first ones in that order are taken,
+ so that every stage has (to within one point) the same share of each source; otherwise all the points are
+ shuffled together. The result depends only on the sources and the seed.
+
+ @param sources The BibTeX key of each point
+ @param fractions The share of the points in each stage, increasing, with the last one equal to 1
+ @param seed The seed of the shuffle
+ @param stratify If true, stratify by source
+ @returns The first stage of each point
+ */
+std::vector<std::size_t> assign_stages(const std::vector<std::string> &sources, const std::vector<double> &fractions, unsigned long long seed, bool stratify = true);
+
+/// The result of a coarse-to-fine fit in JSON form
+std::string fit_schedule_to_JSON(const FitScheduleResult &result);
+
+#endif
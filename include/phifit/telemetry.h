@@ -0,0 +1,92 @@
+#ifndef PHIFIT_TELEMETRY_H
+#define PHIFIT_TELEMETRY_H
+
+#include <vector>
+#include <string>
+#include <cstddef>
+
+#include "rapidjson_include.h"
+
+/// The route that was taken to get the thermodynamic state(s) of a data point
+enum PhiFitFlashType {
+    FLASH_NONE = 0, ///< No flash has been carried out
+    FLASH_LOCAL_PT, ///< PT flash starting from a guess value for the density
+    FLASH_GLOBAL_PT, ///< Global PT flash (expensive!)
+    FLASH_DIRECT_DT, ///< Direct evaluation at the given density and temperature
+    FLASH_BATCH_PT, ///< Density from the batched PT density solver, then direct evaluation
+    FLASH_TYPE_COUNT
+};
+
+/// Get a short name for the flash type
+const char *flash_type_name(PhiFitFlashType type);
+
+/// Counters that are accumulated over the evaluations of one data point
+struct PointTelemetry {
+    std::size_t Nevals, ///< Number of evaluations
+                Nexceptions, ///< Number of evaluations that threw
+                Nskipped; ///< Number of evaluations skipped because the point was quarantined
+    std::size_t Nflash[FLASH_TYPE_COUNT]; ///< Number of flash calculations of each type
+    double elapsed_sec, ///< Total wall time spent in evaluation
+           max_sec; ///< Wall time of the slowest evaluation
+    PhiFitFlashType last_flash; ///< The flash type of the most recent flash calculation
+    std::string last_error; ///< The most recent error message
+    PointTelemetry() : Nevals(0), Nexceptions(0), Nskipped(0), elapsed_sec(0), max_sec(0), last_flash(FLASH_NONE) {
+        for (std::size_t i = 0; i < FLASH_TYPE_COUNT; ++i) { Nflash[i] = 0; }
+    };
+    /// Add the counters of evaluations carried out later (or elsewhere) to these
+    void add(const PointTelemetry &t);
+};
+
+/// The number of doubles that pack_point_telemetry writes
+const std::size_t POINT_TELEMETRY_DOUBLES = 6 + FLASH_TYPE_COUNT;
+/// Write the counters (all but the error message) as POINT_TELEMETRY_DOUBLES doubles, to pass them between processes
+void pack_point_telemetry(const PointTelemetry &t, double *out);
+/// Read the counters written by pack_point_telemetry
+PointTelemetry unpack_point_telemetry(const double *in);
+
+/// Telemetry aggregated over a group of data points
+struct TelemetryAggregate {
+    std::string key; ///< The data type or BibTeX key of the group
+    std::size_t Npoints, ///< Number of data points in the group
+                Nevals, ///< Total number of evaluations
+                Nexceptions, ///< Total number of evaluations that threw
+                Nskipped, ///< Total number of evaluations skipped by quarantine
+                Nfailing; ///< Number of data points whose last evaluation threw
+    std::size_t Nflash[FLASH_TYPE_COUNT]; ///< Total number of flash calculations of each type
+    double elapsed_sec, ///< Total wall time
+           max_sec; ///< Wall time of the slowest single evaluation
+    std::string last_error; ///< One of the most recent error messages
+    TelemetryAggregate() : Npoints(0), Nevals(0), Nexceptions(0), Nskipped(0), Nfailing(0), elapsed_sec(0), max_sec(0) {
+        for (std::size_t i = 0; i < FLASH_TYPE_COUNT; ++i) { Nflash[i] = 0; }
+    };
+    /// Add the counters of one data point to the group
+    void add(const PointTelemetry &t, bool failing);
+};
+
+/// Telemetry aggregated by data type and by BibTeX source
+struct TelemetrySummary {
+    std::vector<TelemetryAggregate> by_type, by_source;
+};
+
+/**
+ Aggregate the per-point telemetry
+
+ @param points The telemetry of each data point
+ @param types The data type of each data point
+ @param sources The BibTeX key of each data point
+ @param failing Whether the last evaluation of each data point threw
+ */
+TelemetrySummary summarize_telemetry(const std::vector<PointTelemetry> &points, const std::vector<std::string> &types, const std::vector<std::string> &sources, const std::vector<bool> &failing);
+
+/// Add the counters of one data point as members of the JSON object val
+void point_telemetry_to_JSON(const PointTelemetry &t, rapidjson::Value &val, rapidjson::Document &doc);
+/// Add the counts of the flash calculations of each type (FLASH_TYPE_COUNT of them, indexed by type) to val as "flashes"
+void flash_counts_to_JSON(const std::size_t *Nflash, rapidjson::Value &val, rapidjson::Document &doc);
+
+/// Add the groups of the summary as members of the JSON object val
+void telemetry_summary_to_JSON(const TelemetrySummary &summary, rapidjson::Value &val, rapidjson::Document &doc);
+
+/// Convert the summary to a JSON-formatted string
+std::string telemetry_to_JSON(const TelemetrySummary &summary);
+
+#endif
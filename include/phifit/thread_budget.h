@@ -0,0 +1,47 @@
+#ifndef PHIFIT_THREAD_BUDGET_H
+#define PHIFIT_THREAD_BUDGET_H
+
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <cstddef>
+
+/// A counting semaphore that bounds the total number of threads used by fits that run concurrently
+class ThreadBudget {
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::size_t m_total, m_available;
+public:
+    /// Instantiator; a total of zero is taken to mean the number of hardware threads
+    ThreadBudget(std::size_t total = 0);
+    /**
+     Block until N threads are available and take them; N is limited to the total budget, and the number taken is 
+     returned. If cancel is given and becomes true while waiting, nothing is taken and 0 is returned
+     */
+    std::size_t acquire(std::size_t N, const std::atomic<bool> *cancel = nullptr);
+    /// Give back N threads that were taken with acquire
+    void release(std::size_t N);
+    /// The total number of threads in the budget
+    std::size_t total() { return m_total; }
+    /// The budget shared by everything in this process
+    static const std::shared_ptr<ThreadBudget> &global();
+};
+
+/// Holds threads from a budget for as long as it is alive
+class ThreadBudgetLease {
+private:
+    ThreadBudget &m_budget;
+    std::size_t m_N;
+public:
+    ThreadBudgetLease(ThreadBudget &budget, std::size_t N, const std::atomic<bool> *cancel = nullptr) : m_budget(budget), m_N(budget.acquire(N, cancel)) {};
+    ~ThreadBudgetLease() { if (m_N > 0) { m_budget.release(m_N); } }
+    /// The number of threads that were granted (0 if the wait was cancelled)
+    std::size_t size() const { return m_N; }
+private:
+    ThreadBudgetLease(const ThreadBudgetLease &);
+    ThreadBudgetLease &operator=(const ThreadBudgetLease &);
+};
+
+#endif
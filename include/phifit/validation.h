@@ -0,0 +1,82 @@
+#ifndef PHIFIT_VALIDATION_H
+#define PHIFIT_VALIDATION_H
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <functional>
+#include <cstddef>
+
+namespace CoolProp { class AbstractState; }
+
+/// Deviation statistics of a group of data points; the deviation of a point is its residue, as in the dumped outputs
+struct DeviationStats {
+    std::string key; ///< The data type or BibTeX key of the group
+    std::size_t N, ///< Number of points that were evaluated successfully
+                Nfailed; ///< Number of points whose evaluation threw (left out of the statistics)
+    double AAD, ///< Mean absolute deviation
+           bias, ///< Mean deviation
+           RMS, ///< Root-mean-square deviation
+           max_abs; ///< Largest absolute deviation
+    DeviationStats() : N(0), Nfailed(0), AAD(0), bias(0), RMS(0), max_abs(0) {};
+};
+
+/// Deviation statistics of all the points, by data type and by BibTeX key
+struct DeviationSummary {
+    DeviationStats overall;
+    std::vector<DeviationStats> by_type, by_source; ///< In order of first appearance
+};
+
+/**
+ Compute the deviation statistics
+
+ @param dev The deviation of each data point
+ @param types The data type of each data point
+ @param sources The BibTeX key of each data point
+ @param failed Whether the evaluation of each data point threw
+ */
+DeviationSummary summarize_deviations(const std::vector<double> &dev, const std::vector<std::string> &types, const std::vector<std::string> &sources, const std::vector<bool> &failed);
+
+/// The bubble curve of the model at one temperature; NaN where the calculation failed
+struct VLEIsotherm {
+    double T; ///< Temperature (K)
+    std::vector<double> x0, ///< Mole fraction of the first component in the liquid
+                        p, ///< Bubble pressure (Pa)
+                        y0; ///< Mole fraction of the first component in the vapor
+    VLEIsotherm() : T(0) {};
+};
+
+/// Options for the validation of a fit
+struct ValidationOptions {
+    short Nthreads; ///< Number of threads used to evaluate the points and the isotherms
+    bool isotherms; ///< If true, the bubble curve of the model is also evaluated at each temperature of the PTXY data
+    std::size_t Nx; ///< Number of liquid compositions in the grid of each isotherm
+    double x0min, ///< Smallest mole fraction of the first component in the grid
+           x0max; ///< Largest mole fraction of the first component in the grid
+    ValidationOptions() : Nthreads(1), isotherms(false), Nx(21), x0min(0.01), x0max(0.99) {};
+};
+
+/// The result of the validation of a fit
+struct ValidationReport {
+    DeviationSummary deviations;
+    std::vector<VLEIsotherm> isotherms;
+    double elapsed_sec; ///< Wall time of the validation
+    ValidationReport() : elapsed_sec(0) {};
+};
+
+/// Makes a new AbstractState of the model; called once per thread
+typedef std::function<std::shared_ptr<CoolProp::AbstractState>()> ModelStateFactory;
+
+/**
+ Evaluate the bubble curve of the model at each temperature on the composition grid of the options; the 
+ isotherms are dealt out to the threads, each of which has its own AbstractState
+ */
+std::vector<VLEIsotherm> evaluate_isotherms(const ModelStateFactory &factory, const std::vector<double> &T, const ValidationOptions &o);
+
+/**
+ The report in JSON form, as compact tables ({"columns": [...], "rows": [[...], ...]}) rather than one 
+ object per row; values that are not finite are written as null
+ */
+std::string validation_to_JSON(const ValidationReport &report);
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef PHIFIT_WORKER_POOL_H
+#define PHIFIT_WORKER_POOL_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+#include <cstddef>
+
+/**
+ A fixed set of worker threads that live as long as the pool, so that repeated parallel passes do not pay for 
+ starting threads; worker i always gets part i of each pass, and may be pinned to a CPU so that the data it 
+ works on stays in the cache of the same core from one pass to the next
+ */
+class WorkerPool {
+public:
+    /// The work of one pass; it is called with the index of the worker
+    typedef std::function<void(std::size_t)> Task;
+
+    /**
+     @param Nworkers The number of worker threads
+     @param pin If true, worker i is pinned to CPU i (modulo the number of CPUs), where the platform supports it
+     */
+    WorkerPool(std::size_t Nworkers, bool pin = false);
+    ~WorkerPool();
+    /// The number of worker threads
+    std::size_t size() const { return m_threads.size(); }
+    /// True if all the workers were pinned to a CPU
+    bool pinned() const { return m_pinned; }
+    /// Run task(i) on each worker i, and wait for them all; busy[i] is set to the time worker i spent on its task.
+    /// An exception thrown by a task is rethrown here
+    void run(const Task &task, std::vector<double> &busy);
+private:
+    std::vector<std::thread> m_threads;
+    std::mutex m_mutex;
+    std::condition_variable m_cv_start, m_cv_done;
+    Task m_task;
+    std::vector<double> m_busy;
+    std::size_t m_generation, ///< Incremented for each pass so that the workers know there is new work
+                m_Nremaining; ///< Number of workers that have not finished the current pass
+    bool m_stop, m_pinned;
+    std::exception_ptr m_error;
+    void worker_loop(std::size_t i);
+    WorkerPool(const WorkerPool &);
+    WorkerPool &operator=(const WorkerPool &);
+};
+
+#endif
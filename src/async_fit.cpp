@@ -0,0 +1,102 @@
+#include "phifit/async_fit.h"
+
+// Includes from CoolProp
+#include "AbstractState.h"
+
+const char *fit_status_name(FitStatus status) {
+    switch (status) {
+    case FIT_QUEUED: return "queued";
+    case FIT_RUNNING: return "running";
+    case FIT_CONVERGED: return "converged";
+    case FIT_STOPPED: return "stopped";
+    case FIT_CANCELLED: return "cancelled";
+    case FIT_FAILED: return "failed";
+    default: return "unknown";
+    }
+}
+
+FitHandle::FitHandle() : m_cancel(false), m_done(false), m_start(std::chrono::high_resolution_clock::now()) {}
+
+FitHandle::~FitHandle() {
+    cancel();
+    if (m_thread.joinable()) { m_thread.join(); }
+}
+
+void FitHandle::start(const Body &body) {
+    if (m_thread.joinable()) { throw CoolProp::ValueError("This fit has already been started"); }
+    m_start = std::chrono::high_resolution_clock::now();
+    m_thread = std::thread([this, body]() {
+        try {
+            body(*this);
+        }
+        catch (std::exception &e) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_error = std::current_exception();
+            m_progress.status = FIT_FAILED;
+            m_progress.error = e.what();
+        }
+        catch (...) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_error = std::current_exception();
+            m_progress.status = FIT_FAILED;
+            m_progress.error = "unknown error";
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_progress.elapsed_sec = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - m_start).count();
+            m_done = true;
+        }
+        m_cv.notify_all();
+    });
+}
+
+FitProgress FitHandle::progress() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    FitProgress p = m_progress;
+    if (!m_done) {
+        p.elapsed_sec = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - m_start).count();
+    }
+    return p;
+}
+
+bool FitHandle::done() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_done;
+}
+
+bool FitHandle::wait(double timeout_sec) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (timeout_sec < 0) {
+        m_cv.wait(lock, [this]() { return m_done; });
+    }
+    else {
+        m_cv.wait_for(lock, std::chrono::duration<double>(timeout_sec), [this]() { return m_done; });
+    }
+    if (m_done && m_error) { std::rethrow_exception(m_error); }
+    return m_done;
+}
+
+std::vector<double> FitHandle::best_coefficients() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_best;
+}
+
+void FitHandle::set_running(std::size_t Nthreads) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_progress.status = FIT_RUNNING;
+    m_progress.Nthreads = Nthreads;
+}
+
+void FitHandle::update(const PhiFitLMState &state) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_progress.iter = state.iter;
+    m_progress.SSE = state.SSE;
+    m_progress.mu = state.mu;
+    m_best = state.c;
+}
+
+void FitHandle::finish(FitStatus status, const std::vector<double> &c) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_progress.status = status;
+    m_best = c;
+}
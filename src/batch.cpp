@@ -0,0 +1,259 @@
+#include "phifit/batch.h"
+
+// Includes from CoolProp
+#include "AbstractState.h"
+#include "rapidjson_include.h"
+
+// Includes from c++
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <limits>
+
+namespace {
+
+/// The directory part of a path, including the trailing separator
+std::string dirname(const std::string &path) {
+    std::size_t i = path.find_last_of("/\\");
+    return (i == std::string::npos) ? "" : path.substr(0, i + 1);
+}
+
+/// Paths in the manifest are taken relative to the directory of the manifest unless they are absolute
+std::string resolve_path(const std::string &root, const std::string &path) {
+    bool absolute = (!path.empty() && (path[0] == '/' || path[0] == '\\')) || (path.size() > 1 && path[1] == ':');
+    return absolute ? path : root + path;
+}
+
+FitJob parse_job(rapidjson::Value &val, const std::string &root, std::size_t index) {
+    FitJob job;
+    job.name = val.HasMember("name") ? cpjson::get_string(val, "name") : fmt::format("job%d", static_cast<int>(index));
+    if (!val.HasMember("data")) { throw CoolProp::ValueError(fmt::format("Job %s does not have any \"data\"", job.name.c_str())); }
+    for (auto &path : cpjson::get_string_array(val, "data")) {
+        job.data_paths.push_back(resolve_path(root, path));
+    }
+    if (job.data_paths.empty()) { throw CoolProp::ValueError(fmt::format("The list of data files of job %s is empty", job.name.c_str())); }
+    if (val.HasMember("names")) { job.names = cpjson::get_string_array(val, "names"); }
+    if (val.HasMember("departure")) { job.departure_path = resolve_path(root, cpjson::get_string(val, "departure")); }
+    if (val.HasMember("departure name")) { job.departure_name = cpjson::get_string(val, "departure name"); }
+    if (!job.departure_path.empty() && !job.departure_name.empty()) {
+        throw CoolProp::ValueError(fmt::format("Job %s can have \"departure\" or \"departure name\", but not both", job.name.c_str()));
+    }
+    if (val.HasMember("Fij")) { job.has_Fij = true; job.Fij = cpjson::get_double(val, "Fij"); }
+    if (!val.HasMember("c0") || !val["c0"].IsArray() || val["c0"].Empty()) {
+        throw CoolProp::ValueError(fmt::format("Job %s must have a non-empty array \"c0\"", job.name.c_str()));
+    }
+    if (val["c0"].Begin()->IsArray()) {
+        job.c0 = cpjson::get_double_array2D(val["c0"]);
+    }
+    else {
+        job.c0.push_back(cpjson::get_double_array(val["c0"]));
+    }
+    if (val.HasMember("threads")) {
+        int Nthreads = cpjson::get_integer(val, "threads");
+        if (Nthreads < 1) { throw CoolProp::ValueError(fmt::format("Job %s must have at least one thread", job.name.c_str())); }
+        job.Nthreads = static_cast<short>(Nthreads);
+    }
+    job.output_path = resolve_path(root, val.HasMember("output") ? cpjson::get_string(val, "output") : job.name + ".json");
+    return job;
+}
+
+void write_results(const std::string &path, const rapidjson::Document &doc) {
+    std::ofstream ofs(path.c_str());
+    if (!ofs) { throw CoolProp::ValueError(fmt::format("Unable to open results file %s for writing", path.c_str())); }
+    ofs << cpjson::json2string(doc);
+}
+
+}
+
+std::string FitJob::dataset_key() const {
+    return strjoin(data_paths, "\n") + "\n|" + strjoin(names, "&");
+}
+
+FitManifest load_manifest(const std::string &path) {
+    rapidjson::Document doc;
+    cpjson::JSON_string_to_rapidjson(get_file_contents(path), doc);
+    if (!doc.IsObject() || !doc.HasMember("jobs") || !doc["jobs"].IsArray()) {
+        throw CoolProp::ValueError(fmt::format("Manifest %s must be an object with an array \"jobs\"", path.c_str()));
+    }
+    FitManifest manifest;
+    if (doc.HasMember("max threads")) {
+        int Nthreads = cpjson::get_integer(doc, "max threads");
+        manifest.Nthreads = static_cast<std::size_t>(std::max(Nthreads, 0));
+    }
+    const std::string root = dirname(path);
+    std::size_t index = 0;
+    for (rapidjson::Value::ValueIterator itr = doc["jobs"].Begin(); itr != doc["jobs"].End(); ++itr) {
+        manifest.jobs.push_back(parse_job(*itr, root, index++));
+    }
+    return manifest;
+}
+
+std::string merge_datasets(const std::vector<std::string> &data_paths, const std::vector<std::string> &names) {
+    rapidjson::Document merged;
+    merged.SetObject();
+    rapidjson::Value about, data(rapidjson::kArrayType);
+    for (std::size_t i = 0; i < data_paths.size(); ++i) {
+        rapidjson::Document doc;
+        cpjson::JSON_string_to_rapidjson(get_file_contents(data_paths[i]), doc);
+        if (!doc.HasMember("about") || !doc.HasMember("data") || !doc["data"].IsArray()) {
+            throw CoolProp::ValueError(fmt::format("Data file %s must have \"about\" and an array \"data\"", data_paths[i].c_str()));
+        }
+        if (i == 0) {
+            about = rapidjson::Value(doc["about"], merged.GetAllocator());
+        }
+        for (rapidjson::Value::ValueIterator itr = doc["data"].Begin(); itr != doc["data"].End(); ++itr) {
+            data.PushBack(rapidjson::Value(*itr, merged.GetAllocator()).Move(), merged.GetAllocator());
+        }
+    }
+    if (!names.empty()) {
+        rapidjson::Value names_list(rapidjson::kArrayType);
+        for (auto &name : names) {
+            names_list.PushBack(rapidjson::Value(name.c_str(), merged.GetAllocator()).Move(), merged.GetAllocator());
+        }
+        if (about.HasMember("names")) {
+            about["names"] = names_list;
+        }
+        else {
+            about.AddMember("names", names_list, merged.GetAllocator());
+        }
+    }
+    merged.AddMember("about", about, merged.GetAllocator());
+    merged.AddMember("data", data, merged.GetAllocator());
+    return cpjson::json2string(merged);
+}
+
+std::shared_ptr<const std::string> DatasetCache::data(const FitJob &job) {
+    // The lock is held while loading so that each dataset is only ever read once
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const std::string key = job.dataset_key();
+    auto it = m_data.find(key);
+    if (it != m_data.end()) { return it->second; }
+    std::shared_ptr<const std::string> data(new std::string(merge_datasets(job.data_paths, job.names)));
+    m_data[key] = data;
+    return data;
+}
+
+std::shared_ptr<CoeffFitClass> DatasetCache::checkout(const FitJob &job) {
+    if (!job.departure_path.empty() || !job.departure_name.empty()) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::vector<std::shared_ptr<CoeffFitClass> > &idle = m_idle[job.dataset_key()];
+        if (!idle.empty()) {
+            std::shared_ptr<CoeffFitClass> CFC = idle.back();
+            idle.pop_back();
+            return CFC;
+        }
+    }
+    // Building the fitter (one AbstractState per data point) is done outside the lock
+    std::shared_ptr<const std::string> data = this->data(job);
+    return std::shared_ptr<CoeffFitClass>(new CoeffFitClass(*data));
+}
+
+void DatasetCache::checkin(const FitJob &job, const std::shared_ptr<CoeffFitClass> &CFC) {
+    // The departure function (and with it Fij) is set again by every job that is handed an idle fitter
+    CFC->release_quarantine();
+    CFC->clear_memo();
+    for (std::size_t id : CFC->disabled_point_ids()) { CFC->set_point_enabled(id, true); }
+    CFC->reset_telemetry();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_idle[job.dataset_key()].push_back(CFC);
+}
+
+FitterLease::~FitterLease() {
+    try {
+        m_cache.checkin(m_job, m_CFC);
+    }
+    catch (...) {
+        // A fitter that cannot be reset is dropped rather than handed to another job
+    }
+}
+
+bool run_fit_job(const FitJob &job, DatasetCache &cache) {
+    rapidjson::Document doc;
+    doc.SetObject();
+    cpjson::set_string("name", job.name, doc, doc);
+    doc.AddMember("threads", static_cast<double>(job.Nthreads), doc.GetAllocator());
+    bool ok = true;
+    try {
+        auto startTime = std::chrono::high_resolution_clock::now();
+        FitterLease CFC(cache, job);
+        if (!job.departure_path.empty()) {
+            CFC->setup(get_file_contents(job.departure_path));
+        }
+        else if (!job.departure_name.empty()) {
+            CFC->set_departure_function_by_name(job.departure_name);
+        }
+        if (job.has_Fij) {
+            CFC->set_binary_interaction_double(0, 1, "Fij", job.Fij);
+        }
+        CFC->reset_telemetry();
+
+        // One fit from each of the starting points; the outputs of the best one are kept
+        rapidjson::Value fits(rapidjson::kArrayType);
+        double best_SSE = std::numeric_limits<double>::infinity();
+        std::vector<double> best_c;
+        std::string best_outputs;
+        for (auto &c0 : job.c0) {
+            CFC->run(job.Nthreads > 1, job.Nthreads, c0);
+            double SSE = CFC->sum_of_squares();
+            rapidjson::Value fit; fit.SetObject();
+            cpjson::set_double_array("c0", c0, fit, doc);
+            cpjson::set_double_array("cfinal", CFC->cfinal(), fit, doc);
+            fit.AddMember("sum of squares", SSE, doc.GetAllocator());
+            fit.AddMember("iterations", static_cast<double>(CFC->m_LM_state.iter), doc.GetAllocator());
+            fit.AddMember("converged", CFC->m_LM_state.converged, doc.GetAllocator());
+            fit.AddMember("elapsed (s)", CFC->elapsed_sec(), doc.GetAllocator());
+            fits.PushBack(fit, doc.GetAllocator());
+            if (best_c.empty() || SSE < best_SSE) {
+                best_SSE = SSE;
+                best_c = CFC->cfinal();
+                best_outputs = CFC->dump_outputs_to_JSON();
+            }
+        }
+
+        cpjson::set_double_array("cfinal", best_c, doc, doc);
+        doc.AddMember("sum of squares", best_SSE, doc.GetAllocator());
+        doc.AddMember("fits", fits, doc.GetAllocator());
+        doc.AddMember("elapsed (s)", std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count(), doc.GetAllocator());
+        rapidjson::Document outputs;
+        cpjson::JSON_string_to_rapidjson(best_outputs, outputs);
+        doc.AddMember("outputs", rapidjson::Value(outputs, doc.GetAllocator()).Move(), doc.GetAllocator());
+    }
+    catch (std::exception &e) {
+        cpjson::set_string("error", e.what(), doc, doc);
+        ok = false;
+    }
+    try {
+        write_results(job.output_path, doc);
+    }
+    catch (std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        ok = false;
+    }
+    return ok;
+}
+
+std::size_t run_fit_jobs(const std::vector<FitJob> &jobs, ThreadBudget &budget) {
+    DatasetCache cache;
+    std::atomic<std::size_t> Nfailed(0);
+    std::mutex print_mutex;
+    std::vector<std::thread> threads;
+    for (auto &job : jobs) {
+        // Wait (in the order of the manifest) until enough of the running jobs have finished to free up the threads
+        std::size_t Nthreads = budget.acquire(job.Nthreads);
+        threads.push_back(std::thread([&, job, Nthreads]() {
+            FitJob j = job;
+            j.Nthreads = static_cast<short>(Nthreads);
+            auto startTime = std::chrono::high_resolution_clock::now();
+            bool ok = run_fit_job(j, cache);
+            double elap = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+            budget.release(Nthreads);
+            if (!ok) { Nfailed++; }
+            std::lock_guard<std::mutex> lock(print_mutex);
+            std::cout << fmt::format("%s: %s in %g s with %d thread(s) -> %s", j.name.c_str(), (ok ? "done" : "FAILED"), elap, static_cast<int>(Nthreads), j.output_path.c_str()) << std::endl;
+        }));
+    }
+    for (auto &t : threads) { t.join(); }
+    return Nfailed;
+}
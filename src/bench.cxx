@@ -0,0 +1,278 @@
+//
+//  Benchmarks of the kernels, the per-point evaluation and full fits
+//
+//  Usage: Bench [output.json]
+//
+//  The results are written to the given file (or stdout) in JSON format
+//
+
+#include "phifit/data_generation.h"
+#include "phifit/fitter.h"
+#include "phifit/departure_function.h"
+
+// Includes from CoolProp
+#include "AbstractState.h"
+#include "CoolProp.h"
+#include "rapidjson_include.h"
+
+// Includes from c++
+#include <chrono>
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <numeric>
+#include <thread>
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+namespace {
+
+/// Converted version of departure function from GERG (Methane-Propane)
+const std::string GERG_departure_JSON = R"(
+    {
+        "departure[ij]": {
+        "cdelta": [[-0.0, 0.0, 0.0], [-0.0, 0.0, 0.0], [-0.0, 0.0, 0.0], [-0.0, 0.0, 0.0], [-0.0, 0.0, 0.0], [-0.25, -0.5, 0.3125], [-0.25, -0.75, 0.4375], [-0.0, -2.0, 1.0], [-0.0, -3.0, 1.5]],
+        "ctau": [[0], [0], [0], [0], [0], [0], [0], [0], [0]],
+        "d": [3, 3, 4, 4, 4, 1, 1, 1, 2],
+        "ldelta": [[2, 1, 0], [2, 1, 0], [2, 1, 0], [2, 1, 0], [2, 1, 0], [2, 1, 0], [2, 1, 0], [2, 1, 0], [2, 1, 0]],
+        "ltau": [[0], [0], [0], [0], [0], [0], [0], [0], [0]],
+        "n": [0.013746429958576, -0.0074425012129552, -0.0045516600213685, -0.0054546603350237, 0.0023682016824471, 0.18007763721438, -0.44773942932486, 0.0193273748882, -0.30632197804624],
+        "t": [1.85, 3.95, 0.0, 1.85, 3.85, 5.25, 3.85, 0.2, 6.5]
+        }
+    }
+)";
+
+const std::string backend = "HEOS", names = "Methane&n-Propane";
+
+/// Timing statistics over repeated runs of a benchmark, in seconds per run
+struct Timing {
+    double min, median, mean;
+    std::size_t Nrepeats;
+};
+
+/**
+ Run the function the given number of times (after one untimed warm-up run) and collect the timing statistics
+ @param setup Optional function that is called, untimed, before every run of f
+ */
+Timing time_it(const std::function<void()> &f, std::size_t Nrepeats, const std::function<void()> &setup = std::function<void()>()) {
+    if (setup) { setup(); }
+    f();
+    std::vector<double> times;
+    for (std::size_t i = 0; i < Nrepeats; ++i) {
+        if (setup) { setup(); }
+        auto startTime = std::chrono::high_resolution_clock::now();
+        f();
+        times.push_back(std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count());
+    }
+    std::sort(times.begin(), times.end());
+    Timing t;
+    t.Nrepeats = Nrepeats;
+    t.min = times.front();
+    t.median = times[times.size()/2];
+    t.mean = std::accumulate(times.begin(), times.end(), 0.0)/times.size();
+    return t;
+}
+
+/// Add a benchmark result to the list; the timing is divided by the number of operations per run
+void add_result(rapidjson::Value &list, rapidjson::Document &doc, const std::string &name, const Timing &t, std::size_t Nops, rapidjson::Value &params) {
+    rapidjson::Value val; val.SetObject();
+    cpjson::set_string("name", name, val, doc);
+    val.AddMember("parameters", params, doc.GetAllocator());
+    val.AddMember("repeats", static_cast<double>(t.Nrepeats), doc.GetAllocator());
+    val.AddMember("operations per repeat", static_cast<double>(Nops), doc.GetAllocator());
+    val.AddMember("min (s/op)", t.min/Nops, doc.GetAllocator());
+    val.AddMember("median (s/op)", t.median/Nops, doc.GetAllocator());
+    val.AddMember("mean (s/op)", t.mean/Nops, doc.GetAllocator());
+    list.PushBack(val, doc.GetAllocator());
+}
+
+/// Generate PRhoT data on a grid of temperatures and compositions from a PT flash at the given pressure
+std::string gen_PRhoT_data(std::size_t NT, double p) {
+    shared_ptr<CoolProp::AbstractState> AS(CoolProp::AbstractState::factory(backend, names));
+    rapidjson::Document doc;
+    doc.SetObject();
+    rapidjson::Value about; about.SetObject();
+    rapidjson::Value names_list(rapidjson::kArrayType);
+    for (auto &name : strsplit(names, '&')) {
+        names_list.PushBack(rapidjson::Value(name.c_str(), doc.GetAllocator()).Move(), doc.GetAllocator());
+    }
+    about.AddMember("names", names_list, doc.GetAllocator());
+    doc.AddMember("about", about, doc.GetAllocator());
+    rapidjson::Value data(rapidjson::kArrayType);
+    for (std::size_t i = 0; i < NT; ++i) {
+        double T = 300 + 100.0*i/std::max(NT - 1, static_cast<std::size_t>(1));
+        for (double x0 = 0.1; x0 < 0.95; x0 += 0.2) {
+            std::vector<double> z(2, x0); z[1] = 1 - z[0];
+            AS->set_mole_fractions(z);
+            AS->update(CoolProp::PT_INPUTS, p, T);
+            rapidjson::Value point; point.SetObject();
+            point.AddMember("type", "PRhoT", doc.GetAllocator());
+            point.AddMember("T (K)", T, doc.GetAllocator());
+            point.AddMember("p (Pa)", p, doc.GetAllocator());
+            point.AddMember("rho (mol/m3)", AS->rhomolar(), doc.GetAllocator());
+            cpjson::set_double_array("z (molar)", z, point, doc);
+            cpjson::set_string("BibTeX", "bench", point, doc);
+            data.PushBack(point, doc.GetAllocator());
+        }
+    }
+    doc.AddMember("data", data, doc.GetAllocator());
+    return cpjson::json2string(doc);
+}
+
+/// Microbenchmark of the departure function at fixed states
+void bench_departure_update(rapidjson::Value &list, rapidjson::Document &doc) {
+    rapidjson::Document dep;
+    cpjson::JSON_string_to_rapidjson(GERG_departure_JSON, dep);
+    PhiFitDepartureFunction f(dep["departure[ij]"]);
+    const std::size_t N = 100000;
+    const double taus[] = { 0.5, 1.0, 2.0 }, deltas[] = { 0.01, 1.0, 3.0 };
+    for (double tau : taus) {
+        for (double delta : deltas) {
+            Timing t = time_it([&]() { for (std::size_t i = 0; i < N; ++i) { f.update(tau, delta); } }, 5);
+            rapidjson::Value params; params.SetObject();
+            params.AddMember("tau", tau, doc.GetAllocator());
+            params.AddMember("delta", delta, doc.GetAllocator());
+            add_result(list, doc, "PhiFitDepartureFunction::update", t, N, params);
+        }
+    }
+}
+
+/// Per-point evaluation of the PTXY and PRhoT outputs, with the departure function turned on
+void bench_evaluate_one(rapidjson::Value &list, rapidjson::Document &doc) {
+    std::vector<double> c0 = { 1,1,1,1 };
+    gen_JSON_data_options o;
+    o.Tmin = 100; o.Tmax = 200;
+    const std::string PTXY_data = gen_JSON_data(backend, names, o), PRhoT_data = gen_PRhoT_data(10, 5e6);
+    const std::string types[] = { "PTXY", "PRhoT" };
+    const std::string *datas[] = { &PTXY_data, &PRhoT_data };
+    for (std::size_t k = 0; k < 2; ++k) {
+        CoeffFitClass CFC(*datas[k]);
+        CFC.setup(GERG_departure_JSON);
+        std::size_t N = CFC.m_eval->get_outputs_size();
+        Timing t = time_it([&]() { CFC.evaluate_serial(c0); }, 10);
+        rapidjson::Value params; params.SetObject();
+        params.AddMember("points", static_cast<double>(N), doc.GetAllocator());
+        add_result(list, doc, types[k] + " evaluate_one", t, N, params);
+    }
+}
+
+/// Installing new departure function coefficients in every output
+void bench_departure_install(rapidjson::Value &list, rapidjson::Document &doc) {
+    gen_JSON_data_options o;
+    o.Tmin = 100; o.Tmax = 200;
+    CoeffFitClass CFC(gen_JSON_data(backend, names, o));
+    CFC.setup(GERG_departure_JSON);
+    Coefficients coeffs;
+    const std::size_t Nterms = 10;
+    for (std::size_t i = 0; i < Nterms; ++i) {
+        coeffs.n.push_back(0.01*(i + 1)); coeffs.t.push_back(1 + 0.5*i); coeffs.d.push_back(1 + i % 4);
+        coeffs.ldelta.push_back(std::vector<double>(1, 1)); coeffs.cdelta.push_back(std::vector<double>(1, -1));
+        coeffs.ltau.push_back(std::vector<double>(1, 0)); coeffs.ctau.push_back(std::vector<double>(1, 0));
+    }
+    std::size_t N = CFC.m_eval->get_outputs_size();
+    Timing t = time_it([&]() { CFC.setup(coeffs); }, 100);
+    rapidjson::Value params; params.SetObject();
+    params.AddMember("points", static_cast<double>(N), doc.GetAllocator());
+    params.AddMember("terms", static_cast<double>(Nterms), doc.GetAllocator());
+    add_result(list, doc, "CoeffFitClass::setup(Coefficients)", t, 1, params);
+}
+
+/// Bytes currently allocated on the heap, or -1 if this cannot be measured on this platform
+double heap_bytes() {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    return static_cast<double>(mallinfo2().uordblks);
+#elif defined(__GLIBC__)
+    return static_cast<double>(static_cast<unsigned int>(mallinfo().uordblks));
+#else
+    return -1;
+#endif
+}
+
+/// Heap memory per PRhoT point with a full AbstractState per point and with the slim evaluator, along with the cost of an evaluation
+void bench_PRhoT_memory(rapidjson::Value &list, rapidjson::Document &doc) {
+    std::vector<double> c0 = { 1,1,1,1 };
+    const std::string data = gen_PRhoT_data(40, 5e6);
+    const bool slims[] = { false, true };
+    for (bool slim : slims) {
+        double before = heap_bytes();
+        CoeffFitClass CFC(data, slim);
+        CFC.setup(GERG_departure_JSON);
+        double after = heap_bytes();
+        std::size_t N = CFC.m_eval->get_outputs_size();
+        Timing t = time_it([&]() { CFC.evaluate_serial(c0); }, 10);
+        rapidjson::Value params; params.SetObject();
+        params.AddMember("points", static_cast<double>(N), doc.GetAllocator());
+        params.AddMember("slim", slim, doc.GetAllocator());
+        params.AddMember("bytes per point", (before < 0) ? -1.0 : (after - before)/N, doc.GetAllocator());
+        add_result(list, doc, "PRhoT memory and evaluate_one", t, N, params);
+    }
+}
+
+/// Full Levenberg-Marquardt fits of the interaction parameters for several dataset sizes and thread counts
+void bench_fits(rapidjson::Value &list, rapidjson::Document &doc) {
+    std::vector<double> c0 = { 1,1,1,1 };
+    // Grids of temperatures and compositions giving about 100, 500 and 2000 bubble points, the range of the 
+    // VLE datasets of a binary mixture, with noise of the size of the experimental uncertainties
+    const std::size_t NTs[] = { 10, 20, 40 }, Nxs[] = { 10, 25, 50 };
+    const short thread_counts[] = { 1, 2, 4 };
+    for (std::size_t k = 0; k < 3; ++k) {
+        gen_data_options o;
+        o.names = names;
+        o.T = linspace(200, 280, NTs[k]);
+        o.x0 = linspace(0.05, 0.95, Nxs[k]);
+        o.sigma_T = 0.01; o.sigma_p = 1e-3; o.sigma_x = 1e-3;
+        o.seed = 1;
+        o.Nthreads = static_cast<short>(std::max(1u, std::thread::hardware_concurrency()));
+        std::string data = gen_data(o);
+        for (short Nthreads : thread_counts) {
+            std::unique_ptr<CoeffFitClass> CFC;
+            std::size_t N = 0;
+            Timing t = time_it([&]() {
+                // Each fit starts from a freshly loaded dataset, including the global flashes on the first pass,
+                // but loading it is not timed
+                CFC->run(Nthreads > 1, Nthreads, c0);
+            }, 3, [&]() {
+                CFC.reset(new CoeffFitClass(data));
+                N = CFC->point_ids().size();
+            });
+            rapidjson::Value params; params.SetObject();
+            params.AddMember("points", static_cast<double>(N), doc.GetAllocator());
+            params.AddMember("threads", static_cast<double>(Nthreads), doc.GetAllocator());
+            add_result(list, doc, "CoeffFitClass::run", t, 1, params);
+        }
+    }
+}
+
+}
+
+int main(int argc, char **argv) {
+    rapidjson::Document doc;
+    doc.SetObject();
+
+    rapidjson::Value about; about.SetObject();
+    cpjson::set_string("CoolProp version", CoolProp::get_global_param_string("version"), about, doc);
+    cpjson::set_string("CoolProp gitrevision", CoolProp::get_global_param_string("gitrevision"), about, doc);
+    cpjson::set_string("fluids", names, about, doc);
+    about.AddMember("hardware threads", static_cast<double>(std::thread::hardware_concurrency()), doc.GetAllocator());
+    doc.AddMember("about", about, doc.GetAllocator());
+
+    rapidjson::Value list(rapidjson::kArrayType);
+    bench_departure_update(list, doc);
+    bench_evaluate_one(list, doc);
+    bench_departure_install(list, doc);
+    bench_PRhoT_memory(list, doc);
+    bench_fits(list, doc);
+    doc.AddMember("benchmarks", list, doc.GetAllocator());
+
+    std::string out = cpjson::json2string(doc);
+    if (argc > 1) {
+        std::ofstream ofs(argv[1]);
+        ofs << out;
+    }
+    else {
+        std::cout << out << std::endl;
+    }
+    return EXIT_SUCCESS;
+}
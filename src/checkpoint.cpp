@@ -0,0 +1,115 @@
+#include "phifit/checkpoint.h"
+
+// Includes from CoolProp
+#include "AbstractState.h"
+
+// Includes from c++
+#include <fstream>
+#include <cstdio>
+#include <cstdint>
+
+namespace {
+
+const char checkpoint_magic[8] = {'P','H','I','F','I','T','C','K'};
+const std::uint32_t checkpoint_version = 2;
+
+void write_uint64(std::ostream &os, std::uint64_t val) { os.write(reinterpret_cast<const char *>(&val), sizeof(val)); }
+void write_double(std::ostream &os, double val) { os.write(reinterpret_cast<const char *>(&val), sizeof(val)); }
+void write_doubles(std::ostream &os, const std::vector<double> &vec) {
+    write_uint64(os, vec.size());
+    if (!vec.empty()) { os.write(reinterpret_cast<const char *>(&(vec[0])), vec.size()*sizeof(double)); }
+}
+void write_string(std::ostream &os, const std::string &s) {
+    write_uint64(os, s.size());
+    os.write(s.data(), s.size());
+}
+
+std::uint64_t read_uint64(std::istream &is) { std::uint64_t val = 0; is.read(reinterpret_cast<char *>(&val), sizeof(val)); return val; }
+double read_double(std::istream &is) { double val = 0; is.read(reinterpret_cast<char *>(&val), sizeof(val)); return val; }
+std::vector<double> read_doubles(std::istream &is) {
+    std::vector<double> vec(read_uint64(is));
+    if (!vec.empty()) { is.read(reinterpret_cast<char *>(&(vec[0])), vec.size()*sizeof(double)); }
+    return vec;
+}
+std::string read_string(std::istream &is) {
+    std::string s(read_uint64(is), '\0');
+    if (!s.empty()) { is.read(&(s[0]), s.size()); }
+    return s;
+}
+
+}
+
+void save_checkpoint(const std::string &path, const FitCheckpoint &checkpoint)
+{
+    // Write to a temporary file and then move it into place so that an
+    // interruption while writing can never clobber the previous checkpoint
+    std::string tmp_path = path + ".tmp";
+    {
+        std::ofstream ofs(tmp_path.c_str(), std::ios::binary | std::ios::trunc);
+        if (!ofs) { throw CoolProp::ValueError(fmt::format("Unable to open checkpoint file %s for writing", tmp_path.c_str())); }
+        ofs.write(checkpoint_magic, sizeof(checkpoint_magic));
+        ofs.write(reinterpret_cast<const char *>(&checkpoint_version), sizeof(checkpoint_version));
+
+        write_uint64(ofs, checkpoint.Noutputs);
+        write_doubles(ofs, checkpoint.c);
+        write_string(ofs, checkpoint.departure_JSON);
+        write_string(ofs, checkpoint.departure_name);
+        write_double(ofs, checkpoint.Fij);
+        write_doubles(ofs, checkpoint.rhoL);
+        write_doubles(ofs, checkpoint.rhoV);
+
+        const PhiFitLMState &LM = checkpoint.LM;
+        write_doubles(ofs, LM.c);
+        write_double(ofs, LM.SSE);
+        write_double(ofs, LM.mu);
+        write_double(ofs, LM.nu);
+        write_uint64(ofs, LM.iter);
+        write_uint64(ofs, (LM.initialized ? 1 : 0) | (LM.converged ? 2 : 0));
+
+        write_string(ofs, checkpoint.user_data);
+        if (!ofs) { throw CoolProp::ValueError(fmt::format("Unable to write checkpoint file %s", tmp_path.c_str())); }
+    }
+    if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        throw CoolProp::ValueError(fmt::format("Unable to move checkpoint file into place at %s", path.c_str()));
+    }
+}
+
+FitCheckpoint load_checkpoint(const std::string &path)
+{
+    std::ifstream ifs(path.c_str(), std::ios::binary);
+    if (!ifs) { throw CoolProp::ValueError(fmt::format("Unable to open checkpoint file %s", path.c_str())); }
+
+    char magic[sizeof(checkpoint_magic)];
+    std::uint32_t version = 0;
+    ifs.read(magic, sizeof(magic));
+    ifs.read(reinterpret_cast<char *>(&version), sizeof(version));
+    if (!ifs || !std::equal(magic, magic + sizeof(magic), checkpoint_magic)) {
+        throw CoolProp::ValueError(fmt::format("%s is not a phifit checkpoint file", path.c_str()));
+    }
+    if (version != checkpoint_version) {
+        throw CoolProp::ValueError(fmt::format("Checkpoint file %s has version %d; only version %d is supported", path.c_str(), version, checkpoint_version));
+    }
+
+    FitCheckpoint checkpoint;
+    checkpoint.Noutputs = read_uint64(ifs);
+    checkpoint.c = read_doubles(ifs);
+    checkpoint.departure_JSON = read_string(ifs);
+    checkpoint.departure_name = read_string(ifs);
+    checkpoint.Fij = read_double(ifs);
+    checkpoint.rhoL = read_doubles(ifs);
+    checkpoint.rhoV = read_doubles(ifs);
+
+    PhiFitLMState &LM = checkpoint.LM;
+    LM.c = read_doubles(ifs);
+    LM.SSE = read_double(ifs);
+    LM.mu = read_double(ifs);
+    LM.nu = read_double(ifs);
+    LM.iter = read_uint64(ifs);
+    std::uint64_t flags = read_uint64(ifs);
+    LM.initialized = (flags & 1) != 0;
+    LM.converged = (flags & 2) != 0;
+
+    checkpoint.user_data = read_string(ifs);
+    if (!ifs) { throw CoolProp::ValueError(fmt::format("Checkpoint file %s is truncated", path.c_str())); }
+    return checkpoint;
+}
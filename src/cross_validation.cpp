@@ -0,0 +1,76 @@
+#include "phifit/cross_validation.h"
+
+// Includes from CoolProp
+#include "AbstractState.h"
+#include "rapidjson_include.h"
+
+// Includes from c++
+#include <map>
+#include <random>
+#include <numeric>
+#include <algorithm>
+
+std::vector<std::size_t> assign_folds(const std::vector<std::string> &sources, std::size_t k, unsigned long long seed, bool stratify) {
+    if (k < 2) { throw CoolProp::ValueError(fmt::format("At least two folds are needed; %d were asked for", k)); }
+    if (sources.size() < k) { throw CoolProp::ValueError(fmt::format("%d points cannot be split into %d folds", sources.size(), k)); }
+    std::mt19937_64 rng(seed);
+
+    // The points of each stratum, in order of the first appearance of the stratum
+    std::vector<std::vector<std::size_t> > strata;
+    std::map<std::string, std::size_t> index;
+    for (std::size_t i = 0; i < sources.size(); ++i) {
+        const std::string key = stratify ? sources[i] : std::string();
+        std::map<std::string, std::size_t>::iterator it = index.find(key);
+        if (it == index.end()) {
+            it = index.insert(std::make_pair(key, strata.size())).first;
+            strata.push_back(std::vector<std::size_t>());
+        }
+        strata[it->second].push_back(i);
+    }
+    std::vector<std::size_t> folds(sources.size());
+    std::size_t next = 0;
+    for (auto &stratum : strata) {
+        std::shuffle(stratum.begin(), stratum.end(), rng);
+        for (std::size_t i : stratum) {
+            folds[i] = next;
+            next = (next + 1) % k;
+        }
+    }
+    return folds;
+}
+
+double CrossValidationResult::held_out_MSE() const {
+    double SSE = 0; std::size_t N = 0;
+    for (auto &f : folds) { SSE += f.SSE_held_out; N += f.Nheld_out; }
+    return (N > 0) ? SSE/N : 0;
+}
+
+double CrossValidationResult::train_MSE() const {
+    double SSE = 0; std::size_t N = 0;
+    for (auto &f : folds) { SSE += f.SSE_train; N += f.Ntrain; }
+    return (N > 0) ? SSE/N : 0;
+}
+
+std::string cross_validation_to_JSON(const CrossValidationResult &result) {
+    rapidjson::Document doc;
+    doc.SetObject();
+    doc.AddMember("folds", static_cast<double>(result.folds.size()), doc.GetAllocator());
+    doc.AddMember("elapsed (s)", result.elapsed_sec, doc.GetAllocator());
+    doc.AddMember("train MSE", result.train_MSE(), doc.GetAllocator());
+    doc.AddMember("held-out MSE", result.held_out_MSE(), doc.GetAllocator());
+    rapidjson::Value folds(rapidjson::kArrayType);
+    for (auto &f : result.folds) {
+        rapidjson::Value val; val.SetObject();
+        val.AddMember("fold", static_cast<double>(f.fold), doc.GetAllocator());
+        val.AddMember("train points", static_cast<double>(f.Ntrain), doc.GetAllocator());
+        val.AddMember("held-out points", static_cast<double>(f.Nheld_out), doc.GetAllocator());
+        val.AddMember("train SSE", f.SSE_train, doc.GetAllocator());
+        val.AddMember("held-out SSE", f.SSE_held_out, doc.GetAllocator());
+        val.AddMember("iterations", static_cast<double>(f.iter), doc.GetAllocator());
+        val.AddMember("converged", f.converged, doc.GetAllocator());
+        cpjson::set_double_array("c", f.c, val, doc);
+        folds.PushBack(val, doc.GetAllocator());
+    }
+    doc.AddMember("results", folds, doc.GetAllocator());
+    return cpjson::json2string(doc);
+}
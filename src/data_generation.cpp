@@ -3,6 +3,15 @@
 #include "rapidjson_include.h"
 #include "phifit/data_generation.h"
 
+#include <random>
+#include <thread>
+#include <memory>
+#include <sstream>
+#include <iomanip>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+
 ////   *************************************************************************
 ////   *************************** THE TESTS  **********************************
 ////   *************************************************************************
@@ -58,4 +67,234 @@ std::string gen_JSON_data(const std::string &backend, const std::string &names,
     doc.AddMember("data", v_data, doc.GetAllocator());
 
     return cpjson::to_string(doc);
-}
\ No newline at end of file
+}
+
+std::vector<double> linspace(double min, double max, std::size_t N) {
+    std::vector<double> vals(N);
+    for (std::size_t i = 0; i < N; ++i) {
+        vals[i] = (N == 1) ? min : min + (max - min)*i/(N - 1);
+    }
+    return vals;
+}
+
+namespace {
+
+/// One generated data point, held until the points are written out in order
+struct GeneratedPoint {
+    enum point_type { NONE, PTXY, PRHOT, CRITICAL } type;
+    double T, p, rho, rhoL, rhoV;
+    std::vector<double> x, y;
+    GeneratedPoint() : type(NONE), T(0), p(0), rho(0), rhoL(-1), rhoV(-1) {};
+};
+
+/// Add noise to the composition of the first component, keeping it within (0, 1)
+std::vector<double> noisy_composition(double x0, double sigma, std::normal_distribution<double> &N01, std::mt19937_64 &rng) {
+    if (sigma > 0) {
+        x0 = std::min(std::max(x0 + sigma*N01(rng), 1e-10), 1 - 1e-10);
+    }
+    std::vector<double> x(2, x0); x[1] = 1 - x0;
+    return x;
+}
+
+/// Generate the point with the given index; the points are numbered PTXY first, then PRhoT, then critical points
+GeneratedPoint gen_point(CoolProp::AbstractState &AS, const gen_data_options &o, std::size_t index) {
+    GeneratedPoint pt;
+
+    // The noise is seeded with the index of the point so that it does not depend on the number of threads
+    std::seed_seq seq{ static_cast<unsigned>(o.seed), static_cast<unsigned>(o.seed >> 32), static_cast<unsigned>(index), static_cast<unsigned>(static_cast<unsigned long long>(index) >> 32) };
+    std::mt19937_64 rng(seq);
+    std::normal_distribution<double> N01(0, 1);
+
+    const std::size_t NT = o.T.size(), Nx = o.x0.size(), Np = o.p.size();
+    const std::size_t NPTXY = o.PTXY ? NT*Nx : 0, NPRhoT = o.PRhoT ? NT*Nx*Np : 0;
+    try {
+        if (index < NPTXY) {
+            double T = o.T[index / Nx], x0 = o.x0[index % Nx];
+            std::vector<double> z(2, x0); z[1] = 1 - x0;
+            AS.set_mole_fractions(z);
+            AS.update(CoolProp::QT_INPUTS, 0, T);
+            std::vector<double> y = AS.mole_fractions_vapor();
+            if (o.density_guesses) {
+                pt.rhoL = AS.saturated_liquid_keyed_output(CoolProp::iDmolar);
+                pt.rhoV = AS.saturated_vapor_keyed_output(CoolProp::iDmolar);
+            }
+            pt.T = AS.T() + o.sigma_T*N01(rng);
+            pt.p = AS.p()*(1 + o.sigma_p*N01(rng));
+            pt.x = noisy_composition(x0, o.sigma_x, N01, rng);
+            pt.y = noisy_composition(y[0], o.sigma_x, N01, rng);
+            pt.type = GeneratedPoint::PTXY;
+        }
+        else if (index < NPTXY + NPRhoT) {
+            std::size_t i = index - NPTXY;
+            double T = o.T[i / (Nx*Np)], x0 = o.x0[(i / Np) % Nx], p = o.p[i % Np];
+            std::vector<double> z(2, x0); z[1] = 1 - x0;
+            AS.set_mole_fractions(z);
+            AS.update(CoolProp::PT_INPUTS, p, T);
+            pt.rho = AS.rhomolar()*(1 + o.sigma_rho*N01(rng));
+            pt.T = T + o.sigma_T*N01(rng);
+            pt.p = p*(1 + o.sigma_p*N01(rng));
+            pt.x = noisy_composition(x0, o.sigma_x, N01, rng);
+            pt.type = GeneratedPoint::PRHOT;
+        }
+        else {
+            double x0 = o.x0[index - NPTXY - NPRhoT];
+            std::vector<double> z(2, x0); z[1] = 1 - x0;
+            AS.set_mole_fractions(z);
+            for (auto &crit : AS.all_critical_points()) {
+                if (!crit.stable) { continue; }
+                pt.T = crit.T + o.sigma_T*N01(rng);
+                pt.p = crit.p*(1 + o.sigma_p*N01(rng));
+                pt.x = noisy_composition(x0, o.sigma_x, N01, rng);
+                pt.type = GeneratedPoint::CRITICAL;
+                break;
+            }
+        }
+    }
+    catch (...) {
+        // The state could not be calculated; the point is skipped
+        pt.type = GeneratedPoint::NONE;
+    }
+    if (!std::isfinite(pt.T) || !std::isfinite(pt.p) || !std::isfinite(pt.rho)) {
+        pt.type = GeneratedPoint::NONE;
+    }
+    // A density guess that is not finite would be written as nan, which is not JSON; -1 means no guess
+    if (!std::isfinite(pt.rhoL)) { pt.rhoL = -1; }
+    if (!std::isfinite(pt.rhoV)) { pt.rhoV = -1; }
+    return pt;
+}
+
+void write_JSON_string(std::ostream &os, const std::string &s) {
+    os << '"';
+    for (char c : s) {
+        if (c == '"' || c == '\\') { os << '\\'; }
+        os << c;
+    }
+    os << '"';
+}
+
+void write_JSON_array(std::ostream &os, const std::vector<double> &vec) {
+    os << '[';
+    for (std::size_t i = 0; i < vec.size(); ++i) {
+        os << (i > 0 ? ", " : "") << vec[i];
+    }
+    os << ']';
+}
+
+void write_point(std::ostream &os, const GeneratedPoint &pt, const std::string &BibTeX) {
+    switch (pt.type) {
+        case GeneratedPoint::PTXY:
+            os << "{\"type\": \"PTXY\", \"T (K)\": " << pt.T << ", \"p (Pa)\": " << pt.p
+               << ", \"rho' (guess,mol/m3)\": " << pt.rhoL << ", \"rho'' (guess,mol/m3)\": " << pt.rhoV << ", \"x (molar)\": ";
+            write_JSON_array(os, pt.x);
+            os << ", \"y (molar)\": ";
+            write_JSON_array(os, pt.y);
+            break;
+        case GeneratedPoint::PRHOT:
+            os << "{\"type\": \"PRhoT\", \"T (K)\": " << pt.T << ", \"p (Pa)\": " << pt.p << ", \"rho (mol/m3)\": " << pt.rho << ", \"z (molar)\": ";
+            write_JSON_array(os, pt.x);
+            break;
+        case GeneratedPoint::CRITICAL:
+            os << "{\"type\": \"CriticalPoint\", \"Tc (K)\": " << pt.T << ", \"pc (Pa)\": " << pt.p << ", \"z (molar)\": ";
+            write_JSON_array(os, pt.x);
+            break;
+        default:
+            return;
+    }
+    os << ", \"BibTeX\": ";
+    write_JSON_string(os, BibTeX);
+    os << '}';
+}
+
+std::vector<double> grid_from_JSON(rapidjson::Value &v, const char *key) {
+    std::vector<double> vals = cpjson::get_double_array(v, key);
+    if (vals.size() != 3) { throw CoolProp::ValueError(fmt::format("\"%s\" must be given as [min, max, N]", key)); }
+    return linspace(vals[0], vals[1], static_cast<std::size_t>(vals[2]));
+}
+
+}
+
+gen_data_options gen_data_options_from_JSON(const std::string &JSON_string) {
+    // {"backend": "HEOS", "names": "Methane&n-Propane", "BibTeX": "synthetic",
+    //  "T (K)": [min, max, N], "x0": [min, max, N], "p (Pa)": [min, max, N],
+    //  "types": ["PTXY", "PRhoT", "CriticalPoint"], "density guesses": true,
+    //  "noise": {"T (K)": 0.01, "p": 1e-4, "x": 1e-3, "rho": 1e-4}, "seed": 0, "threads": 4}
+    rapidjson::Document doc;
+    cpjson::JSON_string_to_rapidjson(JSON_string, doc);
+    gen_data_options o;
+    if (!doc.HasMember("names")) { throw CoolProp::ValueError("The generator options must have \"names\""); }
+    o.names = cpjson::get_string(doc, "names");
+    if (doc.HasMember("backend")) { o.backend = cpjson::get_string(doc, "backend"); }
+    if (doc.HasMember("BibTeX")) { o.BibTeX = cpjson::get_string(doc, "BibTeX"); }
+    if (doc.HasMember("T (K)")) { o.T = grid_from_JSON(doc, "T (K)"); }
+    if (doc.HasMember("x0")) { o.x0 = grid_from_JSON(doc, "x0"); }
+    if (doc.HasMember("p (Pa)")) { o.p = grid_from_JSON(doc, "p (Pa)"); }
+    if (doc.HasMember("types")) {
+        std::vector<std::string> types = cpjson::get_string_array(doc, "types");
+        o.PTXY = std::find(types.begin(), types.end(), "PTXY") != types.end();
+        o.PRhoT = std::find(types.begin(), types.end(), "PRhoT") != types.end();
+        o.critical = std::find(types.begin(), types.end(), "CriticalPoint") != types.end();
+    }
+    if (doc.HasMember("density guesses")) { o.density_guesses = cpjson::get_bool(doc, "density guesses"); }
+    if (doc.HasMember("noise")) {
+        rapidjson::Value &noise = doc["noise"];
+        if (noise.HasMember("T (K)")) { o.sigma_T = cpjson::get_double(noise, "T (K)"); }
+        if (noise.HasMember("p")) { o.sigma_p = cpjson::get_double(noise, "p"); }
+        if (noise.HasMember("x")) { o.sigma_x = cpjson::get_double(noise, "x"); }
+        if (noise.HasMember("rho")) { o.sigma_rho = cpjson::get_double(noise, "rho"); }
+    }
+    if (doc.HasMember("seed")) { o.seed = static_cast<unsigned long long>(cpjson::get_double(doc, "seed")); }
+    if (doc.HasMember("threads")) { o.Nthreads = static_cast<short>(std::max(cpjson::get_integer(doc, "threads"), 1)); }
+    return o;
+}
+
+std::size_t gen_data(const gen_data_options &o, std::ostream &os) {
+    const std::size_t NT = o.T.size(), Nx = o.x0.size(), Np = o.p.size();
+    const std::size_t Npoints = (o.PTXY ? NT*Nx : 0) + (o.PRhoT ? NT*Nx*Np : 0) + (o.critical ? Nx : 0);
+    const std::size_t Nthreads = static_cast<std::size_t>(std::max(o.Nthreads, static_cast<short>(1)));
+
+    // One AbstractState per thread, built up front so that a bad backend or set of names throws here
+    std::vector<std::shared_ptr<CoolProp::AbstractState> > states;
+    for (std::size_t i = 0; i < Nthreads; ++i) {
+        states.push_back(std::shared_ptr<CoolProp::AbstractState>(CoolProp::AbstractState::factory(o.backend, o.names)));
+    }
+
+    // The points are dealt out round-robin because the cost of a point varies smoothly over the grid
+    std::vector<GeneratedPoint> points(Npoints);
+    std::vector<std::thread> threads;
+    for (std::size_t i = 0; i < Nthreads; ++i) {
+        threads.push_back(std::thread([&, i]() {
+            for (std::size_t j = i; j < Npoints; j += Nthreads) {
+                points[j] = gen_point(*states[i], o, j);
+            }
+        }));
+    }
+    for (auto &t : threads) { t.join(); }
+
+    std::ios::fmtflags flags(os.flags());
+    std::streamsize precision = os.precision();
+    os << std::setprecision(std::numeric_limits<double>::max_digits10);
+    os << "{\"about\": {\"names\": [";
+    std::vector<std::string> names = strsplit(o.names, '&');
+    for (std::size_t i = 0; i < names.size(); ++i) {
+        if (i > 0) { os << ", "; }
+        write_JSON_string(os, names[i]);
+    }
+    os << "]},\n\"data\": [";
+    std::size_t Nwritten = 0;
+    for (auto &pt : points) {
+        if (pt.type == GeneratedPoint::NONE) { continue; }
+        os << (Nwritten > 0 ? ",\n" : "\n");
+        write_point(os, pt, o.BibTeX);
+        Nwritten++;
+    }
+    os << "\n]}\n";
+    os.flags(flags);
+    os.precision(precision);
+    return Nwritten;
+}
+
+std::string gen_data(const gen_data_options &o) {
+    std::ostringstream os;
+    gen_data(o, os);
+    return os.str();
+}
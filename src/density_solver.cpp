@@ -0,0 +1,65 @@
+#include "phifit/density_solver.h"
+
+#include <cmath>
+#include <algorithm>
+
+std::size_t solve_PT_densities(PTDensityBatch &batch, const PTDensityEvaluator &eval, const PTDensitySolverOptions &opts)
+{
+    const std::size_t N = batch.size();
+    std::vector<double> p(N, 0.0), dpdrho(N, 0.0);
+    std::vector<std::size_t> active, still_active;
+    active.reserve(N); still_active.reserve(N);
+    for (std::size_t k = 0; k < N; ++k) {
+        batch.converged[k] = 0;
+        batch.Niter[k] = 0;
+        if (batch.rho[k] > 0 && std::isfinite(batch.rho[k])) { active.push_back(k); }
+    }
+
+    std::size_t Nconverged = 0;
+    // The side of rho_split that each guess is on
+    std::vector<unsigned char> liquid(N, 0);
+    for (std::size_t k : active) { liquid[k] = (batch.rho[k] > batch.rho_split[k]); }
+    for (std::size_t iter = 0; iter < opts.Nmax && !active.empty(); ++iter) {
+        eval(active, batch.rho, p, dpdrho);
+        still_active.clear();
+        for (std::size_t k : active) {
+            batch.Niter[k]++;
+            double rho = batch.rho[k], error = p[k] - batch.p[k];
+            if (!(dpdrho[k] > 0) || !std::isfinite(error)) {
+                // Mechanically unstable or not a number; leave it to the fallback
+                continue;
+            }
+            double step = -error/dpdrho[k];
+            bool done = std::abs(error) <= opts.rtol*std::abs(batch.p[k]) || std::abs(step) <= opts.rtol*rho;
+            // Limit the step so the density stays positive and does not jump between branches
+            step = std::max(std::min(step, opts.max_step*rho), -opts.max_step*rho);
+            batch.rho[k] = rho + step;
+            if (batch.rho_split[k] > 0 && (batch.rho[k] > batch.rho_split[k]) != static_cast<bool>(liquid[k])) {
+                // Crossed over to the root of the other phase; leave it to the fallback
+                continue;
+            }
+            if (done) {
+                batch.converged[k] = 1;
+                Nconverged++;
+            }
+            else {
+                still_active.push_back(k);
+            }
+        }
+        std::swap(active, still_active);
+    }
+    return Nconverged;
+}
+
+PTDensitySolverOptions AdaptiveToleranceOptions::options(double progress, const PTDensitySolverOptions &full) const
+{
+    PTDensitySolverOptions opts = full;
+    if (!enabled || !(rtol_loose > full.rtol)) { return opts; }
+    // A step that has not been taken (or a NaN) counts as no progress yet
+    double rtol = (std::isfinite(progress) && progress >= 0) ? safety*progress : rtol_loose;
+    rtol = std::pow(10.0, std::floor(std::log10(std::min(std::max(rtol, full.rtol), rtol_loose))));
+    opts.rtol = std::max(rtol, full.rtol);
+    double w = std::log(opts.rtol/full.rtol)/std::log(rtol_loose/full.rtol);
+    opts.Nmax = static_cast<std::size_t>(std::round(full.Nmax + w*(static_cast<double>(Nmax_loose) - static_cast<double>(full.Nmax))));
+    return opts;
+}
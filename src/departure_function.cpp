@@ -49,6 +49,11 @@ rapidjson::Value PhiFitDepartureFunction::to_JSON(rapidjson::Document &doc) {
 }
 
 void PhiFitDepartureFunction::update(double tau, double delta)
+{
+    evaluate(tau, delta, derivs);
+}
+
+void PhiFitDepartureFunction::evaluate(double tau, double delta, CoolProp::HelmholtzDerivatives &derivs) const
 {
     derivs.reset(0.0);
 
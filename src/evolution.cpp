@@ -0,0 +1,229 @@
+#include "phifit/evolution.h"
+#include "phifit/worker_pool.h"
+
+// Includes from CoolProp
+#include "AbstractState.h"
+
+// Includes from c++
+#include <random>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+double GeneSpec::normalize(double x) const {
+    if (!integer) { return x; }
+    return std::min(std::max(std::round(x), lower), upper);
+}
+
+std::size_t IndividualLayout::size() const {
+    std::size_t Nu = 0;
+    for (std::size_t dim : u_dims) { Nu += dim; }
+    return 4 + 3*Nterms + 4*Nu;
+}
+
+void IndividualLayout::decode(const std::vector<double> &x, std::vector<double> &betagamma, Coefficients &coeffs) const {
+    if (x.size() != size()) { throw CoolProp::ValueError(fmt::format("Individual has %d genes; the layout needs %d", x.size(), size())); }
+    std::vector<double>::const_iterator it = x.begin();
+    betagamma.assign(it, it + 4); it += 4;
+    coeffs.n.assign(it, it + Nterms); it += Nterms;
+    coeffs.t.assign(it, it + Nterms); it += Nterms;
+    coeffs.d.assign(it, it + Nterms); it += Nterms;
+    std::vector<std::vector<double> > *u[] = { &coeffs.ldelta, &coeffs.cdelta, &coeffs.ltau, &coeffs.ctau };
+    for (std::size_t k = 0; k < 4; ++k) {
+        u[k]->clear();
+        for (std::size_t dim : u_dims) {
+            u[k]->push_back(std::vector<double>(it, it + dim));
+            it += dim;
+        }
+    }
+}
+
+namespace {
+
+/// The fitness of one individual
+double fitness(CoeffFitClass &cfc, const EvolutionOptions &o, const std::vector<double> &x) {
+    try {
+        std::vector<double> betagamma;
+        Coefficients coeffs;
+        o.layout.decode(x, betagamma, coeffs);
+        cfc.setup(coeffs);
+        // Duplicates are common (elitism, and the integer genes), so go through the memo
+        double err = cfc.evaluate_sum_of_squares(betagamma, o.Nthreads);
+        return std::isnan(err) ? o.nan_fitness : err;
+    }
+    catch (...) {
+        return o.failed_fitness;
+    }
+}
+
+/// Tournament selection with replacement, as tools.selTournament
+std::vector<EvolutionIndividual> select_tournament(const std::vector<EvolutionIndividual> &pop, std::size_t k, std::size_t tournsize, std::mt19937_64 &rng) {
+    std::uniform_int_distribution<std::size_t> pick(0, pop.size() - 1);
+    std::vector<EvolutionIndividual> chosen;
+    for (std::size_t i = 0; i < k; ++i) {
+        std::size_t best = pick(rng);
+        for (std::size_t j = 1; j < tournsize; ++j) {
+            std::size_t other = pick(rng);
+            if (pop[other].fitness < pop[best].fitness) { best = other; }
+        }
+        chosen.push_back(pop[best]);
+    }
+    return chosen;
+}
+
+/// The blend crossover of myBlend
+void blend(std::vector<double> &x1, std::vector<double> &x2, const EvolutionOptions &o, std::mt19937_64 &rng) {
+    std::uniform_real_distribution<double> U(0, 1);
+    for (std::size_t i = 0; i < x1.size(); ++i) {
+        double gamma = (1 + 2*o.alpha)*U(rng) - o.alpha;
+        double a = x1[i], b = x2[i];
+        x1[i] = o.genes[i].normalize((1 - gamma)*a + gamma*b);
+        x2[i] = o.genes[i].normalize(gamma*a + (1 - gamma)*b);
+    }
+}
+
+/// The Gaussian mutation of myMutateGaussian with indpb = 1; as there, the normalizing function is applied to the perturbation
+void mutate(std::vector<double> &x, const EvolutionOptions &o, std::mt19937_64 &rng) {
+    for (std::size_t i = 0; i < x.size(); ++i) {
+        std::normal_distribution<double> N(o.mu, o.genes[i].sigma);
+        x[i] += o.genes[i].normalize(N(rng));
+    }
+}
+
+/// Keep the best Nhof distinct individuals, as tools.HallOfFame
+void update_hall_of_fame(std::vector<EvolutionIndividual> &hof, const std::vector<EvolutionIndividual> &pop, std::size_t Nhof) {
+    for (const EvolutionIndividual &ind : pop) {
+        if (hof.size() >= Nhof && !(ind.fitness < hof.back().fitness)) { continue; }
+        bool seen = false;
+        for (const EvolutionIndividual &h : hof) {
+            if (h.x == ind.x) { seen = true; break; }
+        }
+        if (seen) { continue; }
+        std::vector<EvolutionIndividual>::iterator it = std::upper_bound(hof.begin(), hof.end(), ind,
+            [](const EvolutionIndividual &a, const EvolutionIndividual &b) { return a.fitness < b.fitness; });
+        hof.insert(it, ind);
+        if (hof.size() > Nhof) { hof.pop_back(); }
+    }
+}
+
+}
+
+EvolutionResult evolve(CoeffFitClass &cfc, const EvolutionOptions &o) {
+    const std::size_t Ngenes = o.layout.size();
+    if (o.genes.size() != Ngenes) { throw CoolProp::ValueError(fmt::format("%d gene specifications were given; the layout needs %d", o.genes.size(), Ngenes)); }
+    if (o.Nindividuals < 2 && o.population.empty()) { throw CoolProp::ValueError("At least two individuals are needed"); }
+    std::mt19937_64 rng(o.seed);
+    std::uniform_real_distribution<double> U(0, 1);
+
+    // Each worker evaluates with its own fitter; quarantine would make the fitness depend on the history of the worker
+    const std::size_t Nworkers = std::max(o.Nworkers, static_cast<std::size_t>(1));
+    QuarantinePolicy no_quarantine;
+    no_quarantine.max_failures = 0;
+    std::vector<std::shared_ptr<CoeffFitClass> > fitters;
+    for (std::size_t i = 0; i < Nworkers; ++i) {
+        fitters.push_back(cfc.clone());
+        fitters.back()->set_quarantine_policy(no_quarantine);
+    }
+    WorkerPool pool(Nworkers);
+
+    // Evaluate the individuals whose fitness is not valid; they are handed out one at a time since their costs differ
+    auto evaluate = [&](std::vector<EvolutionIndividual> &pop) -> std::size_t {
+        std::vector<std::size_t> invalid;
+        for (std::size_t i = 0; i < pop.size(); ++i) {
+            if (!pop[i].valid) { invalid.push_back(i); }
+        }
+        std::atomic<std::size_t> next(0);
+        std::vector<double> busy;
+        pool.run([&](std::size_t worker) {
+            for (std::size_t j = next++; j < invalid.size(); j = next++) {
+                EvolutionIndividual &ind = pop[invalid[j]];
+                ind.fitness = fitness(*fitters[worker], o, ind.x);
+                ind.valid = true;
+            }
+        }, busy);
+        return invalid.size();
+    };
+    auto record = [&](std::size_t gen, std::size_t Nevals, double elapsed, const std::vector<EvolutionIndividual> &pop) {
+        EvolutionGeneration g;
+        g.gen = gen; g.Nevals = Nevals; g.elapsed_sec = elapsed;
+        double sum = 0, sum2 = 0;
+        g.min_fitness = pop[0].fitness;
+        for (const EvolutionIndividual &ind : pop) {
+            g.min_fitness = std::min(g.min_fitness, ind.fitness);
+            sum += ind.fitness; sum2 += ind.fitness*ind.fitness;
+        }
+        double mean = sum/pop.size();
+        g.stddev_fitness = std::sqrt(std::max(sum2/pop.size() - mean*mean, 0.0));
+        if (o.callback) { o.callback(g, pop); }
+        return g;
+    };
+
+    EvolutionResult result;
+    std::vector<EvolutionIndividual> &pop = result.population;
+    auto startTime = std::chrono::high_resolution_clock::now();
+    if (!o.population.empty()) {
+        for (const std::vector<double> &x : o.population) {
+            if (x.size() != Ngenes) { throw CoolProp::ValueError("An individual of the starting population does not match the layout"); }
+            EvolutionIndividual ind; ind.x = x;
+            pop.push_back(ind);
+        }
+    }
+    else {
+        for (std::size_t i = 0; i < o.Nindividuals; ++i) {
+            EvolutionIndividual ind;
+            for (const GeneSpec &g : o.genes) {
+                if (g.integer) {
+                    std::uniform_int_distribution<long> R(static_cast<long>(g.lower), static_cast<long>(g.upper));
+                    ind.x.push_back(static_cast<double>(R(rng)));
+                }
+                else {
+                    ind.x.push_back(g.lower + (g.upper - g.lower)*U(rng));
+                }
+            }
+            pop.push_back(ind);
+        }
+    }
+    // The densities are solved for loosely while the best fitness is still falling quickly
+    auto adapt_tolerance = [&](double progress) {
+        for (auto &fitter : fitters) { fitter->adapt_solver_tolerance(progress); }
+    };
+    adapt_tolerance(std::numeric_limits<double>::infinity());
+    std::size_t Nevals = evaluate(pop);
+    update_hall_of_fame(result.hall_of_fame, pop, o.Nhof);
+    result.log.push_back(record(0, Nevals, std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count(), pop));
+
+    for (std::size_t gen = 1; gen <= o.Ngenerations; ++gen) {
+        startTime = std::chrono::high_resolution_clock::now();
+        std::vector<EvolutionIndividual> offspring = select_tournament(pop, pop.size(), o.tournsize, rng);
+
+        // varAnd: blend consecutive pairs, then mutate, invalidating the fitness of whatever changed
+        for (std::size_t i = 1; i < offspring.size(); i += 2) {
+            if (U(rng) < o.cxpb) {
+                blend(offspring[i - 1].x, offspring[i].x, o, rng);
+                offspring[i - 1].valid = false;
+                offspring[i].valid = false;
+            }
+        }
+        for (EvolutionIndividual &ind : offspring) {
+            if (U(rng) < o.mutpb) {
+                mutate(ind.x, o, rng);
+                ind.valid = false;
+            }
+        }
+        Nevals = evaluate(offspring);
+        update_hall_of_fame(result.hall_of_fame, offspring, o.Nhof);
+        pop.swap(offspring);
+        result.log.push_back(record(gen, Nevals, std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count(), pop));
+        const double previous = result.log[result.log.size() - 2].min_fitness, current = result.log.back().min_fitness;
+        adapt_tolerance(std::abs(previous - current)/std::max(current, std::numeric_limits<double>::min()));
+    }
+    // Polish: the hall of fame is evaluated again at full precision
+    adapt_tolerance(0);
+    for (EvolutionIndividual &ind : result.hall_of_fame) { ind.valid = false; }
+    evaluate(result.hall_of_fame);
+    std::stable_sort(result.hall_of_fame.begin(), result.hall_of_fame.end(),
+        [](const EvolutionIndividual &a, const EvolutionIndividual &b) { return a.fitness < b.fitness; });
+    return result;
+}
@@ -21,10 +21,23 @@
 // Includes from c++
 #include <iostream>
 #include <chrono>
+#include <thread>
+#include <mutex>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <set>
 
 // Includes from phifit
 #include "phifit/fitter.h"
 #include "phifit/departure_function.h"
+#include "phifit/checkpoint.h"
+#include "phifit/telemetry.h"
+#include "phifit/density_solver.h"
+#include "phifit/process_shards.h"
+#include "phifit/quarantine.h"
+#include "phifit/prepare.h"
 
 using namespace NISTfit;
 
@@ -44,9 +57,61 @@ public:
 class PhiFitOutput : public NumericOutput {
 protected:
     std::string m_error_message;
+    PointTelemetry m_telemetry;
+    PointQuarantine m_quarantine;
+    const QuarantinePolicy *m_quarantine_policy; ///< Owned by the evaluator; nullptr to never quarantine
+    PhiFitOutput *m_companion; ///< The output holding another residual of the same data point, filled in by the evaluation of this output
+    bool m_is_companion; ///< True if this output is filled in by the evaluation of another output, and is never evaluated by itself
+    /// The calculated value given to a point that failed
+    double penalty() { return (m_quarantine_policy != nullptr) ? m_quarantine_policy->penalty : 10000; }
+    /// Record that a flash calculation of the given type has been carried out
+    void record_flash(PhiFitFlashType type) { m_telemetry.Nflash[type]++; m_telemetry.last_flash = type; }
 public:
-    PhiFitOutput(const std::shared_ptr<NumericInput> &in) : NumericOutput(in) {};
+    PhiFitOutput(const std::shared_ptr<NumericInput> &in) : NumericOutput(in), m_quarantine_policy(nullptr), m_companion(nullptr), m_is_companion(false) {};
     virtual void to_JSON(rapidjson::Value &, rapidjson::Document &) = 0;
+    /// The name of the type of data point, as in the input JSON data
+    virtual const char *type_name() = 0;
+    /// Do the calculation for this data point; any exception thrown is handled by exception_handler
+    virtual void evaluate_point() = 0;
+    /**
+     A new output for the same data point, sharing its input and the quantities computed when it was loaded, that
+     does its calculations with HEOS (which must outlive it), so that the point can be evaluated by another evaluator
+     at the same time; nothing of the evaluations of this output is carried over
+     */
+    virtual std::shared_ptr<NumericOutput> replicate(CoolProp::HelmholtzEOSMixtureBackend *HEOS) = 0;
+    /// Do the calculation, keeping track of the time spent and any failures
+    void evaluate_one() {
+        // Filled in by the output it accompanies
+        if (m_is_companion) { return; }
+        const std::vector<double> &c = get_AbstractEvaluator()->get_const_coefficients();
+        if (m_quarantine_policy != nullptr && m_quarantine.skip(*m_quarantine_policy, c)) {
+            // Don't pay for another failure; the point keeps the error message of its last failure
+            m_y_calc = penalty();
+            resize(c.size());
+            std::fill(Jacobian_row.begin(), Jacobian_row.end(), 0.0);
+            m_telemetry.Nskipped++;
+            if (m_companion != nullptr) { m_companion->set_failed(m_error_message, c.size(), true); }
+            return;
+        }
+        auto startTime = std::chrono::high_resolution_clock::now();
+        m_error_message.clear();
+        try {
+            evaluate_point();
+        }
+        catch (...) {
+            exception_handler();
+        }
+        if (m_quarantine_policy != nullptr) {
+            m_quarantine.record(*m_quarantine_policy, !m_error_message.empty(), c);
+        }
+        if (m_companion != nullptr && !m_error_message.empty()) {
+            m_companion->set_failed(m_error_message, c.size(), m_quarantine.quarantined);
+        }
+        double elapsed = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+        m_telemetry.Nevals++;
+        m_telemetry.elapsed_sec += elapsed;
+        m_telemetry.max_sec = std::max(m_telemetry.max_sec, elapsed);
+    }
     /// On any exception, set the error value
     void exception_handler(){
         try{
@@ -55,16 +120,96 @@ public:
         }
         catch(std::exception &e){
             m_error_message = e.what();
-            m_y_calc = 10000;
+            m_y_calc = penalty();
         }
         catch(...){
             // Set the error value
             m_error_message = "Undefined error";
-            m_y_calc = 10000;
+            m_y_calc = penalty();
         }
+        m_telemetry.Nexceptions++;
+        m_telemetry.last_error = m_error_message;
     };
     /// Return the stored error message
     std::string error_message(){ return m_error_message; };
+    /// Return the counters accumulated over the evaluations of this data point
+    const PointTelemetry &telemetry() { return m_telemetry; }
+    /// Reset the counters
+    void reset_telemetry() { m_telemetry = PointTelemetry(); }
+    /// Add the counters of evaluations carried out elsewhere (in a worker process, for instance)
+    void add_telemetry(const PointTelemetry &t) { m_telemetry.add(t); }
+    /// The BibTeX key of the data point
+    std::string get_BibTeX() { return static_cast<PhiFitInput*>(m_in.get())->get_BibTeX(); }
+    /// The calculated value of the last evaluation
+    double y_calc() { return m_y_calc; }
+    /// Use the policy (which must outlive the output) to decide when to stop evaluating this point after failures
+    void set_quarantine_policy(const QuarantinePolicy *policy) { m_quarantine_policy = policy; }
+    /// The quarantine state of the point
+    const PointQuarantine &quarantine() { return m_quarantine; }
+    /// Let the point be evaluated again, and forget its failures
+    void release_quarantine() { m_quarantine = PointQuarantine(); }
+    /// Install the result of an evaluation that was carried out elsewhere (in a worker process, for instance)
+    void set_result(double y_calc, const double *J, std::size_t N, const std::string &error, bool quarantined = false) {
+        m_y_calc = y_calc;
+        m_quarantine.quarantined = quarantined;
+        if (Jacobian_row.size() != N) { resize(N); }
+        std::copy(J, J + N, Jacobian_row.begin());
+        m_error_message = error;
+    }
+    /// Give the point the penalty value and a zero Jacobian row of length N
+    void set_failed(const std::string &error, std::size_t N, bool quarantined) {
+        m_y_calc = penalty();
+        m_quarantine.quarantined = quarantined;
+        if (Jacobian_row.size() != N) { resize(N); }
+        std::fill(Jacobian_row.begin(), Jacobian_row.end(), 0.0);
+        m_error_message = error;
+    }
+    /// Let the evaluation of this output also fill in the residual held by other, which must come right after this output
+    void set_companion(PhiFitOutput *other) { m_companion = other; other->m_is_companion = true; }
+    /// True if this output is filled in by the evaluation of the output before it
+    bool is_companion() { return m_is_companion; }
+};
+
+/// The gas constant of the mixture at composition z, as the AbstractState itself gives it (J/mol/K); sets the mole fractions of HEOS
+inline double mixture_gas_constant(CoolProp::HelmholtzEOSMixtureBackend &HEOS, const std::vector<double> &z) {
+    HEOS.set_mole_fractions(z);
+    return HEOS.gas_constant();
+}
+
+/// Quantities of a data point that do not depend on the coefficients, computed once when the data are loaded
+struct PointInvariants {
+    double T, ///< Temperature (K)
+           inv_T, ///< 1/T (1/K)
+           inv_rho; ///< 1/rho of the experimental density, or NaN if there is none (m^3/mol)
+    double RT[2]; ///< Gas constant of the mixture times temperature for each phase (J/mol)
+    double Tc[2], ///< Critical temperatures of the pure components (K)
+           rhoc[2]; ///< Critical molar densities of the pure components (mol/m^3)
+    double w[2][2]; ///< w[phase][k] = delta_ik - z_k, the weights of the sum that gives n*d(.)/dn_i from the d(.)/dx_k
+    PointInvariants() : T(0), inv_T(0), inv_rho(0) {
+        for (std::size_t k = 0; k < 2; ++k) { RT[k] = 0; Tc[k] = 0; rhoc[k] = 0; w[0][k] = 0; w[1][k] = 0; }
+    };
+    /**
+     @param HEOS The AbstractState of the point, for the pure fluid constants
+     @param T Temperature in K
+     @param rhomolar Experimental molar density in mol/m^3 (or a negative value if there is none)
+     @param phases The compositions of (up to two) phases
+     @param i The index of the component whose derivatives with respect to mole numbers are needed
+     @note The mole fractions of HEOS are left at those of the last phase
+     */
+    PointInvariants(CoolProp::HelmholtzEOSMixtureBackend &HEOS, double T, double rhomolar, const std::vector<std::vector<double> > &phases, std::size_t i) 
+        : T(T), inv_T(1/T), inv_rho(rhomolar > 0 ? 1/rhomolar : std::numeric_limits<double>::quiet_NaN()) {
+        for (std::size_t k = 0; k < 2; ++k) {
+            Tc[k] = HEOS.get_fluid_constant(k, CoolProp::iT_critical);
+            rhoc[k] = HEOS.get_fluid_constant(k, CoolProp::irhomolar_critical);
+        }
+        for (std::size_t phase = 0; phase < 2; ++phase) {
+            // Taken from the AbstractState so that it is the same R as in the pressures and chemical potentials it computes
+            RT[phase] = (phase < phases.size()) ? mixture_gas_constant(HEOS, phases[phase])*T : 0;
+            for (std::size_t k = 0; k < 2; ++k) {
+                w[phase][k] = (phase < phases.size()) ? ((k == i) ? 1.0 : 0.0) - phases[phase][k] : 0.0;
+            }
+        }
+    };
 };
 
 /// The data structure used to hold an input to Levenberg-Marquadt fitter for parallel evaluation
@@ -114,21 +259,55 @@ private:
     PTXYInput *PTXY_in;
     CoolProp::HelmholtzEOSMixtureBackend *HEOS;
     CoolProp::GERG2008ReducingFunction *GERG;
+    PointInvariants m_inv; ///< Liquid is phase 0, vapor is phase 1; the weights are those of component 0
+    PointInvariants m_inv1; ///< The same, with the weights of component 1
+    double m_rho_solved[2]; ///< Densities of the phases from the batched density solver, or -1 if there are none
+    double m_dmu1; ///< mu_1/RT of the vapor less that of the liquid, at the phase states of the last call to evaluate()
+    bool m_flashed; ///< True if the phases of HEOS hold the states found by the last evaluation
 public:
     PTXYOutput(const std::shared_ptr<NumericInput> &in)
-        : PhiFitOutput(in), previous_error(1e90) {
+        : PhiFitOutput(in), previous_error(1e90), m_dmu1(0), m_flashed(false) {
+            m_rho_solved[0] = -1; m_rho_solved[1] = -1;
             // Cast base class pointers to the derived type(s) so we can access their attributes
             PTXY_in = static_cast<PTXYInput*>(m_in.get());
             HEOS = static_cast<CoolProp::HelmholtzEOSMixtureBackend*>(PTXY_in->get_AS().get());
             GERG = static_cast<CoolProp::GERG2008ReducingFunction*>(HEOS->Reducing.get());
+            std::vector<std::vector<double> > phases = { PTXY_in->x(), PTXY_in->y() };
+            m_inv = PointInvariants(*HEOS, PTXY_in->T(), -1, phases, 0);
+            m_inv1 = PointInvariants(*HEOS, PTXY_in->T(), -1, phases, 1);
         };
+    /// With the invariants already computed, and HEOS in place of the AbstractState of the input
+    PTXYOutput(const std::shared_ptr<NumericInput> &in, CoolProp::HelmholtzEOSMixtureBackend *HEOS, const PointInvariants &inv, const PointInvariants &inv1)
+        : PhiFitOutput(in), previous_error(1e90), HEOS(HEOS), m_inv(inv), m_inv1(inv1), m_dmu1(0), m_flashed(false) {
+            m_rho_solved[0] = -1; m_rho_solved[1] = -1;
+            PTXY_in = static_cast<PTXYInput*>(m_in.get());
+            GERG = static_cast<CoolProp::GERG2008ReducingFunction*>(HEOS->Reducing.get());
+        };
+    std::shared_ptr<NumericOutput> replicate(CoolProp::HelmholtzEOSMixtureBackend *HEOS) {
+        return std::shared_ptr<NumericOutput>(new PTXYOutput(m_in, HEOS, m_inv, m_inv1));
+    }
 
     /// Return the error
     double get_error() { return m_y_calc; };
+    /// Return the input, which holds the cached densities
+    PTXYInput *get_PTXY_input() { return PTXY_in; }
+    const char *type_name() { return "PTXY"; }
+    /// Get the molar composition of the phase (0: liquid, 1: vapor)
+    const std::vector<double> &z(std::size_t phase) { return (phase == 0) ? PTXY_in->x() : PTXY_in->y(); }
+    /// Get the guess value for the density of the phase (0: liquid, 1: vapor)
+    double rho_guess(std::size_t phase) { return (phase == 0) ? PTXY_in->rhoL() : PTXY_in->rhoV(); }
+    /// Get the gas constant times temperature of the phase (J/mol)
+    double RT(std::size_t phase) { return m_inv.RT[phase]; }
+    /// Set the density of the phase found by the batched density solver; it is used (once) by the next evaluation
+    void set_solved_density(std::size_t phase, double rhomolar) { m_rho_solved[phase] = rhomolar; }
+    /// The density of the phase (0: liquid, 1: vapor) found by the last evaluation, or -1 if it failed before its flashes were done
+    double flashed_density(std::size_t phase) {
+        if (!m_flashed) { return -1; }
+        return (phase == 0) ? HEOS->SatL->rhomolar() : HEOS->SatV->rhomolar();
+    }
 
     // Do the calculation
-    void evaluate_one() {
-        m_error_message.clear();
+    void evaluate_point() {
         const bool update_densities = false;
         const double weight = 0.01;
 
@@ -142,13 +321,15 @@ public:
         if (JtempV.size() != N) { JtempV.resize(N); }
 
         // Evaluate the residual at given coefficients
+        m_flashed = false;
         m_y_calc = weight*evaluate(c);
+        m_flashed = true;
 
         std::size_t i = 0;
         evaluate_mu0_over_RT_derivatives(HEOS->SatL.get(), PTXY_in->x(), i, JtempL);
-        evaluate_mur_over_RT_derivatives(HEOS->SatL.get(), PTXY_in->x(), i, JtempL);
+        evaluate_mur_over_RT_derivatives(HEOS->SatL.get(), PTXY_in->x(), m_inv.w[0], i, JtempL);
         evaluate_mu0_over_RT_derivatives(HEOS->SatV.get(), PTXY_in->y(), i, JtempV);
-        evaluate_mur_over_RT_derivatives(HEOS->SatV.get(), PTXY_in->y(), i, JtempV);
+        evaluate_mur_over_RT_derivatives(HEOS->SatV.get(), PTXY_in->y(), m_inv.w[1], i, JtempV);
         
         for (std::size_t i = 0; i < c.size(); ++i) {
             // Numerical derivatives for checking purposes
@@ -157,6 +338,17 @@ public:
 
             Jacobian_row[i] = weight*(JtempV[i] - JtempL[i]);
         }
+
+        if (m_companion != nullptr) {
+            // The equality of the chemical potentials of component 1 comes from the same phase states, no flash is needed
+            std::size_t k = 1;
+            evaluate_mu0_over_RT_derivatives(HEOS->SatL.get(), PTXY_in->x(), k, JtempL);
+            evaluate_mur_over_RT_derivatives(HEOS->SatL.get(), PTXY_in->x(), m_inv1.w[0], k, JtempL);
+            evaluate_mu0_over_RT_derivatives(HEOS->SatV.get(), PTXY_in->y(), k, JtempV);
+            evaluate_mur_over_RT_derivatives(HEOS->SatV.get(), PTXY_in->y(), m_inv1.w[1], k, JtempV);
+            for (std::size_t j = 0; j < N; ++j) { JtempV[j] = weight*(JtempV[j] - JtempL[j]); }
+            m_companion->set_result(weight*m_dmu1, &(JtempV[0]), N, "");
+        }
         
         // Update the densities if requested and the error is less than the previous value
         // that resulted in the densities being cached
@@ -171,12 +363,17 @@ public:
         
         // Calculate the chemical potentials for liquid and vapor phases
         std::size_t i = 0;
-        double muL = mu_over_RT(HEOS->SatL.get(), c, PTXY_in->x(), i, PTXY_in->rhoL());
-        double muV = mu_over_RT(HEOS->SatV.get(), c, PTXY_in->y(), i, PTXY_in->rhoV());
+        double muL = mu_over_RT(HEOS->SatL.get(), c, PTXY_in->x(), i, m_inv.RT[0], PTXY_in->rhoL(), m_rho_solved[0]);
+        double muV = mu_over_RT(HEOS->SatV.get(), c, PTXY_in->y(), i, m_inv.RT[1], PTXY_in->rhoV(), m_rho_solved[1]);
+        // The solved densities belong to the coefficients of this pass only
+        m_rho_solved[0] = -1; m_rho_solved[1] = -1;
+        if (m_companion != nullptr) {
+            m_dmu1 = HEOS->SatV->chemical_potential(1)/m_inv.RT[1] - HEOS->SatL->chemical_potential(1)/m_inv.RT[0];
+        }
         
         return muV - muL;
     }
-    double mu_over_RT(CoolProp::HelmholtzEOSMixtureBackend *HEOS, const std::vector<double> &c, const std::vector<double> &z, std::size_t i, double rhomolar_guess = -1) {
+    double mu_over_RT(CoolProp::HelmholtzEOSMixtureBackend *HEOS, const std::vector<double> &c, const std::vector<double> &z, std::size_t i, double RT, double rhomolar_guess = -1, double rhomolar_solved = -1) {
         
         GERG->set_binary_interaction_double(0,1,c[0],c[1],c[2],c[3]);
         
@@ -184,43 +381,55 @@ public:
         PTXYInput *in = static_cast<PTXYInput*>(m_in.get());
 
         HEOS->set_mole_fractions(z);
-        if (rhomolar_guess < 0) {
+        if (rhomolar_solved > 0) {
+            // The density has already been found by the batched solver, no iteration is needed
+            record_flash(FLASH_BATCH_PT);
+            HEOS->update_DmolarT_direct(rhomolar_solved, in->T());
+        }
+        else if (rhomolar_guess < 0) {
             // Global PT flash (expensive!)
+            record_flash(FLASH_GLOBAL_PT);
             HEOS->update(CoolProp::PT_INPUTS, in->p(), in->T());
         }
         else {
             // Local PT flash, starting from given density
+            record_flash(FLASH_LOCAL_PT);
             HEOS->update_TP_guessrho(in->T(), in->p(), rhomolar_guess);
         }
 
-        return HEOS->chemical_potential(i)/(HEOS->gas_constant()*HEOS->T());
+        return HEOS->chemical_potential(i)/RT;
     }
     void evaluate_mu0_over_RT_derivatives(CoolProp::HelmholtzEOSMixtureBackend *HEOS, const std::vector<double> &z, std::size_t i, std::vector<double> & buffer) {
 
         // Zero out the buffer
         buffer[0] = 0; buffer[1] = 0; buffer[2] = 0; buffer[3] = 0;
 
-        double dtau_dbetaT__constTP = GERG->dTr_dbetaT(z) / HEOS->T();
-        double dtau_dgammaT__constTP = GERG->dTr_dgammaT(z) / HEOS->T();
+        // Fetch each of the values at the current state once
+        const double delta = HEOS->delta(), tau = HEOS->tau(), rhor = HEOS->rhomolar_reducing(), Tr = HEOS->T_reducing();
+        const double dalphar_dDelta = HEOS->dalphar_dDelta(), d2alphar_dDelta2 = HEOS->d2alphar_dDelta2(), d2alphar_dDelta_dTau = HEOS->d2alphar_dDelta_dTau();
+        const double dTr_dbetaT = GERG->dTr_dbetaT(z), dTr_dgammaT = GERG->dTr_dgammaT(z);
+        const double drhor_dbetaV = GERG->drhormolar_dbetaV(z), drhor_dgammaV = GERG->drhormolar_dgammaV(z);
+        const double denominator = 1 + 2*delta*dalphar_dDelta + POW2(delta)*d2alphar_dDelta2;
 
-        double ddelta_dbetaT__constTP = -POW2(HEOS->delta())*HEOS->d2alphar_dDelta_dTau()*dtau_dbetaT__constTP / (1 + 2 * HEOS->delta()*HEOS->dalphar_dDelta() + POW2(HEOS->delta())*HEOS->d2alphar_dDelta2());
-        double ddelta_dgammaT__constTP = -POW2(HEOS->delta())*HEOS->d2alphar_dDelta_dTau()*dtau_dgammaT__constTP / (1 + 2 * HEOS->delta()*HEOS->dalphar_dDelta() + POW2(HEOS->delta())*HEOS->d2alphar_dDelta2());
-        double ddelta_dbetaV__constTP = -HEOS->delta()*(1 + HEOS->delta()*HEOS->dalphar_dDelta())*GERG->drhormolar_dbetaV(z) / (HEOS->rhomolar_reducing()*(1 + 2 * HEOS->delta()*HEOS->dalphar_dDelta() + POW2(HEOS->delta())*HEOS->d2alphar_dDelta2()));
-        double ddelta_dgammaV__constTP = -HEOS->delta()*(1 + HEOS->delta()*HEOS->dalphar_dDelta())*GERG->drhormolar_dgammaV(z) / (HEOS->rhomolar_reducing()*(1 + 2 * HEOS->delta()*HEOS->dalphar_dDelta() + POW2(HEOS->delta())*HEOS->d2alphar_dDelta2()));
+        double dtau_dbetaT__constTP = dTr_dbetaT*m_inv.inv_T;
+        double dtau_dgammaT__constTP = dTr_dgammaT*m_inv.inv_T;
 
-        double rhor = HEOS->rhomolar_reducing();
-        double rhoci = HEOS->get_fluid_constant(i, CoolProp::irhomolar_critical);
-        double delta_oi = HEOS->delta()*rhor/rhoci;
+        double ddelta_dbetaT__constTP = -POW2(delta)*d2alphar_dDelta_dTau*dtau_dbetaT__constTP/denominator;
+        double ddelta_dgammaT__constTP = -POW2(delta)*d2alphar_dDelta_dTau*dtau_dgammaT__constTP/denominator;
+        double ddelta_dbetaV__constTP = -delta*(1 + delta*dalphar_dDelta)*drhor_dbetaV/(rhor*denominator);
+        double ddelta_dgammaV__constTP = -delta*(1 + delta*dalphar_dDelta)*drhor_dgammaV/(rhor*denominator);
+
+        double rhoci = m_inv.rhoc[i];
+        double delta_oi = delta*rhor/rhoci;
         double ddelta_oi_ddelta = rhor/rhoci;
-        double ddeltaoi_dbetaV__consttaudelta = HEOS->delta()/rhoci*GERG->drhormolar_dbetaV(z);
-        double ddeltaoi_dgammaV__consttaudelta = HEOS->delta()/rhoci*GERG->drhormolar_dgammaV(z);
+        double ddeltaoi_dbetaV__consttaudelta = delta/rhoci*drhor_dbetaV;
+        double ddeltaoi_dgammaV__consttaudelta = delta/rhoci*drhor_dgammaV;
         
-        double Tr = HEOS->T_reducing();
-        double Tci = HEOS->get_fluid_constant(i, CoolProp::iT_critical);
-        double tau_oi = HEOS->tau()*Tci/Tr;
+        double Tci = m_inv.Tc[i];
+        double tau_oi = tau*Tci/Tr;
         double dtau_oi_dtau = Tci/Tr; 
-        double dtauoi_dbetaT__consttaudelta = -HEOS->tau()*Tci/POW2(Tr)*GERG->dTr_dbetaT(z);
-        double dtauoi_dgammaT__consttaudelta = -HEOS->tau()*Tci/POW2(Tr)*GERG->dTr_dgammaT(z);
+        double dtauoi_dbetaT__consttaudelta = -tau*Tci/POW2(Tr)*dTr_dbetaT;
+        double dtauoi_dgammaT__consttaudelta = -tau*Tci/POW2(Tr)*dTr_dgammaT;
         
         double dalpha0oi_ddeltaoi = HEOS->get_components()[i].EOS().alpha0.dDelta(tau_oi, delta_oi);
         double dY0_ddelta__consttau = dalpha0oi_ddeltaoi*ddelta_oi_ddelta;
@@ -239,47 +448,46 @@ public:
         buffer[2] = dY0_ddelta__consttau*ddelta_dbetaV__constTP                                               + dY0_dbetaV_constdeltatau;
         buffer[3] = dY0_ddelta__consttau*ddelta_dgammaV__constTP                                              + dY0_dgammaV_constdeltatau;
     }
-    void evaluate_mur_over_RT_derivatives(CoolProp::HelmholtzEOSMixtureBackend *HEOS, const std::vector<double> &z, std::size_t i, std::vector<double> & buffer){
+    /// The weights w[k] = delta_ik - z_k of the phase come from the point invariants
+    void evaluate_mur_over_RT_derivatives(CoolProp::HelmholtzEOSMixtureBackend *HEOS, const std::vector<double> &z, const double *w, std::size_t i, std::vector<double> & buffer){
 
         // ----
         // Buffer already partially filled from ideal-gas contribution
         // ----
 
-        double rhor = HEOS->rhomolar_reducing();
-        double Tr = HEOS->T_reducing();
+        // Fetch each of the values at the current state once
+        const double delta = HEOS->delta(), tau = HEOS->tau(), rhor = HEOS->rhomolar_reducing(), Tr = HEOS->T_reducing();
+        const double dalphar_dDelta = HEOS->dalphar_dDelta(), d2alphar_dDelta2 = HEOS->d2alphar_dDelta2(), d2alphar_dDelta_dTau = HEOS->d2alphar_dDelta_dTau();
+        const double dTr_dbetaT = GERG->dTr_dbetaT(z), dTr_dgammaT = GERG->dTr_dgammaT(z);
+        const double drhor_dbetaV = GERG->drhormolar_dbetaV(z), drhor_dgammaV = GERG->drhormolar_dgammaV(z);
+        const double denominator = 1 + 2*delta*dalphar_dDelta + POW2(delta)*d2alphar_dDelta2;
 
-        double dY_ddelta__consttau = HEOS->dalphar_dDelta() + CoolProp::MixtureDerivatives::d_ndalphardni_dDelta(*HEOS, i, CoolProp::XN_INDEPENDENT);
+        double dY_ddelta__consttau = dalphar_dDelta + CoolProp::MixtureDerivatives::d_ndalphardni_dDelta(*HEOS, i, CoolProp::XN_INDEPENDENT);
         double dY_dtau__constdelta = HEOS->dalphar_dTau() + CoolProp::MixtureDerivatives::d_ndalphardni_dTau(*HEOS, i, CoolProp::XN_INDEPENDENT);
 
-        double dtau_dbetaT__constTP = GERG->dTr_dbetaT(z) / HEOS->T();
-        double dtau_dgammaT__constTP = GERG->dTr_dgammaT(z) / HEOS->T();
+        double dtau_dbetaT__constTP = dTr_dbetaT*m_inv.inv_T;
+        double dtau_dgammaT__constTP = dTr_dgammaT*m_inv.inv_T;
 
-        double ddelta_dbetaT__constTP = -POW2(HEOS->delta())*HEOS->d2alphar_dDelta_dTau()*dtau_dbetaT__constTP/(1 + 2 * HEOS->delta()*HEOS->dalphar_dDelta() + POW2(HEOS->delta())*HEOS->d2alphar_dDelta2());
-        double ddelta_dgammaT__constTP = -POW2(HEOS->delta())*HEOS->d2alphar_dDelta_dTau()*dtau_dgammaT__constTP/(1 + 2 * HEOS->delta()*HEOS->dalphar_dDelta() + POW2(HEOS->delta())*HEOS->d2alphar_dDelta2());
-        double ddelta_dbetaV__constTP = -HEOS->delta()*(1 + HEOS->delta()*HEOS->dalphar_dDelta())*GERG->drhormolar_dbetaV(z) / (HEOS->rhomolar_reducing()*(1 + 2 * HEOS->delta()*HEOS->dalphar_dDelta() + POW2(HEOS->delta())*HEOS->d2alphar_dDelta2()));
-        double ddelta_dgammaV__constTP = -HEOS->delta()*(1 + HEOS->delta()*HEOS->dalphar_dDelta())*GERG->drhormolar_dgammaV(z) / (HEOS->rhomolar_reducing()*(1 + 2 * HEOS->delta()*HEOS->dalphar_dDelta() + POW2(HEOS->delta())*HEOS->d2alphar_dDelta2()));
+        double ddelta_dbetaT__constTP = -POW2(delta)*d2alphar_dDelta_dTau*dtau_dbetaT__constTP/denominator;
+        double ddelta_dgammaT__constTP = -POW2(delta)*d2alphar_dDelta_dTau*dtau_dgammaT__constTP/denominator;
+        double ddelta_dbetaV__constTP = -delta*(1 + delta*dalphar_dDelta)*drhor_dbetaV/(rhor*denominator);
+        double ddelta_dgammaV__constTP = -delta*(1 + delta*dalphar_dDelta)*drhor_dgammaV/(rhor*denominator);
 
-        double d_ndrhordni_dbetaV = GERG->d2rhormolar_dxidbetaV(z, i, CoolProp::XN_INDEPENDENT);
-        for (std::size_t k = 0; k < z.size(); ++k) {
-            d_ndrhordni_dbetaV -= z[k] * GERG->d2rhormolar_dxidbetaV(z, k, CoolProp::XN_INDEPENDENT);
-        }
-        double d_ndrhordni_dgammaV = GERG->d2rhormolar_dxidgammaV(z, i, CoolProp::XN_INDEPENDENT);
+        // n*d(.)/dn_i = d(.)/dx_i - sum_k x_k*d(.)/dx_k = sum_k (delta_ik - x_k)*d(.)/dx_k
+        double d_ndrhordni_dbetaV = 0, d_ndrhordni_dgammaV = 0, d_ndTrdni_dbetaT = 0, d_ndTrdni_dgammaT = 0;
         for (std::size_t k = 0; k < z.size(); ++k) {
-            d_ndrhordni_dgammaV -= z[k] * GERG->d2rhormolar_dxidgammaV(z, k, CoolProp::XN_INDEPENDENT);
-        }
-        double d_ndTrdni_dbetaT = GERG->d2Tr_dxidbetaT(z, i, CoolProp::XN_INDEPENDENT);
-        for (std::size_t k = 0; k < z.size(); ++k) {
-            d_ndTrdni_dbetaT -= z[k] * GERG->d2Tr_dxidbetaT(z, k, CoolProp::XN_INDEPENDENT);
-        }
-        double d_ndTrdni_dgammaT = GERG->d2Tr_dxidgammaT(z, i, CoolProp::XN_INDEPENDENT);
-        for (std::size_t k = 0; k < z.size(); ++k) {
-            d_ndTrdni_dgammaT -= z[k] * GERG->d2Tr_dxidgammaT(z, k, CoolProp::XN_INDEPENDENT);
+            if (w[k] == 0) { continue; }
+            d_ndrhordni_dbetaV += w[k]*GERG->d2rhormolar_dxidbetaV(z, k, CoolProp::XN_INDEPENDENT);
+            d_ndrhordni_dgammaV += w[k]*GERG->d2rhormolar_dxidgammaV(z, k, CoolProp::XN_INDEPENDENT);
+            d_ndTrdni_dbetaT += w[k]*GERG->d2Tr_dxidbetaT(z, k, CoolProp::XN_INDEPENDENT);
+            d_ndTrdni_dgammaT += w[k]*GERG->d2Tr_dxidgammaT(z, k, CoolProp::XN_INDEPENDENT);
         }
 
-        double dY_dbetaV_constdeltatau = -HEOS->delta()*HEOS->dalphar_dDelta()/rhor*(d_ndrhordni_dbetaV - GERG->ndrhorbardni__constnj(z, i, CoolProp::XN_INDEPENDENT) / rhor*GERG->drhormolar_dbetaV(z));
-        double dY_dgammaV_constdeltatau = -HEOS->delta()*HEOS->dalphar_dDelta()/rhor*(d_ndrhordni_dgammaV - GERG->ndrhorbardni__constnj(z, i, CoolProp::XN_INDEPENDENT) / rhor*GERG->drhormolar_dgammaV(z));
-        double dY_dbetaT_constdeltatau = HEOS->tau()*HEOS->dalphar_dTau()/Tr*(d_ndTrdni_dbetaT - GERG->ndTrdni__constnj(z, i, CoolProp::XN_INDEPENDENT)/Tr*GERG->dTr_dbetaT(z));
-        double dY_dgammaT_constdeltatau = HEOS->tau()*HEOS->dalphar_dTau()/Tr*(d_ndTrdni_dgammaT - GERG->ndTrdni__constnj(z, i, CoolProp::XN_INDEPENDENT)/Tr*GERG->dTr_dgammaT(z));
+        double ndrhorbardni = GERG->ndrhorbardni__constnj(z, i, CoolProp::XN_INDEPENDENT), ndTrdni = GERG->ndTrdni__constnj(z, i, CoolProp::XN_INDEPENDENT);
+        double dY_dbetaV_constdeltatau = -delta*dalphar_dDelta/rhor*(d_ndrhordni_dbetaV - ndrhorbardni/rhor*drhor_dbetaV);
+        double dY_dgammaV_constdeltatau = -delta*dalphar_dDelta/rhor*(d_ndrhordni_dgammaV - ndrhorbardni/rhor*drhor_dgammaV);
+        double dY_dbetaT_constdeltatau = tau*HEOS->dalphar_dTau()/Tr*(d_ndTrdni_dbetaT - ndTrdni/Tr*dTr_dbetaT);
+        double dY_dgammaT_constdeltatau = tau*HEOS->dalphar_dTau()/Tr*(d_ndTrdni_dgammaT - ndTrdni/Tr*dTr_dgammaT);
 
         // Add contributions from the residual part
         buffer[0] += dY_ddelta__consttau*ddelta_dbetaT__constTP  + dY_dtau__constdelta*dtau_dbetaT__constTP  + dY_dbetaT_constdeltatau;
@@ -329,6 +537,7 @@ public:
         rapidjson::Value val;
         val.SetObject(); 
         val.AddMember("type", "PTXY", doc.GetAllocator());
+        val.AddMember("component", 0, doc.GetAllocator());
         val.AddMember("T (K)", PTXY_in->T(), doc.GetAllocator());
         val.AddMember("p (Pa)", PTXY_in->p(), doc.GetAllocator());
         val.AddMember("residue", m_y_calc, doc.GetAllocator());
@@ -338,6 +547,48 @@ public:
         
         cpjson::set_string("error", m_error_message, val, doc);
 
+        rapidjson::Value telemetry; telemetry.SetObject();
+        point_telemetry_to_JSON(m_telemetry, telemetry, doc);
+        val.AddMember("telemetry", telemetry, doc.GetAllocator());
+
+        // Add it to the list
+        list.PushBack(val, doc.GetAllocator());
+    }
+};
+
+/// The equality of the chemical potentials of another component of a PTXY point; filled in by the PTXYOutput of the point
+class PTXYComponentOutput : public PhiFitOutput {
+private:
+    std::size_t m_component; ///< The index of the component
+public:
+    PTXYComponentOutput(const std::shared_ptr<NumericInput> &in, std::size_t component) : PhiFitOutput(in), m_component(component) {};
+
+    /// Return the error
+    double get_error() { return m_y_calc; };
+    const char *type_name() { return "PTXY"; }
+    void evaluate_point() {
+        throw CoolProp::ValueError("A PTXYComponentOutput is evaluated by the PTXYOutput it accompanies");
+    }
+    std::shared_ptr<NumericOutput> replicate(CoolProp::HelmholtzEOSMixtureBackend *HEOS) {
+        return std::shared_ptr<NumericOutput>(new PTXYComponentOutput(m_in, m_component));
+    }
+    /// Dump this data structure to JSON
+    void to_JSON(rapidjson::Value &list, rapidjson::Document &doc) {
+        PTXYInput *in = static_cast<PTXYInput*>(m_in.get());
+
+        // Populate the JSON structure
+        rapidjson::Value val;
+        val.SetObject();
+        val.AddMember("type", "PTXY", doc.GetAllocator());
+        val.AddMember("component", static_cast<int>(m_component), doc.GetAllocator());
+        val.AddMember("T (K)", in->T(), doc.GetAllocator());
+        val.AddMember("p (Pa)", in->p(), doc.GetAllocator());
+        val.AddMember("residue", m_y_calc, doc.GetAllocator());
+        cpjson::set_double_array("x", in->x(), val, doc);
+        cpjson::set_double_array("y", in->y(), val, doc);
+        cpjson::set_string("BibTeX", in->get_BibTeX().c_str(), val, doc);
+        cpjson::set_string("error", m_error_message, val, doc);
+
         // Add it to the list
         list.PushBack(val, doc.GetAllocator());
     }
@@ -378,6 +629,7 @@ private:
     PRhoTInput *PRhoT_in;
     CoolProp::HelmholtzEOSMixtureBackend *HEOS;
     CoolProp::GERG2008ReducingFunction *GERG;
+    PointInvariants m_inv;
 public:
     PRhoTOutput(const std::shared_ptr<NumericInput> &in)
         : PhiFitOutput(in) {
@@ -385,14 +637,28 @@ public:
             PRhoT_in = static_cast<PRhoTInput*>(m_in.get());
             HEOS = static_cast<CoolProp::HelmholtzEOSMixtureBackend*>(PRhoT_in->get_AS().get());
             GERG = static_cast<CoolProp::GERG2008ReducingFunction*>(HEOS->Reducing.get());
+            if (!(PRhoT_in->rhomolar() > 0)) {
+                throw CoolProp::ValueError(fmt::format("PRhoT point from %s has a density of %g mol/m3; it must be positive", PRhoT_in->get_BibTeX(), PRhoT_in->rhomolar()));
+            }
+            std::vector<std::vector<double> > phases(1, PRhoT_in->z());
+            m_inv = PointInvariants(*HEOS, PRhoT_in->T(), PRhoT_in->rhomolar(), phases, 0);
+        };
+    /// With the invariants already computed, and HEOS in place of the AbstractState of the input
+    PRhoTOutput(const std::shared_ptr<NumericInput> &in, CoolProp::HelmholtzEOSMixtureBackend *HEOS, const PointInvariants &inv)
+        : PhiFitOutput(in), HEOS(HEOS), m_inv(inv) {
+            PRhoT_in = static_cast<PRhoTInput*>(m_in.get());
+            GERG = static_cast<CoolProp::GERG2008ReducingFunction*>(HEOS->Reducing.get());
         };
+    std::shared_ptr<NumericOutput> replicate(CoolProp::HelmholtzEOSMixtureBackend *HEOS) {
+        return std::shared_ptr<NumericOutput>(new PRhoTOutput(m_in, HEOS, m_inv));
+    }
 
     /// Return the error
     double get_error() { return m_y_calc; };
+    const char *type_name() { return "PRhoT"; }
 
     // Do the calculation
-    void evaluate_one() {
-        m_error_message.clear();
+    void evaluate_point() {
         const std::vector<double> &c = get_AbstractEvaluator()->get_const_coefficients();
         // Resize the row in the Jacobian matrix if needed
         if (Jacobian_row.size() != c.size()) {
@@ -418,6 +684,7 @@ public:
         // Set the mole fractions
         HEOS->set_mole_fractions(PRhoT_in->z());
         // Calculate p = f(T,rho)
+        record_flash(FLASH_DIRECT_DT);
         HEOS->update_DmolarT_direct(PRhoT_in->rhomolar(), PRhoT_in->T());
         // The derivative dpdrho__T (needs to be positive always for homogenous states!)
         double dpdrho__T = HEOS->first_partial_deriv(CoolProp::iP, CoolProp::iDmolar, CoolProp::iT);
@@ -426,7 +693,7 @@ public:
         // Pressures should be positive, penalize negative pressures
         penalty += (HEOS->p() > 0) ? 0 : -HEOS->p();
         // Return residual as (p_calc - p_exp)/rho_exp*drhodP_exp|T 
-        return (HEOS->p() - PRhoT_in->p())/PRhoT_in->rhomolar()/dpdrho__T;// + penalty;
+        return (HEOS->p() - PRhoT_in->p())*m_inv.inv_rho/dpdrho__T;// + penalty;
     }
     void analyt_derivs(std::vector<double> &J) {
 
@@ -435,39 +702,39 @@ public:
         // ---
 
         double DELTAp = HEOS->p() - PRhoT_in->p();
-        double rho_exp = PRhoT_in->rhomolar();
         double drho_dp__constT_c = HEOS->first_partial_deriv(CoolProp::iDmolar, CoolProp::iP, CoolProp::iT);
 
         // Some intermediate terms that show up in a couple of places
-        double delta = HEOS->delta();
-        double RT = HEOS->gas_constant()*HEOS->T();
-        double dtau_dbetaT = 1/HEOS->T()*GERG->dTr_dbetaT(PRhoT_in->z());
-        double dtau_dgammaT = 1/HEOS->T()*GERG->dTr_dgammaT(PRhoT_in->z());
-        double rhor = GERG->rhormolar(PRhoT_in->z());
-        double ddelta_dbetaV = -delta*GERG->drhormolar_dbetaV(PRhoT_in->z())/rhor;
-        double ddelta_dgammaV = -delta*GERG->drhormolar_dgammaV(PRhoT_in->z())/rhor;
+        const std::vector<double> &z = PRhoT_in->z();
+        const double delta = HEOS->delta(), rhomolar = HEOS->rhomolar(), RT = m_inv.RT[0];
+        const double dalphar_dDelta = HEOS->dalphar_dDelta(), d2alphar_dDelta2 = HEOS->d2alphar_dDelta2(), d2alphar_dDelta_dTau = HEOS->d2alphar_dDelta_dTau();
+        double dtau_dbetaT = m_inv.inv_T*GERG->dTr_dbetaT(z);
+        double dtau_dgammaT = m_inv.inv_T*GERG->dTr_dgammaT(z);
+        double rhor = GERG->rhormolar(z);
+        double ddelta_dbetaV = -delta*GERG->drhormolar_dbetaV(z)/rhor;
+        double ddelta_dgammaV = -delta*GERG->drhormolar_dgammaV(z)/rhor;
 
         // First derivatives of pressure with respect to each of the coefficients at constant T,rho
-        double dp_dbetaT = HEOS->rhomolar()*RT*delta*HEOS->d2alphar_dDelta_dTau()*dtau_dbetaT;
-        double dp_dgammaT = HEOS->rhomolar()*RT*delta*HEOS->d2alphar_dDelta_dTau()*dtau_dgammaT;
-        double dp_dbetaV = HEOS->rhomolar()*RT*(HEOS->dalphar_dDelta() + delta*HEOS->d2alphar_dDelta2())*ddelta_dbetaV;
-        double dp_dgammaV = HEOS->rhomolar()*RT*(HEOS->dalphar_dDelta() + delta*HEOS->d2alphar_dDelta2())*ddelta_dgammaV;
+        double dp_dbetaT = rhomolar*RT*delta*d2alphar_dDelta_dTau*dtau_dbetaT;
+        double dp_dgammaT = rhomolar*RT*delta*d2alphar_dDelta_dTau*dtau_dgammaT;
+        double dp_dbetaV = rhomolar*RT*(dalphar_dDelta + delta*d2alphar_dDelta2)*ddelta_dbetaV;
+        double dp_dgammaV = rhomolar*RT*(dalphar_dDelta + delta*d2alphar_dDelta2)*ddelta_dgammaV;
 
         // First derivatives of d(rho)/dp|T with respect to each of the coefficients
         // ----
         // common term for temperature coefficients
-        double bracket_T = -POW2(drho_dp__constT_c)*RT*(2*delta*HEOS->d2alphar_dDelta_dTau() + POW2(delta)*HEOS->d3alphar_dDelta2_dTau());
+        double bracket_T = -POW2(drho_dp__constT_c)*RT*(2*delta*d2alphar_dDelta_dTau + POW2(delta)*HEOS->d3alphar_dDelta2_dTau());
         double d_drhodp_dbetaT = bracket_T*dtau_dbetaT;
         double d_drhodp_dgammaT = bracket_T*dtau_dgammaT;
         // common term for density coefficients
-        double bracket_rho = -POW2(drho_dp__constT_c)*RT*(2*HEOS->dalphar_dDelta() + 4*delta*HEOS->d2alphar_dDelta2() + POW2(delta)*HEOS->d3alphar_dDelta3());
+        double bracket_rho = -POW2(drho_dp__constT_c)*RT*(2*dalphar_dDelta + 4*delta*d2alphar_dDelta2 + POW2(delta)*HEOS->d3alphar_dDelta3());
         double d_drhodp_dbetaV = bracket_rho*ddelta_dbetaV;
         double d_drhodp_dgammaV = bracket_rho*ddelta_dgammaV;
 
-        J[0] = 1/rho_exp*(DELTAp*d_drhodp_dbetaT + dp_dbetaT*drho_dp__constT_c);
-        J[1] = 1/rho_exp*(DELTAp*d_drhodp_dgammaT + dp_dgammaT*drho_dp__constT_c);
-        J[2] = 1/rho_exp*(DELTAp*d_drhodp_dbetaV + dp_dbetaV*drho_dp__constT_c);
-        J[3] = 1/rho_exp*(DELTAp*d_drhodp_dgammaV + dp_dgammaV*drho_dp__constT_c);
+        J[0] = m_inv.inv_rho*(DELTAp*d_drhodp_dbetaT + dp_dbetaT*drho_dp__constT_c);
+        J[1] = m_inv.inv_rho*(DELTAp*d_drhodp_dgammaT + dp_dgammaT*drho_dp__constT_c);
+        J[2] = m_inv.inv_rho*(DELTAp*d_drhodp_dbetaV + dp_dbetaV*drho_dp__constT_c);
+        J[3] = m_inv.inv_rho*(DELTAp*d_drhodp_dgammaV + dp_dgammaV*drho_dp__constT_c);
         
     }
 
@@ -516,6 +783,220 @@ public:
         val.AddMember("dp/drho|T (Pa/(mol/m3))", HEOS->first_partial_deriv(CoolProp::iP, CoolProp::iDmolar, CoolProp::iT), doc.GetAllocator());
         cpjson::set_string("error", m_error_message, val, doc);
 
+        rapidjson::Value telemetry; telemetry.SetObject();
+        point_telemetry_to_JSON(m_telemetry, telemetry, doc);
+        val.AddMember("telemetry", telemetry, doc.GetAllocator());
+
+        // Add it to the list
+        list.PushBack(val, doc.GetAllocator());
+    }
+};
+
+/**
+ The parts of the mixture model that are shared by all the slim PRhoT points of an evaluator: the pure
+ fluids, the departure function and Fij are read from a template AbstractState, and the GERG reducing
+ functions are evaluated in closed form from the coefficients, so no per-point AbstractState is needed
+ */
+class SlimMixtureModel {
+private:
+    double m_Tc[2], ///< Reducing temperatures of the pure fluids (K)
+           m_vc[2], ///< Reducing molar volumes of the pure fluids (m^3/mol)
+           m_Tc01, ///< sqrt(Tc0*Tc1) (K)
+           m_vc01; ///< (vc0^(1/3) + vc1^(1/3))^3/8 (m^3/mol)
+    std::mutex m_departure_mutex; ///< Guards the departure function if it is not thread-safe
+    std::mutex m_composition_mutex; ///< Guards the mole fractions of the template
+public:
+    std::shared_ptr<CoolProp::AbstractState> AS; ///< The template; setting the departure function or Fij of the evaluator sets them here
+    CoolProp::HelmholtzEOSMixtureBackend *HEOS;
+
+    /// The GERG-2008 reducing functions and their derivatives with respect to the coefficients
+    struct Reducing {
+        double Tr, rhor, dTr_dbetaT, dTr_dgammaT, drhor_dbetaV, drhor_dgammaV;
+    };
+
+    SlimMixtureModel(const std::string &backend, const std::string &fluids) : AS(CoolProp::AbstractState::factory(backend, fluids)) {
+        HEOS = static_cast<CoolProp::HelmholtzEOSMixtureBackend*>(AS.get());
+        for (std::size_t k = 0; k < 2; ++k) {
+            CoolProp::CoolPropFluid &fluid = HEOS->get_components()[k];
+            m_Tc[k] = fluid.EOS().reduce.T;
+            m_vc[k] = 1/fluid.EOS().reduce.rhomolar;
+        }
+        m_Tc01 = sqrt(m_Tc[0]*m_Tc[1]);
+        m_vc01 = POW3(pow(m_vc[0], 1.0/3.0) + pow(m_vc[1], 1.0/3.0))/8;
+    };
+    /// The gas constant of the mixture at composition z, taken from the template as the full model takes it from its AbstractState
+    double gas_constant(const std::vector<double> &z) {
+        std::lock_guard<std::mutex> lock(m_composition_mutex);
+        return mixture_gas_constant(*HEOS, z);
+    }
+    /// Evaluate the reducing functions at the coefficients c = [betaT, gammaT, betaV, gammaV] and composition z
+    Reducing reducing(const std::vector<double> &c, const std::vector<double> &z) const {
+        // Y = x0^2*Yc0 + x1^2*Yc1 + 2*beta*gamma*Yc01*f, with f = x0*x1*(x0+x1)/(beta^2*x0+x1)
+        const double x0 = z[0], x1 = z[1], x0x1s = x0*x1*(x0 + x1);
+        const double betaT = c[0], gammaT = c[1], betaV = c[2], gammaV = c[3];
+        const double DT = POW2(betaT)*x0 + x1, DV = POW2(betaV)*x0 + x1;
+        const double fT = x0x1s/DT, fV = x0x1s/DV;
+        Reducing r;
+        r.Tr = POW2(x0)*m_Tc[0] + POW2(x1)*m_Tc[1] + 2*betaT*gammaT*m_Tc01*fT;
+        r.dTr_dgammaT = 2*betaT*m_Tc01*fT;
+        r.dTr_dbetaT = 2*gammaT*m_Tc01*x0x1s*(1/DT - 2*POW2(betaT)*x0/POW2(DT));
+        double vr = POW2(x0)*m_vc[0] + POW2(x1)*m_vc[1] + 2*betaV*gammaV*m_vc01*fV;
+        double dvr_dgammaV = 2*betaV*m_vc01*fV;
+        double dvr_dbetaV = 2*gammaV*m_vc01*x0x1s*(1/DV - 2*POW2(betaV)*x0/POW2(DV));
+        r.rhor = 1/vr;
+        r.drhor_dbetaV = -POW2(r.rhor)*dvr_dbetaV;
+        r.drhor_dgammaV = -POW2(r.rhor)*dvr_dgammaV;
+        return r;
+    }
+    /// Evaluate the residual Helmholtz energy of the mixture and its derivatives; safe to call from several threads at once
+    CoolProp::HelmholtzDerivatives alphar(double tau, double delta, const std::vector<double> &z) {
+        // The pure fluid terms are evaluated without caching, which leaves them untouched
+        CoolProp::HelmholtzDerivatives a0 = HEOS->get_components()[0].EOS().alphar.all(tau, delta, false);
+        CoolProp::HelmholtzDerivatives a1 = HEOS->get_components()[1].EOS().alphar.all(tau, delta, false);
+        CoolProp::HelmholtzDerivatives a;
+        a.alphar = z[0]*a0.alphar + z[1]*a1.alphar;
+        a.dalphar_ddelta = z[0]*a0.dalphar_ddelta + z[1]*a1.dalphar_ddelta;
+        a.d2alphar_ddelta2 = z[0]*a0.d2alphar_ddelta2 + z[1]*a1.d2alphar_ddelta2;
+        a.d2alphar_ddelta_dtau = z[0]*a0.d2alphar_ddelta_dtau + z[1]*a1.d2alphar_ddelta_dtau;
+        a.d3alphar_ddelta3 = z[0]*a0.d3alphar_ddelta3 + z[1]*a1.d3alphar_ddelta3;
+        a.d3alphar_ddelta2_dtau = z[0]*a0.d3alphar_ddelta2_dtau + z[1]*a1.d3alphar_ddelta2_dtau;
+
+        // Departure function contribution x0*x1*F01*alphar_01
+        const CoolProp::ExcessTerm &Excess = HEOS->residual_helmholtz->Excess;
+        double F = Excess.F[0][1];
+        CoolProp::DepartureFunction *dep = Excess.DepartureFunctionMatrix[0][1].get();
+        if (dep != nullptr && F != 0) {
+            CoolProp::HelmholtzDerivatives d;
+            PhiFitDepartureFunction *pdep = dynamic_cast<PhiFitDepartureFunction*>(dep);
+            if (pdep != nullptr) {
+                pdep->evaluate(tau, delta, d);
+            }
+            else {
+                // Departure functions from CoolProp keep their derivatives in the instance
+                std::lock_guard<std::mutex> lock(m_departure_mutex);
+                dep->update(tau, delta);
+                d = dep->derivs;
+            }
+            double xxF = z[0]*z[1]*F;
+            a.alphar += xxF*d.alphar;
+            a.dalphar_ddelta += xxF*d.dalphar_ddelta;
+            a.d2alphar_ddelta2 += xxF*d.d2alphar_ddelta2;
+            a.d2alphar_ddelta_dtau += xxF*d.d2alphar_ddelta_dtau;
+            a.d3alphar_ddelta3 += xxF*d.d3alphar_ddelta3;
+            a.d3alphar_ddelta2_dtau += xxF*d.d3alphar_ddelta2_dtau;
+        }
+        return a;
+    }
+};
+
+/// A PRhoT data point that is evaluated directly from the shared mixture model rather than through its own AbstractState
+class SlimPRhoTOutput : public PhiFitOutput {
+private:
+    PRhoTInput *PRhoT_in;
+    std::shared_ptr<SlimMixtureModel> m_model;
+    double m_RT, ///< Gas constant times temperature (J/mol)
+           m_p_calc, ///< Calculated pressure at the last evaluation (Pa)
+           m_dpdrho__T; ///< Calculated dp/drho|T at the last evaluation (Pa/(mol/m^3))
+public:
+    SlimPRhoTOutput(const std::shared_ptr<NumericInput> &in, const std::shared_ptr<SlimMixtureModel> &model)
+        : PhiFitOutput(in), m_model(model), m_p_calc(0), m_dpdrho__T(0) {
+        PRhoT_in = static_cast<PRhoTInput*>(m_in.get());
+        if (!(PRhoT_in->rhomolar() > 0)) {
+            throw CoolProp::ValueError(fmt::format("PRhoT point from %s has a density of %g mol/m3; it must be positive", PRhoT_in->get_BibTeX(), PRhoT_in->rhomolar()));
+        }
+        m_RT = m_model->gas_constant(PRhoT_in->z())*PRhoT_in->T();
+    };
+    /// With the gas constant times temperature already computed
+    SlimPRhoTOutput(const std::shared_ptr<NumericInput> &in, const std::shared_ptr<SlimMixtureModel> &model, double RT)
+        : PhiFitOutput(in), m_model(model), m_RT(RT), m_p_calc(0), m_dpdrho__T(0) {
+        PRhoT_in = static_cast<PRhoTInput*>(m_in.get());
+    };
+    /// The replica shares the mixture model rather than using HEOS, which is safe as the model can be evaluated from several threads at once
+    std::shared_ptr<NumericOutput> replicate(CoolProp::HelmholtzEOSMixtureBackend *HEOS) {
+        return std::shared_ptr<NumericOutput>(new SlimPRhoTOutput(m_in, m_model, m_RT));
+    }
+
+    /// Return the error
+    double get_error() { return m_y_calc; };
+    const char *type_name() { return "PRhoT"; }
+
+    // Do the calculation
+    void evaluate_point() {
+        const std::vector<double> &c = get_AbstractEvaluator()->get_const_coefficients();
+        // Resize the row in the Jacobian matrix if needed
+        if (Jacobian_row.size() != c.size()) {
+            resize(c.size());
+        }
+        record_flash(FLASH_DIRECT_DT);
+
+        const std::vector<double> &z = PRhoT_in->z();
+        const double T = PRhoT_in->T(), rho_exp = PRhoT_in->rhomolar(), RT = m_RT;
+        SlimMixtureModel::Reducing red = m_model->reducing(c, z);
+        const double tau = red.Tr/T, delta = rho_exp/red.rhor;
+        CoolProp::HelmholtzDerivatives a = m_model->alphar(tau, delta, z);
+
+        // Residual as in PRhoTOutput: (p_calc - p_exp)/rho_exp*drhodP_exp|T
+        m_p_calc = rho_exp*RT*(1 + delta*a.dalphar_ddelta);
+        m_dpdrho__T = RT*(1 + 2*delta*a.dalphar_ddelta + POW2(delta)*a.d2alphar_ddelta2);
+        double DELTAp = m_p_calc - PRhoT_in->p();
+        m_y_calc = DELTAp/rho_exp/m_dpdrho__T;
+
+        // Analytic derivatives, as in PRhoTOutput::analyt_derivs
+        double drho_dp__constT_c = 1/m_dpdrho__T;
+        double dtau_dbetaT = red.dTr_dbetaT/T;
+        double dtau_dgammaT = red.dTr_dgammaT/T;
+        double ddelta_dbetaV = -delta*red.drhor_dbetaV/red.rhor;
+        double ddelta_dgammaV = -delta*red.drhor_dgammaV/red.rhor;
+
+        double dp_dbetaT = rho_exp*RT*delta*a.d2alphar_ddelta_dtau*dtau_dbetaT;
+        double dp_dgammaT = rho_exp*RT*delta*a.d2alphar_ddelta_dtau*dtau_dgammaT;
+        double dp_dbetaV = rho_exp*RT*(a.dalphar_ddelta + delta*a.d2alphar_ddelta2)*ddelta_dbetaV;
+        double dp_dgammaV = rho_exp*RT*(a.dalphar_ddelta + delta*a.d2alphar_ddelta2)*ddelta_dgammaV;
+
+        double bracket_T = -POW2(drho_dp__constT_c)*RT*(2*delta*a.d2alphar_ddelta_dtau + POW2(delta)*a.d3alphar_ddelta2_dtau);
+        double bracket_rho = -POW2(drho_dp__constT_c)*RT*(2*a.dalphar_ddelta + 4*delta*a.d2alphar_ddelta2 + POW2(delta)*a.d3alphar_ddelta3);
+
+        Jacobian_row[0] = 1/rho_exp*(DELTAp*bracket_T*dtau_dbetaT + dp_dbetaT*drho_dp__constT_c);
+        Jacobian_row[1] = 1/rho_exp*(DELTAp*bracket_T*dtau_dgammaT + dp_dgammaT*drho_dp__constT_c);
+        Jacobian_row[2] = 1/rho_exp*(DELTAp*bracket_rho*ddelta_dbetaV + dp_dbetaV*drho_dp__constT_c);
+        Jacobian_row[3] = 1/rho_exp*(DELTAp*bracket_rho*ddelta_dgammaV + dp_dgammaV*drho_dp__constT_c);
+    }
+    static std::shared_ptr<NumericOutput> factory(rapidjson::Value &v, const std::shared_ptr<SlimMixtureModel> &model) {
+        // Extract parameters from JSON data
+        double T = cpjson::get_double(v, "T (K)");
+        double p = cpjson::get_double(v, "p (Pa)");
+        double rhomolar = cpjson::get_double(v, "rho (mol/m3)");
+        std::vector<double> z = cpjson::get_double_array(v, "z (molar)");
+        std::string BibTeX = cpjson::get_string(v, "BibTeX");
+
+        // The input refers to the template of the model, so that setting the departure function or Fij reaches it
+        std::shared_ptr<NumericInput> in(new PRhoTInput(model->AS, p, rhomolar, T, z, BibTeX));
+        return std::shared_ptr<NumericOutput>(new SlimPRhoTOutput(std::move(in), model));
+    }
+    /// Dump this data structure to JSON
+    void to_JSON(rapidjson::Value &list, rapidjson::Document &doc) {
+
+        // Populate the JSON structure
+        rapidjson::Value val; val.SetObject();
+        
+        // Inputs
+        val.AddMember("type", "PRhoT", doc.GetAllocator()); 
+        val.AddMember("T (K)", PRhoT_in->T(), doc.GetAllocator());
+        val.AddMember("p (Pa)", PRhoT_in->p(), doc.GetAllocator());
+        val.AddMember("rho (mol/m3)", PRhoT_in->rhomolar(), doc.GetAllocator());
+        cpjson::set_double_array("z", PRhoT_in->z(), val, doc);
+        cpjson::set_string("BibTeX", PRhoT_in->get_BibTeX().c_str(), val, doc);
+        
+        // Outputs
+        val.AddMember("residue", m_y_calc, doc.GetAllocator());
+        val.AddMember("p[calc] (Pa)", m_p_calc, doc.GetAllocator());
+        val.AddMember("dp/drho|T (Pa/(mol/m3))", m_dpdrho__T, doc.GetAllocator());
+        cpjson::set_string("error", m_error_message, val, doc);
+
+        rapidjson::Value telemetry; telemetry.SetObject();
+        point_telemetry_to_JSON(m_telemetry, telemetry, doc);
+        val.AddMember("telemetry", telemetry, doc.GetAllocator());
+
         // Add it to the list
         list.PushBack(val, doc.GetAllocator());
     }
@@ -536,9 +1017,10 @@ public:
      @param pc Crtical pressure in Pa
      @param Tc Critical temperature in K
      @param z Molar composition vector
+     @param BibTeX The BibTeX key associated with this data point
      */
-    CriticalPointInput(shared_ptr<CoolProp::AbstractState> &AS, double pc, double Tc, const std::vector<double>&z)
-    : PhiFitInput(Tc, pc), m_pc(pc), m_Tc(Tc), m_z(z) {this->AS = AS;};
+    CriticalPointInput(shared_ptr<CoolProp::AbstractState> &AS, double pc, double Tc, const std::vector<double>&z, const std::string &BibTeX = "")
+    : PhiFitInput(Tc, pc), m_pc(pc), m_Tc(Tc), m_z(z) {this->AS = AS; this->BibTeX = BibTeX;};
     /// Get the temperature (K)
     double Tc() { return m_Tc; }
     /// Get the pressure (Pa)
@@ -548,15 +1030,27 @@ public:
 };
 
 class CriticalPointOutput : public PhiFitOutput {
+private:
+    CoolProp::HelmholtzEOSMixtureBackend *HEOS;
+    bool m_shared_state; ///< True if HEOS is shared with other points, so that its composition is set before each evaluation
 public:
     CriticalPointOutput(const std::shared_ptr<NumericInput> &in)
-    : PhiFitOutput(in) { };
+    : PhiFitOutput(in), m_shared_state(false) {
+        HEOS = static_cast<CoolProp::HelmholtzEOSMixtureBackend*>(static_cast<CriticalPointInput*>(m_in.get())->get_AS().get());
+    };
+    /// With HEOS, which other points may share, in place of the AbstractState of the input
+    CriticalPointOutput(const std::shared_ptr<NumericInput> &in, CoolProp::HelmholtzEOSMixtureBackend *HEOS)
+    : PhiFitOutput(in), HEOS(HEOS), m_shared_state(true) { };
+    std::shared_ptr<NumericOutput> replicate(CoolProp::HelmholtzEOSMixtureBackend *HEOS) {
+        return std::shared_ptr<NumericOutput>(new CriticalPointOutput(m_in, HEOS));
+    }
     
     /// Return the error
     double get_error() { return m_y_calc; };
+    const char *type_name() { return "CriticalPoint"; }
     
     // Do the calculation
-    void evaluate_one() {
+    void evaluate_point() {
         const std::vector<double> &c = get_AbstractEvaluator()->get_const_coefficients();
         // Resize the row in the Jacobian matrix if needed
         if (Jacobian_row.size() != c.size()) {
@@ -565,22 +1059,65 @@ public:
         
         // Cast abstract input to the derived type so we can access its attributes
         CriticalPointInput *in = static_cast<CriticalPointInput*>(m_in.get());
-        CoolProp::HelmholtzEOSMixtureBackend *HEOS = static_cast<CoolProp::HelmholtzEOSMixtureBackend*>(in->get_AS().get());
+        if (m_shared_state) { HEOS->set_mole_fractions(in->z()); }
         
+        m_y_calc = scaled_L1star(HEOS, in, c, -1);
+
+        // There are no analytic derivatives of L1* with respect to the coefficients, so they are taken by central 
+        // differences, each from a local PT flash that starts at the density just found
+        const double rhomolar = HEOS->rhomolar();
+        std::vector<double> cc = c;
+        for (std::size_t i = 0; i < c.size(); ++i) {
+            const double h = 1e-6*std::max(std::abs(c[i]), 1.0);
+            cc[i] = c[i] + h;
+            double plus = scaled_L1star(HEOS, in, cc, rhomolar);
+            cc[i] = c[i] - h;
+            double minus = scaled_L1star(HEOS, in, cc, rhomolar);
+            cc[i] = c[i];
+            Jacobian_row[i] = (plus - minus)/(2*h);
+        }
+        // Leave the interaction parameters at the coefficients
+        static_cast<CoolProp::GERG2008ReducingFunction*>(HEOS->Reducing.get())->set_binary_interaction_double(0,1,c[0],c[1],c[2],c[3]);
+    }
+    /**
+     Evaluate L1* (scaled by 1e10) at the critical temperature and pressure of the point
+     @param c The coefficients [betaT, gammaT, betaV, gammaV]
+     @param rhomolar_guess The density that a local PT flash starts from, or a negative value for a global PT flash
+     */
+    double scaled_L1star(CoolProp::HelmholtzEOSMixtureBackend *HEOS, CriticalPointInput *in, const std::vector<double> &c, double rhomolar_guess) {
         // Set the BIP in main instance
         CoolProp::GERG2008ReducingFunction *GERG = static_cast<CoolProp::GERG2008ReducingFunction*>(HEOS->Reducing.get());
         GERG->set_binary_interaction_double(0,1,c[0],c[1],c[2],c[3]);
-        
-        HEOS->update(CoolProp::PT_INPUTS, in->pc(), in->Tc());
+
+        if (rhomolar_guess > 0) {
+            record_flash(FLASH_LOCAL_PT);
+            HEOS->update_TP_guessrho(in->Tc(), in->pc(), rhomolar_guess);
+        }
+        else {
+            record_flash(FLASH_GLOBAL_PT);
+            HEOS->update(CoolProp::PT_INPUTS, in->pc(), in->Tc());
+        }
         double L1star = 0, M1star = 0;
         HEOS->criticality_contour_values(L1star, M1star);
-        m_y_calc = L1star*1e10;
-        
-        //// Numerical derivatives for testing purposes if necessary
-        //for (std::size_t i = 0; i < c.size(); ++i) {
-        //    // Numerical derivatives :(
-        //    Jacobian_row[i] = der(i, 0.00001);
-        //}
+        return L1star*1e10;
+    }
+    static std::shared_ptr<NumericOutput> factory(rapidjson::Value &v, const std::string &backend, const std::string &fluids) {
+        std::shared_ptr<NumericOutput> out;
+
+        // Extract parameters from JSON data
+        double Tc = cpjson::get_double(v, "Tc (K)");
+        double pc = cpjson::get_double(v, "pc (Pa)");
+        std::vector<double> z = cpjson::get_double_array(v, "z (molar)");
+        std::string BibTeX = cpjson::get_string(v, "BibTeX");
+
+        // Generate the AbstractState instance owned by this data point; the composition never changes
+        std::shared_ptr<CoolProp::AbstractState> AS(CoolProp::AbstractState::factory(backend, fluids));
+        AS->set_mole_fractions(z);
+        // Generate the input which stores the critical point that is to be fit
+        std::shared_ptr<NumericInput> in(new CriticalPointInput(AS, pc, Tc, z, BibTeX));
+        // Generate and add the output value
+        out.reset(new CriticalPointOutput(std::move(in)));
+        return out;
     }
     /// Dump this data structure to JSON
     void to_JSON(rapidjson::Value &list, rapidjson::Document &doc) {
@@ -588,11 +1125,17 @@ public:
         
         // Populate the JSON structure
         rapidjson::Value val; val.SetObject();
-        val.AddMember("type", "PRhoT", doc.GetAllocator());
+        val.AddMember("type", "CriticalPoint", doc.GetAllocator());
         val.AddMember("Tc (K)", in->Tc(), doc.GetAllocator());
         val.AddMember("pc (Pa)", in->pc(), doc.GetAllocator());
-        cpjson::set_double_array("z", in->z(), val, doc);
+        cpjson::set_double_array("z (molar)", in->z(), val, doc);
+        cpjson::set_string("BibTeX", in->get_BibTeX().c_str(), val, doc);
         val.AddMember("residue", m_y_calc, doc.GetAllocator());
+        cpjson::set_string("error", m_error_message, val, doc);
+
+        rapidjson::Value telemetry; telemetry.SetObject();
+        point_telemetry_to_JSON(m_telemetry, telemetry, doc);
+        val.AddMember("telemetry", telemetry, doc.GetAllocator());
         
         // Add it to the list
         list.PushBack(val, doc.GetAllocator());
@@ -602,9 +1145,26 @@ public:
 
 /// The evaluator class that is used to evaluate the output values from the input values
 class MixtureEvaluator : public NumericEvaluator {
+private:
+    std::shared_ptr<SlimMixtureModel> m_slim_model; ///< Shared by the slim PRhoT outputs and the batched density solver
 public:
+    bool m_slim_PRhoT; ///< If true, PRhoT points are loaded as SlimPRhoTOutput, sharing one mixture model
+    bool m_batch_PT_densities; ///< If true, the densities of the PTXY phases with guess values are solved for in one batch before evaluation
+    PTDensitySolverOptions m_density_solver_options; ///< Options for the batched density solver
+    QuarantinePolicy m_quarantine_policy; ///< Used by all the outputs to decide when to stop evaluating points that keep failing
+    bool m_quarantine_enabled; ///< False while the outputs are evaluated without the quarantine policy
+    std::string m_backend, m_fluids; ///< The backend and the fluids (separated by '&') of the mixture model
+    std::vector<std::size_t> m_ids; ///< The identifier of the data point of each output, in the order of the outputs
+    std::multimap<std::size_t, std::shared_ptr<AbstractOutput> > m_disabled; ///< The outputs that are loaded but not evaluated, by identifier
+    std::size_t m_next_id; ///< The identifier given to the next output that is loaded
+    std::vector<std::shared_ptr<CoolProp::AbstractState> > m_replica_states; ///< The AbstractStates of the blocks of an evaluator made by replicate()
+    MixtureEvaluator() : m_slim_PRhoT(true), m_batch_PT_densities(true), m_quarantine_enabled(true), m_next_id(0) {};
+    /// Load the data points as outputs; each output is given the next identifier
     void add_terms(const std::string &backend, const std::string &fluids, rapidjson::Value& terms)
     {
+        if (!m_slim_model) { m_slim_model.reset(new SlimMixtureModel(backend, fluids)); }
+        m_backend = backend; m_fluids = fluids;
+        const std::size_t N0 = get_outputs_size();
         // Iterate over the terms in the input
         for (rapidjson::Value::ValueIterator itr = terms.Begin(); itr != terms.End(); ++itr)
         {
@@ -615,11 +1175,27 @@ public:
             if (type == "PTXY"){
                 auto out = PTXYOutput::factory(*itr, backend, fluids);
                 if (out){
+                    // The equality of the chemical potentials of component 1 is worked out from the same flash calculations
+                    std::shared_ptr<NumericOutput> companion(new PTXYComponentOutput(out->get_input(), 1));
+                    static_cast<PhiFitOutput*>(out.get())->set_companion(static_cast<PhiFitOutput*>(companion.get()));
                     add_output(std::move(out));
+                    add_output(std::move(companion));
                 }
             }
             else if (type == "PRhoT") {
-                auto out = PRhoTOutput::factory(*itr, backend, fluids);
+                std::shared_ptr<NumericOutput> out;
+                if (m_slim_PRhoT) {
+                    out = SlimPRhoTOutput::factory(*itr, m_slim_model);
+                }
+                else {
+                    out = PRhoTOutput::factory(*itr, backend, fluids);
+                }
+                if (out) {
+                    add_output(std::move(out));
+                }
+            }
+            else if (type == "CriticalPoint") {
+                auto out = CriticalPointOutput::factory(*itr, backend, fluids);
                 if (out) {
                     add_output(std::move(out));
                 }
@@ -628,10 +1204,124 @@ public:
                 throw CoolProp::ValueError(fmt::format("I don't understand this data type: %s", type));
             }
         }
+        enable_quarantine(m_quarantine_enabled);
+        // The outputs of a data point share its identifier
+        for (std::size_t i = N0; i < get_outputs_size(); ++i) {
+            m_ids.push_back(static_cast<PhiFitOutput*>(get_outputs()[i].get())->is_companion() ? m_next_id - 1 : m_next_id++);
+        }
     };
+    /// Drop the outputs with the given identifiers, enabled or not
+    void remove_outputs(const std::vector<std::size_t> &ids) {
+        std::set<std::size_t> to_remove(ids.begin(), ids.end());
+        for (std::size_t id : to_remove) {
+            if (m_disabled.count(id) == 0 && std::find(m_ids.begin(), m_ids.end(), id) == m_ids.end()) {
+                throw CoolProp::ValueError(fmt::format("There is no data point with identifier %d", id));
+            }
+        }
+        std::vector<std::shared_ptr<AbstractOutput> > outputs;
+        std::vector<std::size_t> kept_ids;
+        for (std::size_t i = 0; i < m_outputs.size(); ++i) {
+            if (to_remove.count(m_ids[i]) == 0) { outputs.push_back(m_outputs[i]); kept_ids.push_back(m_ids[i]); }
+        }
+        m_outputs.swap(outputs);
+        m_ids.swap(kept_ids);
+        for (std::size_t id : to_remove) { m_disabled.erase(id); }
+    }
+    /// Move the outputs of a data point out of the evaluated set (disable) or back into it, in the order of the identifiers (enable)
+    void set_output_enabled(std::size_t id, bool enabled) {
+        std::vector<std::size_t>::iterator it = std::find(m_ids.begin(), m_ids.end(), id);
+        if (it != m_ids.end()) {
+            if (!enabled) {
+                // The outputs of a data point are next to each other
+                std::size_t i = it - m_ids.begin(), n = std::upper_bound(it, m_ids.end(), id) - it;
+                for (std::size_t k = i; k < i + n; ++k) { m_disabled.insert(std::make_pair(id, m_outputs[k])); }
+                m_outputs.erase(m_outputs.begin() + i, m_outputs.begin() + i + n);
+                m_ids.erase(it, it + n);
+            }
+            return;
+        }
+        if (m_disabled.count(id) == 0) { throw CoolProp::ValueError(fmt::format("There is no data point with identifier %d", id)); }
+        if (enabled) {
+            auto range = m_disabled.equal_range(id);
+            std::size_t i = std::lower_bound(m_ids.begin(), m_ids.end(), id) - m_ids.begin();
+            for (auto dis = range.first; dis != range.second; ++dis, ++i) {
+                m_outputs.insert(m_outputs.begin() + i, dis->second);
+                m_ids.insert(m_ids.begin() + i, id);
+            }
+            m_disabled.erase(range.first, range.second);
+        }
+    }
+    /**
+     The index of the first output of block k when the outputs are split into Nblocks contiguous blocks of nearly 
+     equal size; an output is never split from the output that fills it in
+     */
+    std::size_t block_start(std::size_t k, std::size_t Nblocks) {
+        const std::size_t N = get_outputs_size();
+        std::size_t start = N*k/Nblocks;
+        while (start > 0 && start < N && static_cast<PhiFitOutput*>(get_outputs()[start].get())->is_companion()) { ++start; }
+        return start;
+    }
+    /**
+     An evaluator of the enabled outputs that can be used at the same time as this one: its outputs share the data points,
+     the quantities computed from them when they were loaded and the shared mixture model, and the outputs of block k of
+     states.size() blocks (see block_start) all do their calculations with states[k], so that each block has to be
+     evaluated on one thread. The states should be set up with the model of this evaluator
+     */
+    std::shared_ptr<MixtureEvaluator> replicate(const std::vector<std::shared_ptr<CoolProp::AbstractState> > &states) {
+        std::shared_ptr<MixtureEvaluator> copy(new MixtureEvaluator());
+        copy->m_slim_model = m_slim_model;
+        copy->m_slim_PRhoT = m_slim_PRhoT;
+        copy->m_batch_PT_densities = m_batch_PT_densities;
+        copy->m_density_solver_options = m_density_solver_options;
+        copy->m_quarantine_policy = m_quarantine_policy;
+        copy->m_backend = m_backend; copy->m_fluids = m_fluids;
+        copy->m_replica_states = states;
+        const std::vector<std::shared_ptr<AbstractOutput> > &outputs = get_outputs();
+        std::size_t k = 0;
+        for (std::size_t i = 0; i < outputs.size(); ++i) {
+            while (i >= block_start(k + 1, states.size())) { ++k; }
+            PhiFitOutput *po = static_cast<PhiFitOutput*>(outputs[i].get());
+            std::shared_ptr<NumericOutput> out = po->replicate(static_cast<CoolProp::HelmholtzEOSMixtureBackend*>(states[k].get()));
+            if (po->is_companion()) {
+                static_cast<PhiFitOutput*>(copy->get_outputs().back().get())->set_companion(static_cast<PhiFitOutput*>(out.get()));
+            }
+            copy->add_output(std::move(out));
+        }
+        copy->m_ids = m_ids;
+        copy->m_next_id = m_next_id;
+        copy->enable_quarantine(m_quarantine_enabled);
+        return copy;
+    }
+    /// Let the outputs use the quarantine policy, or evaluate them all without touching their quarantine state
+    void enable_quarantine(bool enable) {
+        m_quarantine_enabled = enable;
+        for (auto &out : get_outputs()) {
+            static_cast<PhiFitOutput*>(out.get())->set_quarantine_policy(enable ? &m_quarantine_policy : nullptr);
+        }
+    }
+    /// The indices of the outputs that are currently quarantined
+    std::vector<std::size_t> get_quarantined() {
+        std::vector<std::size_t> indices;
+        const std::vector<std::shared_ptr<AbstractOutput> > &outputs = get_outputs();
+        for (std::size_t i = 0; i < outputs.size(); ++i) {
+            if (static_cast<PhiFitOutput*>(outputs[i].get())->quarantine().quarantined) { indices.push_back(i); }
+        }
+        return indices;
+    }
+    /// Release all the outputs from quarantine
+    void release_quarantine() {
+        for (auto &out : get_outputs()) {
+            static_cast<PhiFitOutput*>(out.get())->release_quarantine();
+        }
+    }
     std::string dump_outputs_to_JSON() {
-        // Construct the output document
         rapidjson::Document doc;
+        outputs_to_JSON(doc);
+        return cpjson::json2string(doc);
+    }
+    /// Build the document returned by dump_outputs_to_JSON
+    void outputs_to_JSON(rapidjson::Document &doc) {
+        // Construct the output document
         doc.SetObject();
 
         // Get the list of outputs, store as "data"
@@ -641,6 +1331,11 @@ public:
         }
         doc.AddMember("data", list, doc.GetAllocator());
 
+        // Add the telemetry aggregated by data type and by source
+        rapidjson::Value telemetry; telemetry.SetObject();
+        telemetry_summary_to_JSON(get_telemetry_summary(), telemetry, doc);
+        doc.AddMember("telemetry", telemetry, doc.GetAllocator());
+
         // Get the departure function
         NumericOutput *_out = static_cast<NumericOutput *>(get_outputs()[0].get());
         PhiFitInput * in = static_cast<PhiFitInput *>(_out->get_input().get());
@@ -650,13 +1345,110 @@ public:
             rapidjson::Value dep = pdep->to_JSON(doc);
             doc.AddMember("departure[i][j]", dep, doc.GetAllocator());
         }
-        return cpjson::json2string(doc);
     }
-    void update_departure_function(rapidjson::Value& fit0data) {
-        for (auto &out : get_outputs()) {
+    /// The template AbstractState of the shared mixture model, followed by the AbstractStates of the other outputs (enabled or not), in order
+    std::vector<CoolProp::HelmholtzEOSMixtureBackend*> get_distinct_HEOS() {
+        std::vector<CoolProp::HelmholtzEOSMixtureBackend*> states;
+        CoolProp::AbstractState *shared = (m_slim_model) ? m_slim_model->AS.get() : nullptr;
+        if (shared != nullptr) { states.push_back(m_slim_model->HEOS); }
+        std::vector<std::shared_ptr<AbstractOutput> > outputs = get_outputs();
+        for (auto &dis : m_disabled) { outputs.push_back(dis.second); }
+        for (auto &out : outputs) {
             NumericOutput *_out = static_cast<NumericOutput *>(out.get());
             PhiFitInput * in = static_cast<PhiFitInput *>(_out->get_input().get());
-            CoolProp::HelmholtzEOSMixtureBackend *HEOS = static_cast<CoolProp::HelmholtzEOSMixtureBackend*>(in->get_AS().get());
+            CoolProp::AbstractState *AS = in->get_AS().get();
+            // The outputs of a PTXY point share its AbstractState
+            if (AS == shared || static_cast<PhiFitOutput*>(out.get())->is_companion()) { continue; }
+            states.push_back(static_cast<CoolProp::HelmholtzEOSMixtureBackend*>(AS));
+        }
+        return states;
+    }
+    /// The AbstractStates owned by the outputs from index start onwards (those sharing the mixture model are left out)
+    std::vector<CoolProp::HelmholtzEOSMixtureBackend*> get_own_HEOS(std::size_t start) {
+        std::vector<CoolProp::HelmholtzEOSMixtureBackend*> states;
+        CoolProp::AbstractState *shared = (m_slim_model) ? m_slim_model->AS.get() : nullptr;
+        for (std::size_t i = start; i < get_outputs_size(); ++i) {
+            PhiFitInput * in = static_cast<PhiFitInput *>(static_cast<NumericOutput *>(get_outputs()[i].get())->get_input().get());
+            if (in->get_AS().get() == shared || static_cast<PhiFitOutput*>(get_outputs()[i].get())->is_companion()) { continue; }
+            states.push_back(static_cast<CoolProp::HelmholtzEOSMixtureBackend*>(in->get_AS().get()));
+        }
+        return states;
+    }
+    /// Add the residuals and Jacobian rows of the outputs in [start, end) to the normal equations
+    void accumulate_normal_equations(std::size_t start, std::size_t end, PhiFitNormalEquations &ne) {
+        const std::vector<std::shared_ptr<AbstractOutput> > &outputs = get_outputs();
+        const std::size_t P = get_const_coefficients().size();
+        ne.reset(P);
+        for (std::size_t i = start; i < end; ++i) {
+            const std::vector<double> &J = outputs[i]->get_Jacobian_row();
+            if (J.size() != P) { throw CoolProp::ValueError(fmt::format("Jacobian row of output %d has length %d; expected %d", i, J.size(), P)); }
+            ne.add_row(&(J[0]), outputs[i]->get_error());
+        }
+    }
+    /// Forget the densities found by the batched solver that have not been used yet, in the disabled outputs too
+    void clear_solved_densities() {
+        auto clear = [](const std::shared_ptr<AbstractOutput> &out) {
+            PTXYOutput *PTXY = dynamic_cast<PTXYOutput*>(out.get());
+            if (PTXY != nullptr) { PTXY->set_solved_density(0, -1); PTXY->set_solved_density(1, -1); }
+        };
+        for (auto &out : get_outputs()) { clear(out); }
+        for (auto &disabled : m_disabled) { clear(disabled.second); }
+    }
+    /// Evaluate the outputs in [start, end), first solving for the densities of their PTXY phases in one batch
+    void evaluate_range(std::size_t start, std::size_t end, std::size_t thread_index) {
+        if (m_batch_PT_densities && m_slim_model) {
+            solve_PTXY_densities(start, end);
+        }
+        evaluate_serial(start, end, thread_index);
+    }
+    /**
+     Solve for the densities of the phases of the PTXY outputs in [start, end) that have guess values, all in 
+     lockstep from the shared mixture model at the current coefficients; the phases that do not converge 
+     are left to the PT flash of the output
+     */
+    void solve_PTXY_densities(std::size_t start, std::size_t end) {
+        const std::vector<double> &c = get_const_coefficients();
+        const std::vector<std::shared_ptr<AbstractOutput> > &outputs = get_outputs();
+        PTDensityBatch batch;
+        std::vector<PTXYOutput*> owners;
+        std::vector<std::size_t> phases;
+        std::vector<SlimMixtureModel::Reducing> reducing;
+        std::vector<double> RT;
+        for (std::size_t k = start; k < end; ++k) {
+            PTXYOutput *PTXY = dynamic_cast<PTXYOutput*>(outputs[k].get());
+            if (PTXY == nullptr) { continue; }
+            for (std::size_t phase = 0; phase < 2; ++phase) {
+                PTXY->set_solved_density(phase, -1);
+                double guess = PTXY->rho_guess(phase);
+                if (!(guess > 0)) { continue; }
+                PTXYInput *in = PTXY->get_PTXY_input();
+                // The reducing state only depends on the coefficients and the composition, so it is fixed for the whole solve
+                reducing.push_back(m_slim_model->reducing(c, PTXY->z(phase)));
+                // The reducing density separates the liquid-like from the vapor-like roots
+                batch.add(in->T(), in->p(), guess, reducing.back().rhor);
+                owners.push_back(PTXY);
+                phases.push_back(phase);
+                RT.push_back(PTXY->RT(phase));
+            }
+        }
+        if (batch.size() == 0) { return; }
+
+        SlimMixtureModel &model = *m_slim_model;
+        PTDensityEvaluator pressures = [&](const std::vector<std::size_t> &active, const std::vector<double> &rho, std::vector<double> &p, std::vector<double> &dpdrho) {
+            for (std::size_t k : active) {
+                double delta = rho[k]/reducing[k].rhor, tau = reducing[k].Tr/batch.T[k];
+                CoolProp::HelmholtzDerivatives a = model.alphar(tau, delta, owners[k]->z(phases[k]));
+                p[k] = rho[k]*RT[k]*(1 + delta*a.dalphar_ddelta);
+                dpdrho[k] = RT[k]*(1 + 2*delta*a.dalphar_ddelta + POW2(delta)*a.d2alphar_ddelta2);
+            }
+        };
+        solve_PT_densities(batch, pressures, m_density_solver_options);
+        for (std::size_t k = 0; k < batch.size(); ++k) {
+            if (batch.converged[k]) { owners[k]->set_solved_density(phases[k], batch.rho[k]); }
+        }
+    }
+    void update_departure_function(rapidjson::Value& fit0data) {
+        for (CoolProp::HelmholtzEOSMixtureBackend *HEOS : get_distinct_HEOS()) {
             for (std::size_t i = 0; i <= 1; ++i){
                 std::size_t j = 1 - i;
                 HEOS->residual_helmholtz->Excess.DepartureFunctionMatrix[i][j].reset(new PhiFitDepartureFunction(fit0data["departure[ij]"]));
@@ -667,10 +1459,7 @@ public:
         }
     }
     void update_departure_function(const Coefficients& coeffs) {
-        for (auto &out : get_outputs()) {
-            NumericOutput *_out = static_cast<NumericOutput *>(out.get());
-            PhiFitInput * in = static_cast<PhiFitInput *>(_out->get_input().get());
-            CoolProp::HelmholtzEOSMixtureBackend *HEOS = static_cast<CoolProp::HelmholtzEOSMixtureBackend*>(in->get_AS().get());
+        for (CoolProp::HelmholtzEOSMixtureBackend *HEOS : get_distinct_HEOS()) {
             for (std::size_t i = 0; i <= 1; ++i) {
                 std::size_t j = 1 - i;
                 PhiFitDepartureFunction* p;
@@ -684,11 +1473,7 @@ public:
         }
     }
     void set_departure_function_by_name(const std::string& name){
-        for (auto &out : get_outputs()) {
-            NumericOutput *_out = static_cast<NumericOutput *>(out.get());
-            PhiFitInput * in = static_cast<PhiFitInput *>(_out->get_input().get());
-            CoolProp::HelmholtzEOSMixtureBackend *HEOS = static_cast<CoolProp::HelmholtzEOSMixtureBackend*>(in->get_AS().get());
-            
+        for (CoolProp::HelmholtzEOSMixtureBackend *HEOS : get_distinct_HEOS()) {
             for (std::size_t i = 0; i <= 1; ++i) {
                 std::size_t j = 1 - i;
                 HEOS->set_binary_interaction_double(i, j, "Fij", 1.0); // Turn on departure term
@@ -697,12 +1482,84 @@ public:
         }
     }
     void set_binary_interaction_double(const std::size_t i, const std::size_t j, const std::string &param, double val){
-        for (auto &out : get_outputs()) {
-            NumericOutput *_out = static_cast<NumericOutput *>(out.get());
-            PhiFitInput * in = static_cast<PhiFitInput *>(_out->get_input().get());
-            CoolProp::HelmholtzEOSMixtureBackend *HEOS = static_cast<CoolProp::HelmholtzEOSMixtureBackend*>(in->get_AS().get());
+        for (CoolProp::HelmholtzEOSMixtureBackend *HEOS : get_distinct_HEOS()) {
             HEOS->set_binary_interaction_double(i, j, param, val);
-
+        }
+    }
+    /// Get the telemetry of each data point (the outputs filled in by another output do no calculations of their own)
+    std::vector<PointTelemetry> get_point_telemetry() {
+        std::vector<PointTelemetry> points;
+        for (auto &out : get_outputs()) {
+            PhiFitOutput *o = static_cast<PhiFitOutput*>(out.get());
+            if (o->is_companion()) { continue; }
+            points.push_back(o->telemetry());
+        }
+        return points;
+    }
+    /// Get the telemetry aggregated by data type and by BibTeX key
+    TelemetrySummary get_telemetry_summary() {
+        std::vector<std::string> types, sources;
+        std::vector<bool> failing;
+        for (auto &out : get_outputs()) {
+            PhiFitOutput *o = static_cast<PhiFitOutput*>(out.get());
+            if (o->is_companion()) { continue; }
+            types.push_back(o->type_name());
+            sources.push_back(o->get_BibTeX());
+            failing.push_back(!o->error_message().empty());
+        }
+        return summarize_telemetry(get_point_telemetry(), types, sources, failing);
+    }
+    void reset_telemetry() {
+        for (auto &out : get_outputs()) {
+            static_cast<PhiFitOutput*>(out.get())->reset_telemetry();
+        }
+    }
+    /// Return the phifit departure function, or nullptr if the departure function is not a phifit departure function
+    PhiFitDepartureFunction *get_phifit_departure_function() {
+        if (get_outputs().empty()) { return nullptr; }
+        NumericOutput *_out = static_cast<NumericOutput *>(get_outputs()[0].get());
+        PhiFitInput * in = static_cast<PhiFitInput *>(_out->get_input().get());
+        CoolProp::HelmholtzEOSMixtureBackend *HEOS = static_cast<CoolProp::HelmholtzEOSMixtureBackend*>(in->get_AS().get());
+        return dynamic_cast<PhiFitDepartureFunction*>(HEOS->residual_helmholtz->Excess.DepartureFunctionMatrix[0][1].get());
+    }
+    double get_binary_interaction_double(const std::size_t i, const std::size_t j, const std::string &param) {
+        if (get_outputs().empty()) { throw CoolProp::ValueError("No outputs have been loaded"); }
+        NumericOutput *_out = static_cast<NumericOutput *>(get_outputs()[0].get());
+        PhiFitInput * in = static_cast<PhiFitInput *>(_out->get_input().get());
+        return in->get_AS()->get_binary_interaction_double(i, j, param);
+    }
+    /// Get the cached guess values for the liquid and vapor densities of the PTXY outputs
+    void get_cached_densities(std::vector<double> &rhoL, std::vector<double> &rhoV) {
+        rhoL.clear(); rhoV.clear();
+        for (auto &out : get_outputs()) {
+            PTXYOutput *PTXY = dynamic_cast<PTXYOutput*>(out.get());
+            if (PTXY != nullptr) {
+                rhoL.push_back(PTXY->get_PTXY_input()->rhoL());
+                rhoV.push_back(PTXY->get_PTXY_input()->rhoV());
+            }
+        }
+    }
+    /// Set the cached guess values for the liquid and vapor densities of the PTXY outputs
+    void set_cached_densities(const std::vector<double> &rhoL, const std::vector<double> &rhoV) {
+        std::size_t k = 0;
+        for (auto &out : get_outputs()) {
+            PTXYOutput *PTXY = dynamic_cast<PTXYOutput*>(out.get());
+            if (PTXY != nullptr) {
+                if (k >= rhoL.size() || k >= rhoV.size()) { throw CoolProp::ValueError("Too few cached densities for the PTXY outputs"); }
+                PTXY->get_PTXY_input()->set_rhoL(rhoL[k]);
+                PTXY->get_PTXY_input()->set_rhoV(rhoV[k]);
+                ++k;
+            }
+        }
+    }
+    /// Make the densities of the phases found by the last evaluation of each PTXY output its guess values, so that its next flashes start from them
+    void carry_over_densities() {
+        for (auto &out : get_outputs()) {
+            PTXYOutput *PTXY = dynamic_cast<PTXYOutput*>(out.get());
+            if (PTXY == nullptr) { continue; }
+            double rhoL = PTXY->flashed_density(0), rhoV = PTXY->flashed_density(1);
+            if (rhoL > 0 && std::isfinite(rhoL)) { PTXY->get_PTXY_input()->set_rhoL(rhoL); }
+            if (rhoV > 0 && std::isfinite(rhoV)) { PTXY->get_PTXY_input()->set_rhoV(rhoV); }
         }
     }
     std::string departure_function_to_JSON() {
@@ -730,9 +1587,161 @@ rapidjson::Document JSON_string_to_rapidjson(const std::string &JSON_string)
     return doc;
 }
 
-CoeffFitClass::CoeffFitClass(const std::string &JSON_data_string){
+/// Adapter that evaluates the residuals of a CoeffFitClass for the Levenberg-Marquardt optimizer
+class CoeffFitResidualProvider : public PhiFitResidualProvider {
+private:
+    CoeffFitClass &m_cfc;
+    bool m_threading;
+    short m_Nthreads;
+public:
+    CoeffFitResidualProvider(CoeffFitClass &cfc, bool threading, short Nthreads) : m_cfc(cfc), m_threading(threading), m_Nthreads(Nthreads) {};
+    void evaluate(const std::vector<double> &c, PhiFitNormalEquations &ne) {
+        if (m_cfc.m_streaming_normal_equations) {
+            m_cfc.evaluate_normal_equations(c, m_threading, m_Nthreads, ne);
+            return;
+        }
+        if (m_cfc.m_Nprocesses > 0) {
+            m_cfc.evaluate_processes(c);
+        }
+        else if (m_threading) {
+            m_cfc.evaluate_parallel(c, m_Nthreads);
+        }
+        else {
+            m_cfc.evaluate_serial(c);
+        }
+        auto startTime = std::chrono::high_resolution_clock::now();
+        const Eigen::MatrixXd &J = m_cfc.m_eval->get_Jacobian_matrix();
+        const Eigen::VectorXd &r = m_cfc.m_eval->get_error_vector();
+        ne.JtJ = J.transpose()*J;
+        ne.Jtr = J.transpose()*r;
+        ne.SSE = r.squaredNorm();
+        m_cfc.m_phase_times.assemble_sec += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+    }
+    Eigen::VectorXd solve(const PhiFitNormalEquations &ne, double mu) {
+        auto startTime = std::chrono::high_resolution_clock::now();
+        Eigen::VectorXd h = PhiFitResidualProvider::solve(ne, mu);
+        m_cfc.m_phase_times.solve_sec += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+        return h;
+    }
+    std::vector<Eigen::VectorXd> solve_candidates(const PhiFitNormalEquations &ne, const std::vector<double> &mus) {
+        auto startTime = std::chrono::high_resolution_clock::now();
+        std::vector<Eigen::VectorXd> hs = PhiFitResidualProvider::solve_candidates(ne, mus);
+        m_cfc.m_phase_times.solve_sec += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+        return hs;
+    }
+    /** With threading, each candidate is evaluated by a replica of the fitter on a worker of its own, the threads 
+     being shared out between them; without, the fitter evaluates them one after the other
+     */
+    void evaluate_candidates(const std::vector<std::vector<double> > &cs, std::vector<PhiFitNormalEquations> &nes) {
+        if (!m_threading) {
+            PhiFitResidualProvider::evaluate_candidates(cs, nes);
+            return;
+        }
+        std::vector<std::shared_ptr<CoeffFitClass> > &replicas = m_cfc.m_replicas;
+        while (replicas.size() < cs.size()) {
+            replicas.push_back(m_cfc.clone());
+            // As in the fitter, whose quarantine is suspended while candidates are evaluated
+            static_cast<MixtureEvaluator*>(replicas.back()->m_eval.get())->enable_quarantine(false);
+        }
+        // The density solver options change as the fit goes on
+        for (std::size_t j = 0; j < cs.size(); ++j) { replicas[j]->set_solver_options(m_cfc.solver_options()); }
+        std::shared_ptr<WorkerPool> &pool = m_cfc.m_candidate_pool;
+        if (!pool || pool->size() != cs.size()) {
+            pool.reset();
+            pool.reset(new WorkerPool(cs.size()));
+        }
+        nes.resize(cs.size());
+        const short Nthreads = std::max(static_cast<short>(m_Nthreads/static_cast<short>(cs.size())), static_cast<short>(1));
+        std::vector<double> busy;
+        auto startTime = std::chrono::high_resolution_clock::now();
+        pool->run([&replicas, &cs, &nes, Nthreads](std::size_t j) {
+            replicas[j]->evaluate_normal_equations(cs[j], Nthreads > 1, Nthreads, nes[j]);
+        }, busy);
+        m_cfc.m_phase_times.add_pass(std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count(), busy);
+    }
+};
+
+/// Provides the residuals of the training points of one fold from an evaluator of its own (see MixtureEvaluator::replicate)
+class FoldResidualProvider : public PhiFitResidualProvider {
+private:
+    MixtureEvaluator &m_eval;
+    WorkerPool m_pool; ///< Worker k evaluates block k of the outputs, the one that uses the k-th AbstractState of the evaluator
+    std::vector<bool> m_train; ///< True for the rows of the training points, false for those held out
+public:
+    double SSE_train, SSE_held_out; ///< Of the most recent pass
+    FoldResidualProvider(MixtureEvaluator &eval, const std::vector<std::size_t> &folds, std::size_t fold)
+        : m_eval(eval), m_pool(eval.m_replica_states.size()), SSE_train(0), SSE_held_out(0) {
+        for (std::size_t i = 0; i < folds.size(); ++i) { m_train.push_back(folds[i] != fold); }
+    };
+    void evaluate(const std::vector<double> &c, PhiFitNormalEquations &ne) {
+        m_eval.set_coefficients(c);
+        const std::size_t Nblocks = m_pool.size(), P = c.size();
+        std::vector<PhiFitNormalEquations> parts(Nblocks);
+        std::vector<double> held_out(Nblocks, 0.0), busy;
+        // Every point is evaluated (which also gives the held-out sum of squares), but only the training rows enter the normal equations
+        m_pool.run([this, Nblocks, P, &parts, &held_out](std::size_t k) {
+            std::size_t start = m_eval.block_start(k, Nblocks), end = m_eval.block_start(k + 1, Nblocks);
+            m_eval.evaluate_range(start, end, k);
+            const std::vector<std::shared_ptr<AbstractOutput> > &outputs = m_eval.get_outputs();
+            parts[k].reset(P);
+            for (std::size_t i = start; i < end; ++i) {
+                const std::vector<double> &J = outputs[i]->get_Jacobian_row();
+                if (J.size() != P) { throw CoolProp::ValueError(fmt::format("Jacobian row of output %d has length %d; expected %d", i, J.size(), P)); }
+                double r = outputs[i]->get_error();
+                if (m_train[i]) { parts[k].add_row(&(J[0]), r); } else { held_out[k] += r*r; }
+            }
+        }, busy);
+        reduce_normal_equations(parts);
+        std::swap(ne, parts[0]);
+        ne.symmetrize();
+        SSE_train = ne.SSE;
+        SSE_held_out = std::accumulate(held_out.begin(), held_out.end(), 0.0);
+    }
+};
+
+void PhiFitPhaseTimes::add_pass(double wall, const std::vector<double> &busy) {
+    Npasses++;
+    evaluate_sec += wall;
+    if (busy_sec.size() < busy.size()) {
+        busy_sec.resize(busy.size(), 0.0);
+        idle_sec.resize(busy.size(), 0.0);
+    }
+    for (std::size_t i = 0; i < busy.size(); ++i) {
+        busy_sec[i] += busy[i];
+        idle_sec[i] += wall - busy[i];
+    }
+}
+
+namespace {
+
+/// Append one object per entry of the optimizer trace to the JSON array val
+void trace_to_JSON(const std::vector<PhiFitTraceEntry> &trace, rapidjson::Value &val, rapidjson::Document &doc) {
+    for (auto &entry : trace) {
+        rapidjson::Value e; e.SetObject();
+        e.AddMember("iteration", static_cast<double>(entry.iter), doc.GetAllocator());
+        e.AddMember("start", entry.start, doc.GetAllocator());
+        // JSON has no NaN or infinity, so leave out what is not finite
+        if (std::isfinite(entry.SSE)) { e.AddMember("SSE", entry.SSE, doc.GetAllocator()); }
+        e.AddMember("mu", entry.mu, doc.GetAllocator());
+        e.AddMember("step norm", entry.step_norm, doc.GetAllocator());
+        if (std::isfinite(entry.gain)) { e.AddMember("gain", entry.gain, doc.GetAllocator()); }
+        e.AddMember("accepted", entry.accepted, doc.GetAllocator());
+        e.AddMember("residual evaluation (s)", entry.residual_sec, doc.GetAllocator());
+        e.AddMember("Jacobian assembly (s)", entry.jacobian_sec, doc.GetAllocator());
+        e.AddMember("linear solve (s)", entry.solve_sec, doc.GetAllocator());
+        val.PushBack(e, doc.GetAllocator());
+    }
+}
+
+}
+
+CoeffFitClass::CoeffFitClass(const std::string &JSON_data_string, bool slim_PRhoT) : CoeffFitClass(JSON_data_string, PrepareOptions(), slim_PRhoT) {}
+
+CoeffFitClass::CoeffFitClass(const std::string &JSON_data_string, const PrepareOptions &cache, bool slim_PRhoT) : m_elap_sec(0), m_checkpoint_every(0), m_pin_threads(false), m_Nprocesses(0), m_streaming_normal_equations(false), m_data_JSON(JSON_data_string), m_memo(new FitnessMemo()), m_model_key(0), m_model_key_valid(false) {
     // TODO: Validate the JSON against schema
-    rapidjson::Document datadoc = JSON_string_to_rapidjson(JSON_data_string);
+    std::string prepared = find_prepared_dataset(JSON_data_string, cache);
+    if (!prepared.empty()) { m_data_JSON = prepared; }
+    rapidjson::Document datadoc = JSON_string_to_rapidjson(m_data_JSON);
     std::vector<std::string> component_names = cpjson::get_string_array(datadoc["about"], std::string("names"));
 
     try {
@@ -747,23 +1756,50 @@ CoeffFitClass::CoeffFitClass(const std::string &JSON_data_string){
     // Instantiate the evaluator
     m_eval.reset(new MixtureEvaluator());
     MixtureEvaluator* mixeval = static_cast<MixtureEvaluator*>(m_eval.get());
+    mixeval->m_slim_PRhoT = slim_PRhoT;
     mixeval->add_terms("HEOS", strjoin(component_names, "&"), datadoc["data"]);
 
 }
+CoeffFitClass::~CoeffFitClass() {
+    std::shared_ptr<FitHandle> running = m_async.lock();
+    if (running) {
+        running->cancel();
+        // The fit uses this instance, so it must finish first; its error, if any, is left for the holder of the handle
+        try { running->wait(); }
+        catch (...) {}
+    }
+}
 void CoeffFitClass::setup(const Coefficients &coeffs){
     // Inject the desired departure function
     MixtureEvaluator* mixeval = static_cast<MixtureEvaluator*>(m_eval.get()); // Type-cast
     mixeval->update_departure_function(coeffs);
+    // The worker processes hold copies of the old departure function
+    m_shards.reset();
+    m_replicas.clear();
+    m_model_key_valid = false;
 }
 void CoeffFitClass::set_departure_function_by_name(const std::string &name){
     // Inject the desired departure function
     MixtureEvaluator* mixeval = static_cast<MixtureEvaluator*>(m_eval.get()); // Type-cast
     mixeval->set_departure_function_by_name(name);
+    m_departure_name = name;
+    // Setting the departure function turns it on
+    m_interaction_params["0,1,Fij"] = 1.0;
+    m_interaction_params["1,0,Fij"] = 1.0;
+    // The worker processes hold copies of the old departure function
+    m_shards.reset();
+    m_replicas.clear();
+    m_model_key_valid = false;
 }
 void CoeffFitClass::set_binary_interaction_double(const std::size_t i, const std::size_t j, const std::string &param, double val){
     // Inject the desired departure function
     MixtureEvaluator* mixeval = static_cast<MixtureEvaluator*>(m_eval.get()); // Type-cast
     mixeval->set_binary_interaction_double(i,j,param,val);
+    // The worker processes hold copies of the old departure function
+    m_shards.reset();
+    m_replicas.clear();
+    m_interaction_params[fmt::format("%d,%d,%s", i, j, param.c_str())] = val;
+    m_model_key_valid = false;
 }
 
 void CoeffFitClass::setup(const std::string &JSON_fit0_string)
@@ -777,27 +1813,780 @@ void CoeffFitClass::setup(const std::string &JSON_fit0_string)
     // Inject the desired departure function
     MixtureEvaluator* mixeval = static_cast<MixtureEvaluator*>(m_eval.get()); // Type-cast
     mixeval->update_departure_function(fit0doc);
+    m_departure_name.clear();
+    // Setting the departure function turns it on
+    m_interaction_params["0,1,Fij"] = 1.0;
+    m_interaction_params["1,0,Fij"] = 1.0;
+    // The worker processes hold copies of the old departure function
+    m_shards.reset();
+    m_replicas.clear();
+    m_model_key_valid = false;
 }
 void CoeffFitClass::run(bool threading, short Nthreads, const std::vector<double> &c0){
+    m_LM_state = PhiFitLMState();
+    m_phase_times = PhiFitPhaseTimes();
+    m_trace.clear();
+    optimize(threading, Nthreads, c0);
+}
+std::shared_ptr<FitHandle> CoeffFitClass::run_async(bool threading, short Nthreads, const std::vector<double> &c0, const std::shared_ptr<ThreadBudget> &budget, const PhiFitLMCallback &callback){
+    std::shared_ptr<FitHandle> running = m_async.lock();
+    if (running && !running->done()) { throw CoolProp::ValueError("A fit is already running on this instance"); }
+    std::shared_ptr<FitHandle> handle(new FitHandle());
+    m_async = handle;
+    handle->start([this, threading, Nthreads, c0, budget, callback](FitHandle &h) {
+        ThreadBudgetLease lease(*budget, threading ? std::max(Nthreads, static_cast<short>(1)) : 1, h.cancel_flag());
+        if (h.cancelled()) { h.finish(FIT_CANCELLED, c0); return; }
+        h.set_running(lease.size());
+        m_LM_state = PhiFitLMState();
+        m_phase_times = PhiFitPhaseTimes();
+        m_trace.clear();
+        optimize(threading, static_cast<short>(lease.size()), c0, h.cancel_flag(), [&h, &callback](const PhiFitLMState &state) {
+            h.update(state);
+            if (callback) { callback(state); }
+        });
+        h.finish(m_LM_state.converged ? FIT_CONVERGED : (h.cancelled() ? FIT_CANCELLED : FIT_STOPPED), m_cfinal);
+    });
+    return handle;
+}
+FitScheduleResult CoeffFitClass::run_schedule(bool threading, short Nthreads, const std::vector<double> &c0, const FitScheduleOptions &o){
+    auto startTime = std::chrono::high_resolution_clock::now();
+    // Only the data points that are enabled take part
+    std::vector<std::size_t> ids;
+    std::vector<std::string> sources;
+    const std::vector<std::shared_ptr<AbstractOutput> > &outputs = m_eval->get_outputs();
+    MixtureEvaluator* mixeval = static_cast<MixtureEvaluator*>(m_eval.get());
+    const std::vector<std::size_t> &output_ids = mixeval->m_ids;
+    for (std::size_t i = 0; i < outputs.size(); ++i) {
+        PhiFitOutput *po = static_cast<PhiFitOutput*>(outputs[i].get());
+        if (po->is_companion()) { continue; }
+        ids.push_back(output_ids[i]);
+        sources.push_back(po->get_BibTeX());
+    }
+    std::vector<double> fractions;
+    for (auto &stage : o.stages) { fractions.push_back(stage.fraction); }
+    FitScheduleResult result;
+    result.first_stage = assign_stages(sources, fractions, o.seed, o.stratify);
+
+    m_phase_times = PhiFitPhaseTimes();
+    m_trace.clear();
+    std::vector<double> c = c0;
+    try {
+        for (std::size_t k = 0; k < ids.size(); ++k) {
+            if (result.first_stage[k] > 0) { set_point_enabled(ids[k], false); }
+        }
+        for (std::size_t s = 0; s < o.stages.size(); ++s) {
+            auto stageStartTime = std::chrono::high_resolution_clock::now();
+            StageResult stage;
+            stage.stage = s;
+            for (std::size_t k = 0; k < ids.size(); ++k) {
+                if (s > 0 && result.first_stage[k] == s) { set_point_enabled(ids[k], true); }
+                if (result.first_stage[k] <= s) { stage.Npoints++; }
+            }
+            // Start from the coefficients of the previous stage, but not its damping, since J^T*J grows with the number of points
+            m_LM_state = PhiFitLMState();
+            std::vector<PointTelemetry> before = mixeval->get_point_telemetry();
+            optimize(threading, Nthreads, c, nullptr, PhiFitLMCallback(), &(o.stages[s]));
+            c = m_cfinal;
+            std::vector<PointTelemetry> after = mixeval->get_point_telemetry();
+            for (std::size_t k = 0; k < after.size(); ++k) {
+                for (std::size_t i = 0; i < FLASH_TYPE_COUNT; ++i) { stage.Nflash[i] += after[k].Nflash[i] - before[k].Nflash[i]; }
+            }
+            // The points of the next stage that were fitted in this one start their flashes from the densities found here
+            mixeval->carry_over_densities();
+            stage.Nresiduals = m_eval->get_outputs_size();
+            stage.iter = m_LM_state.iter;
+            stage.SSE = m_LM_state.SSE;
+            stage.converged = m_LM_state.converged;
+            stage.c = c;
+            stage.elapsed_sec = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - stageStartTime).count();
+            result.stages.push_back(stage);
+        }
+    }
+    catch (...) {
+        for (std::size_t id : ids) { set_point_enabled(id, true); }
+        throw;
+    }
+    result.elapsed_sec = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+    m_elap_sec = result.elapsed_sec;
+    return result;
+}
+void CoeffFitClass::resume(bool threading, short Nthreads, const std::string &path){
+    FitCheckpoint checkpoint = ::load_checkpoint(path);
+    apply_checkpoint(checkpoint, path);
+    if (m_LM_state.initialized) {
+        optimize(threading, Nthreads, m_LM_state.c);
+    }
+    else if (!checkpoint.c.empty()) {
+        optimize(threading, Nthreads, checkpoint.c);
+    }
+    else {
+        throw CoolProp::ValueError(fmt::format("Checkpoint %s has neither an optimizer state nor coefficients to resume from", path.c_str()));
+    }
+}
+void CoeffFitClass::optimize(bool threading, short Nthreads, const std::vector<double> &c0, const std::atomic<bool> *cancel, const PhiFitLMCallback &progress, const FitStage *stage){
     auto startTime = std::chrono::system_clock::now();
-    LevenbergMarquardtOptions opts;
+    PhiFitLMOptions opts;
     opts.c0 = c0; 
-    opts.threading = threading; 
-    opts.Nthreads = Nthreads; 
     opts.omega = 0.35;
-    m_cfinal = LevenbergMarquardt(m_eval, opts);
+    opts.cancel = cancel;
+    opts.mu_factors = m_damping_candidates;
+    if (stage != nullptr) {
+        opts.epsilon1 = stage->epsilon1;
+        opts.epsilon2 = stage->epsilon2;
+        opts.Nmax = stage->Nmax;
+    }
+    CoeffFitResidualProvider provider(*this, threading, Nthreads);
+    // The time of each iteration is the growth of the phase times since the previous one
+    PhiFitPhaseTimes times = m_phase_times;
+    // The densities are solved for loosely to begin with, and more tightly as the steps get smaller
+    bool polishing = false;
+    double SSE_accepted = m_LM_state.initialized ? m_LM_state.SSE : std::numeric_limits<double>::quiet_NaN();
+    adapt_solver_tolerance(std::numeric_limits<double>::infinity());
+    // The options in force when the last accepted point was evaluated
+    PTDensitySolverOptions at_accepted = solver_options();
+    PhiFitLMCallback callback = [this, &times, &progress, &polishing, &SSE_accepted, &at_accepted](const PhiFitLMState &state) {
+        PhiFitTraceEntry entry;
+        static_cast<PhiFitLMIteration &>(entry) = state.last;
+        entry.residual_sec = (m_phase_times.install_sec - times.install_sec) + (m_phase_times.evaluate_sec - times.evaluate_sec);
+        entry.jacobian_sec = m_phase_times.assemble_sec - times.assemble_sec;
+        entry.solve_sec = m_phase_times.solve_sec - times.solve_sec;
+        m_trace.push_back(entry);
+        times = m_phase_times;
+        if (m_checkpoint_every > 0 && !state.last.start && state.iter % m_checkpoint_every == 0) { save_checkpoint(m_checkpoint_path); }
+        if (state.last.accepted) { at_accepted = solver_options(); }
+        if (!polishing && !state.last.start && state.last.accepted) {
+            double c_norm = Eigen::Map<const Eigen::VectorXd>(&(state.c[0]), state.c.size()).norm();
+            double SSE_change = std::abs(SSE_accepted - state.SSE)/std::max(state.SSE, std::numeric_limits<double>::min());
+            adapt_solver_tolerance(std::max(state.last.step_norm/std::max(c_norm, 1e-300), std::isfinite(SSE_change) ? SSE_change : 0.0));
+        }
+        if (state.last.accepted) { SSE_accepted = state.SSE; }
+        if (progress) { progress(state); }
+    };
+    // The candidates are evaluated by replicas whose quarantine state would differ from that of this instance, 
+    // so that the sums of squares could not be compared; every point is evaluated, as in cross-validation
+    MixtureEvaluator* mixeval = static_cast<MixtureEvaluator*>(m_eval.get());
+    const bool quarantine_enabled = mixeval->m_quarantine_enabled;
+    if (!m_damping_candidates.empty()) { mixeval->enable_quarantine(false); }
+    try {
+        PhiFitLevenbergMarquardt(provider, opts, m_LM_state, callback);
+        if (at_accepted.rtol != m_full_solver_options.rtol || at_accepted.Nmax != m_full_solver_options.Nmax) {
+            // Polish at full precision; resuming evaluates again at the last accepted coefficients
+            polishing = true;
+            adapt_solver_tolerance(0);
+            if (!(cancel != nullptr && *cancel)) {
+                opts.Nmax = m_LM_state.iter + m_adaptive_tolerance.Nmax_polish;
+                PhiFitLevenbergMarquardt(provider, opts, m_LM_state, callback);
+            }
+        }
+    }
+    catch (...) {
+        adapt_solver_tolerance(0);
+        mixeval->enable_quarantine(quarantine_enabled);
+        throw;
+    }
+    mixeval->enable_quarantine(quarantine_enabled);
+    m_cfinal = m_LM_state.c;
+    if (m_checkpoint_every > 0) { save_checkpoint(m_checkpoint_path); }
     //for (int i = 0; i < cc.size(); i += 1) { std::cout << cc[i] << std::endl; }
     m_elap_sec = std::chrono::duration<double>(std::chrono::system_clock::now() - startTime).count();
 }
+void CoeffFitClass::set_checkpointing(const std::string &path, std::size_t N){
+    m_checkpoint_path = path;
+    m_checkpoint_every = N;
+}
+void CoeffFitClass::save_checkpoint(const std::string &path, const std::string &user_data){
+    MixtureEvaluator* mixeval = static_cast<MixtureEvaluator*>(m_eval.get());
+    FitCheckpoint checkpoint;
+    checkpoint.Noutputs = m_eval->get_outputs_size();
+    checkpoint.c = m_eval->get_const_coefficients();
+    PhiFitDepartureFunction *pdep = mixeval->get_phifit_departure_function();
+    if (pdep != nullptr) {
+        // Store in the same form as is passed to setup()
+        rapidjson::Document doc; doc.SetObject();
+        rapidjson::Value dep = pdep->to_JSON(doc);
+        doc.AddMember("departure[ij]", dep, doc.GetAllocator());
+        checkpoint.departure_JSON = cpjson::json2string(doc);
+    }
+    checkpoint.departure_name = m_departure_name;
+    checkpoint.Fij = mixeval->get_binary_interaction_double(0, 1, "Fij");
+    mixeval->get_cached_densities(checkpoint.rhoL, checkpoint.rhoV);
+    checkpoint.LM = m_LM_state;
+    checkpoint.user_data = user_data;
+    ::save_checkpoint(path, checkpoint);
+}
+std::string CoeffFitClass::load_checkpoint(const std::string &path){
+    FitCheckpoint checkpoint = ::load_checkpoint(path);
+    apply_checkpoint(checkpoint, path);
+    return checkpoint.user_data;
+}
+void CoeffFitClass::apply_checkpoint(const FitCheckpoint &checkpoint, const std::string &path){
+    MixtureEvaluator* mixeval = static_cast<MixtureEvaluator*>(m_eval.get());
+    if (checkpoint.Noutputs != m_eval->get_outputs_size()) {
+        throw CoolProp::ValueError(fmt::format("Checkpoint %s was written for %d outputs, but %d outputs are loaded", path.c_str(), checkpoint.Noutputs, m_eval->get_outputs_size()));
+    }
+    if (checkpoint.departure_JSON.empty() && checkpoint.departure_name.empty() && (!m_departure_name.empty() || mixeval->get_phifit_departure_function() != nullptr)) {
+        throw CoolProp::ValueError(fmt::format("Checkpoint %s has no departure function, but one is set on this instance", path.c_str()));
+    }
+    // In the same order as clone(): a phifit departure function replaces the one set by name
+    if (!checkpoint.departure_name.empty()) {
+        set_departure_function_by_name(checkpoint.departure_name);
+    }
+    if (!checkpoint.departure_JSON.empty()) {
+        setup(checkpoint.departure_JSON);
+    }
+    // Setting up the departure function turns it on; restore its weight afterwards
+    mixeval->set_binary_interaction_double(0, 1, "Fij", checkpoint.Fij);
+    mixeval->set_cached_densities(checkpoint.rhoL, checkpoint.rhoV);
+    m_shards.reset();
+    m_replicas.clear();
+    m_interaction_params["0,1,Fij"] = checkpoint.Fij;
+    m_model_key_valid = false;
+    if (!checkpoint.c.empty()) {
+        m_eval->set_coefficients(checkpoint.c);
+    }
+    m_LM_state = checkpoint.LM;
+    if (m_LM_state.initialized) {
+        m_cfinal = m_LM_state.c;
+    }
+}
 /// Just evaluate the residual vector, and cache values internally
 void CoeffFitClass::evaluate_serial(const std::vector<double> &c0) {
+    auto startTime = std::chrono::high_resolution_clock::now();
     m_eval->set_coefficients(c0);
-    m_eval->evaluate_serial(0, m_eval->get_outputs_size(), 0);
+    auto evalTime = std::chrono::high_resolution_clock::now();
+    static_cast<MixtureEvaluator*>(m_eval.get())->evaluate_range(0, m_eval->get_outputs_size(), 0);
+    auto endTime = std::chrono::high_resolution_clock::now();
+    m_phase_times.install_sec += std::chrono::duration<double>(evalTime - startTime).count();
+    double wall = std::chrono::duration<double>(endTime - evalTime).count();
+    m_phase_times.add_pass(wall, std::vector<double>(1, wall));
 }
 /// Just evaluate the residual vector, and cache values internally
 void CoeffFitClass::evaluate_parallel(const std::vector<double> &c0, short Nthreads) {
+    parallel_pass(c0, Nthreads, nullptr);
+}
+void CoeffFitClass::parallel_pass(const std::vector<double> &c0, short Nthreads, std::vector<PhiFitNormalEquations> *parts) {
+    auto startTime = std::chrono::high_resolution_clock::now();
+    m_eval->set_coefficients(c0);
+    auto evalTime = std::chrono::high_resolution_clock::now();
+    m_phase_times.install_sec += std::chrono::duration<double>(evalTime - startTime).count();
+
+    // Each worker evaluates the same contiguous block of outputs on every pass, and keeps track of how long it was busy
+    if (Nthreads < 1) { throw CoolProp::ValueError("Nthreads must be at least 1"); }
+    if (!m_pool || m_pool->size() != static_cast<std::size_t>(Nthreads)) {
+        m_pool.reset();
+        m_pool.reset(new WorkerPool(Nthreads, m_pin_threads));
+    }
+    std::vector<double> busy;
+    MixtureEvaluator* mixeval = static_cast<MixtureEvaluator*>(m_eval.get());
+    if (parts != nullptr) { parts->resize(Nthreads); }
+    m_pool->run([mixeval, Nthreads, parts](std::size_t i) {
+        std::size_t start = mixeval->block_start(i, Nthreads), end = mixeval->block_start(i + 1, Nthreads);
+        mixeval->evaluate_range(start, end, i);
+        // Fold the rows into this worker's sums while they are still in its cache
+        if (parts != nullptr) { mixeval->accumulate_normal_equations(start, end, (*parts)[i]); }
+    }, busy);
+    m_phase_times.add_pass(std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - evalTime).count(), busy);
+}
+void CoeffFitClass::evaluate_normal_equations(const std::vector<double> &c0, bool threading, short Nthreads, PhiFitNormalEquations &ne) {
+    MixtureEvaluator* mixeval = static_cast<MixtureEvaluator*>(m_eval.get());
+    std::vector<PhiFitNormalEquations> parts;
+    if (m_Nprocesses == 0 && threading) {
+        parallel_pass(c0, Nthreads, &parts);
+    }
+    else {
+        if (m_Nprocesses > 0) {
+            evaluate_processes(c0);
+        }
+        else {
+            evaluate_serial(c0);
+        }
+        parts.resize(1);
+        mixeval->accumulate_normal_equations(0, m_eval->get_outputs_size(), parts[0]);
+    }
+    auto startTime = std::chrono::high_resolution_clock::now();
+    reduce_normal_equations(parts);
+    std::swap(ne, parts[0]);
+    ne.symmetrize();
+    m_phase_times.assemble_sec += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+}
+std::shared_ptr<CoeffFitClass> CoeffFitClass::clone() {
+    MixtureEvaluator* mixeval = static_cast<MixtureEvaluator*>(m_eval.get());
+    std::shared_ptr<CoeffFitClass> other(new CoeffFitClass(m_data_JSON, mixeval->m_slim_PRhoT));
+    if (!m_departure_name.empty()) {
+        other->set_departure_function_by_name(m_departure_name);
+    }
+    PhiFitDepartureFunction *pdep = mixeval->get_phifit_departure_function();
+    if (pdep != nullptr) {
+        // In the same form as is passed to setup()
+        rapidjson::Document doc; doc.SetObject();
+        rapidjson::Value dep = pdep->to_JSON(doc);
+        doc.AddMember("departure[ij]", dep, doc.GetAllocator());
+        other->setup(cpjson::json2string(doc));
+    }
+    other->set_binary_interaction_double(0, 1, "Fij", mixeval->get_binary_interaction_double(0, 1, "Fij"));
+    MixtureEvaluator* othereval = static_cast<MixtureEvaluator*>(other->m_eval.get());
+    othereval->m_batch_PT_densities = mixeval->m_batch_PT_densities;
+    othereval->m_density_solver_options = mixeval->m_density_solver_options;
+    other->m_full_solver_options = m_full_solver_options;
+    other->m_adaptive_tolerance = m_adaptive_tolerance;
+    other->m_damping_candidates = m_damping_candidates;
+    othereval->m_quarantine_policy = mixeval->m_quarantine_policy;
+    other->m_pin_threads = m_pin_threads;
+    other->m_streaming_normal_equations = m_streaming_normal_equations;
+    other->m_interaction_params = m_interaction_params;
+    // Replay the changes to the dataset, so that the identifiers of the points match
+    for (auto &JSON : m_added_JSON) { other->add_points(JSON); }
+    if (!m_removed_ids.empty()) { other->remove_points(m_removed_ids); }
+    for (std::size_t id : disabled_point_ids()) { other->set_point_enabled(id, false); }
+    // A memo of its own, so that the clone's evaluation settings cannot leak into the memo of this instance
+    FitnessMemo::Stats memo = m_memo->stats();
+    other->set_memo(memo.capacity, m_memo->store_residuals());
+    return other;
+}
+void CoeffFitClass::set_memo(std::size_t capacity, bool store_residuals) {
+    // A new memo rather than clearing the old one, which clones may still be using
+    m_memo.reset(new FitnessMemo(capacity, store_residuals));
+}
+std::uint64_t CoeffFitClass::model_key() {
+    MixtureEvaluator* mixeval = static_cast<MixtureEvaluator*>(m_eval.get());
+    if (!m_model_key_valid) {
+        std::string model = m_departure_name + "|";
+        PhiFitDepartureFunction *pdep = mixeval->get_phifit_departure_function();
+        if (pdep != nullptr) {
+            rapidjson::Document doc;
+            rapidjson::Value dep = pdep->to_JSON(doc);
+            model += cpjson::json2string(dep);
+        }
+        // Setting up the departure function can change Fij, so take its current value
+        model += fmt::format("|Fij=%.17g|", mixeval->get_binary_interaction_double(0, 1, "Fij"));
+        for (auto &param : m_interaction_params) {
+            model += param.first + "=" + fmt::format("%.17g", param.second) + ";";
+        }
+        const std::vector<std::size_t> &ids = mixeval->m_ids;
+        std::uint64_t data_key = ids.empty() ? 0 : fnv1a_hash(&(ids[0]), ids.size()*sizeof(std::size_t));
+        for (auto &JSON : m_added_JSON) { data_key = fnv1a_hash(JSON.data(), JSON.size(), data_key); }
+        model += fmt::format("data=%016llx|", static_cast<unsigned long long>(data_key));
+        // A loosely solved density changes the residuals a little
+        model += fmt::format("rtol=%.17g;Nmax=%d", mixeval->m_density_solver_options.rtol, mixeval->m_density_solver_options.Nmax);
+        m_model_key = fnv1a_hash(model.data(), model.size());
+        m_model_key_valid = true;
+    }
+    // The quarantine policy (including the penalty of failed points) changes the residuals; it is toggled during a run, so it is not cached
+    const QuarantinePolicy &q = mixeval->m_quarantine_policy;
+    std::string quarantine = mixeval->m_quarantine_enabled
+        ? fmt::format("quarantine=%d;%.17g;%.17g;%d", q.max_failures, q.penalty, q.retry_shift, q.retry_every)
+        : std::string("quarantine=off");
+    return fnv1a_hash(quarantine.data(), quarantine.size(), m_model_key);
+}
+double CoeffFitClass::evaluate_sum_of_squares(const std::vector<double> &c0, short Nthreads) {
+    std::uint64_t key = model_key();
+    FitnessMemo::Entry entry;
+    if (m_memo->find(c0, key, entry)) {
+        return entry.SSE;
+    }
+    if (Nthreads > 1) {
+        evaluate_parallel(c0, Nthreads);
+    }
+    else {
+        evaluate_serial(c0);
+    }
+    double SSE = sum_of_squares();
+    m_memo->insert(c0, key, SSE, m_memo->store_residuals() ? errorvec() : std::vector<double>());
+    return SSE;
+}
+std::vector<double> CoeffFitClass::memoized_residuals(const std::vector<double> &c0) {
+    FitnessMemo::Entry entry;
+    if (m_memo->find(c0, model_key(), entry, false)) {
+        return entry.residuals;
+    }
+    return std::vector<double>();
+}
+void CoeffFitClass::apply_model(CoolProp::HelmholtzEOSMixtureBackend *HEOS) {
+    MixtureEvaluator* mixeval = static_cast<MixtureEvaluator*>(m_eval.get());
+    for (auto &param : m_interaction_params) {
+        // The keys are "i,j,param"
+        std::vector<std::string> parts = strsplit(param.first, ',');
+        HEOS->set_binary_interaction_double(std::stoi(parts[0]), std::stoi(parts[1]), parts[2], param.second);
+    }
+    if (!m_departure_name.empty()) {
+        for (std::size_t i = 0; i <= 1; ++i) {
+            HEOS->set_binary_interaction_string(i, 1 - i, "function", m_departure_name);
+        }
+    }
+    PhiFitDepartureFunction *pdep = mixeval->get_phifit_departure_function();
+    if (pdep != nullptr) {
+        rapidjson::Document doc; doc.SetObject();
+        rapidjson::Value dep = pdep->to_JSON(doc);
+        doc.AddMember("departure[ij]", dep, doc.GetAllocator());
+        for (std::size_t i = 0; i <= 1; ++i) {
+            std::size_t j = 1 - i;
+            HEOS->residual_helmholtz->Excess.DepartureFunctionMatrix[i][j].reset(new PhiFitDepartureFunction(doc["departure[ij]"]));
+            HEOS->SatL->residual_helmholtz->Excess.DepartureFunctionMatrix[i][j].reset(new PhiFitDepartureFunction(doc["departure[ij]"]));
+            HEOS->SatV->residual_helmholtz->Excess.DepartureFunctionMatrix[i][j].reset(new PhiFitDepartureFunction(doc["departure[ij]"]));
+        }
+    }
+    for (std::size_t i = 0; i <= 1; ++i) {
+        HEOS->set_binary_interaction_double(i, 1 - i, "Fij", mixeval->get_binary_interaction_double(i, 1 - i, "Fij"));
+    }
+}
+std::shared_ptr<CoolProp::AbstractState> CoeffFitClass::model_state(const std::vector<double> &c) {
+    MixtureEvaluator* mixeval = static_cast<MixtureEvaluator*>(m_eval.get());
+    std::shared_ptr<CoolProp::AbstractState> AS(CoolProp::AbstractState::factory(mixeval->m_backend, mixeval->m_fluids));
+    apply_model(static_cast<CoolProp::HelmholtzEOSMixtureBackend*>(AS.get()));
+    if (c.size() >= 4) {
+        const char *params[] = { "betaT", "gammaT", "betaV", "gammaV" };
+        for (std::size_t k = 0; k < 4; ++k) {
+            AS->set_binary_interaction_double(0, 1, params[k], c[k]);
+        }
+    }
+    return AS;
+}
+std::vector<std::size_t> CoeffFitClass::add_points(const std::string &JSON_data_string) {
+    MixtureEvaluator* mixeval = static_cast<MixtureEvaluator*>(m_eval.get());
+    rapidjson::Document datadoc = JSON_string_to_rapidjson(JSON_data_string);
+    if (!datadoc.HasMember("data") || !datadoc["data"].IsArray()) { throw CoolProp::ValueError("The points to add have no \"data\" array"); }
+    if (datadoc.HasMember("about") && datadoc["about"].HasMember("names")) {
+        std::string fluids = strjoin(cpjson::get_string_array(datadoc["about"], std::string("names")), "&");
+        if (fluids != mixeval->m_fluids) { throw CoolProp::ValueError(fmt::format("The points to add are for %s, not %s", fluids.c_str(), mixeval->m_fluids.c_str())); }
+    }
+    const std::size_t N0 = m_eval->get_outputs_size();
+    mixeval->add_terms(mixeval->m_backend, mixeval->m_fluids, datadoc["data"]);
+    // Only the new points need the current departure function and interaction parameters; the others keep their state
+    for (CoolProp::HelmholtzEOSMixtureBackend *HEOS : mixeval->get_own_HEOS(N0)) {
+        apply_model(HEOS);
+    }
+    m_added_JSON.push_back(JSON_data_string);
+    data_changed();
+    std::vector<std::size_t> ids(mixeval->m_ids.begin() + N0, mixeval->m_ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    return ids;
+}
+void CoeffFitClass::remove_points(const std::vector<std::size_t> &ids) {
+    static_cast<MixtureEvaluator*>(m_eval.get())->remove_outputs(ids);
+    m_removed_ids.insert(m_removed_ids.end(), ids.begin(), ids.end());
+    data_changed();
+}
+void CoeffFitClass::set_point_enabled(std::size_t id, bool enabled) {
+    static_cast<MixtureEvaluator*>(m_eval.get())->set_output_enabled(id, enabled);
+    data_changed();
+}
+std::vector<std::size_t> CoeffFitClass::point_ids() {
+    return static_cast<MixtureEvaluator*>(m_eval.get())->m_ids;
+}
+std::vector<std::size_t> CoeffFitClass::disabled_point_ids() {
+    std::vector<std::size_t> ids;
+    for (auto &dis : static_cast<MixtureEvaluator*>(m_eval.get())->m_disabled) {
+        if (ids.empty() || ids.back() != dis.first) { ids.push_back(dis.first); }
+    }
+    return ids;
+}
+std::vector<std::size_t> CoeffFitClass::points_of_source(const std::string &BibTeX) {
+    MixtureEvaluator* mixeval = static_cast<MixtureEvaluator*>(m_eval.get());
+    std::vector<std::size_t> ids;
+    for (std::size_t i = 0; i < mixeval->m_ids.size(); ++i) {
+        if (static_cast<PhiFitOutput*>(m_eval->get_outputs()[i].get())->get_BibTeX() == BibTeX) { ids.push_back(mixeval->m_ids[i]); }
+    }
+    for (auto &dis : mixeval->m_disabled) {
+        if (static_cast<PhiFitOutput*>(dis.second.get())->get_BibTeX() == BibTeX) { ids.push_back(dis.first); }
+    }
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    return ids;
+}
+void CoeffFitClass::data_changed() {
+    // The worker processes and the replicas hold copies of the old outputs, and the memo keys must tell the datasets apart
+    m_shards.reset();
+    m_replicas.clear();
+    m_model_key_valid = false;
+}
+ValidationReport CoeffFitClass::validate(const std::vector<double> &c, const ValidationOptions &o) {
+    auto startTime = std::chrono::high_resolution_clock::now();
+    MixtureEvaluator* mixeval = static_cast<MixtureEvaluator*>(m_eval.get());
+    // Every point is evaluated, quarantined or not, and the quarantine state is left as it was
+    const bool quarantine_enabled = mixeval->m_quarantine_enabled;
+    mixeval->enable_quarantine(false);
+    try {
+        if (o.Nthreads > 1) {
+            evaluate_parallel(c, o.Nthreads);
+        }
+        else {
+            evaluate_serial(c);
+        }
+    }
+    catch (...) {
+        mixeval->enable_quarantine(quarantine_enabled);
+        throw;
+    }
+    mixeval->enable_quarantine(quarantine_enabled);
+
+    std::vector<double> dev, temperatures;
+    std::vector<std::string> types, sources;
+    std::vector<bool> failed;
+    for (auto &out : m_eval->get_outputs()) {
+        PhiFitOutput *po = static_cast<PhiFitOutput*>(out.get());
+        dev.push_back(po->y_calc());
+        types.push_back(po->type_name());
+        sources.push_back(po->get_BibTeX());
+        failed.push_back(!po->error_message().empty());
+        if (std::string(po->type_name()) == "PTXY") {
+            // The isotherms are at the temperatures of the data, to within 0.01 K
+            double T = std::round(static_cast<PTXYInput*>(po->get_input().get())->T()*100)/100;
+            if (std::find(temperatures.begin(), temperatures.end(), T) == temperatures.end()) { temperatures.push_back(T); }
+        }
+    }
+    ValidationReport report;
+    report.deviations = summarize_deviations(dev, types, sources, failed);
+    if (o.isotherms) {
+        std::sort(temperatures.begin(), temperatures.end());
+        report.isotherms = evaluate_isotherms([this, &c]() { return model_state(c); }, temperatures, o);
+    }
+    report.elapsed_sec = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+    return report;
+}
+std::string CoeffFitClass::validation_to_JSON(const std::vector<double> &c, const ValidationOptions &o) {
+    return ::validation_to_JSON(validate(c, o));
+}
+CrossValidationResult CoeffFitClass::cross_validate(const CrossValidationOptions &o) {
+    auto startTime = std::chrono::high_resolution_clock::now();
+    // The folds are assigned by data point, so that the residuals of a point are held out together
+    std::vector<std::string> sources;
+    std::vector<std::size_t> point_of_output;
+    const std::vector<std::shared_ptr<AbstractOutput> > &outputs = m_eval->get_outputs();
+    for (std::size_t i = 0; i < outputs.size(); ++i) {
+        PhiFitOutput *po = static_cast<PhiFitOutput*>(outputs[i].get());
+        if (!po->is_companion()) { sources.push_back(po->get_BibTeX()); }
+        point_of_output.push_back(sources.size() - 1);
+    }
+    std::vector<std::size_t> point_folds = assign_folds(sources, o.k, o.seed, o.stratify);
+    CrossValidationResult result;
+    for (std::size_t i = 0; i < point_of_output.size(); ++i) { result.assignment.push_back(point_folds[point_of_output[i]]); }
+    result.folds.resize(o.k);
+
+    // Each fold is fitted with an evaluator of its own, so that the folds run concurrently. The evaluators share the 
+    // loaded data points with this instance, and a fold only builds one AbstractState of the current model for each 
+    // of its blocks of points. Every point is evaluated, so that the held-out sums of squares of the folds are comparable
+    if (o.Nthreads < 1) { throw CoolProp::ValueError("Nthreads must be at least 1"); }
+    MixtureEvaluator* mixeval = static_cast<MixtureEvaluator*>(m_eval.get());
+    std::vector<std::shared_ptr<MixtureEvaluator> > evaluators;
+    for (std::size_t f = 0; f < o.k; ++f) {
+        std::vector<std::shared_ptr<CoolProp::AbstractState> > states;
+        for (short k = 0; k < o.Nthreads; ++k) { states.push_back(model_state(std::vector<double>())); }
+        evaluators.push_back(mixeval->replicate(states));
+        evaluators.back()->enable_quarantine(false);
+    }
+    std::vector<std::exception_ptr> errors(o.k);
+    std::vector<std::thread> threads;
+    for (std::size_t f = 0; f < o.k; ++f) {
+        threads.push_back(std::thread([&, f]() {
+            try {
+                FoldResidualProvider provider(*evaluators[f], result.assignment, f);
+                PhiFitLMOptions opts;
+                opts.c0 = o.c0;
+                opts.omega = 0.35;
+                PhiFitLMState state;
+                PhiFitLevenbergMarquardt(provider, opts, state);
+                // The optimizer leaves the provider holding the pass at the final coefficients
+                FoldResult &fold = result.folds[f];
+                fold.fold = f;
+                fold.Nheld_out = std::count(result.assignment.begin(), result.assignment.end(), f);
+                fold.Ntrain = result.assignment.size() - fold.Nheld_out;
+                fold.iter = state.iter;
+                fold.converged = state.converged;
+                fold.c = state.c;
+                fold.SSE_train = provider.SSE_train;
+                fold.SSE_held_out = provider.SSE_held_out;
+            }
+            catch (...) {
+                errors[f] = std::current_exception();
+            }
+        }));
+    }
+    for (auto &t : threads) { t.join(); }
+    for (auto &e : errors) {
+        if (e) { std::rethrow_exception(e); }
+    }
+    result.elapsed_sec = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+    return result;
+}
+void CoeffFitClass::set_damping_candidates(const std::vector<double> &factors) {
+    for (double f : factors) {
+        if (!(f > 0)) { throw CoolProp::ValueError(fmt::format("The damping factors must be positive; %g was given", f)); }
+    }
+    m_damping_candidates = factors;
+}
+void CoeffFitClass::set_adaptive_tolerance(const AdaptiveToleranceOptions &o) {
+    m_adaptive_tolerance = o;
+}
+void CoeffFitClass::adapt_solver_tolerance(double progress) {
+    set_solver_options(m_adaptive_tolerance.options(progress, m_full_solver_options));
+}
+PTDensitySolverOptions CoeffFitClass::solver_options() {
+    return static_cast<MixtureEvaluator*>(m_eval.get())->m_density_solver_options;
+}
+void CoeffFitClass::set_solver_options(const PTDensitySolverOptions &opts) {
+    PTDensitySolverOptions &current = static_cast<MixtureEvaluator*>(m_eval.get())->m_density_solver_options;
+    if (opts.rtol == current.rtol && opts.Nmax == current.Nmax && opts.max_step == current.max_step) { return; }
+    current = opts;
+    // The worker processes are sent the options with the coefficients of each pass, and the replicas are given them before each use
+    m_model_key_valid = false;
+}
+void CoeffFitClass::set_quarantine_policy(const QuarantinePolicy &policy) {
+    static_cast<MixtureEvaluator*>(m_eval.get())->m_quarantine_policy = policy;
+    m_shards.reset();
+}
+std::vector<std::size_t> CoeffFitClass::quarantined_points() {
+    return static_cast<MixtureEvaluator*>(m_eval.get())->get_quarantined();
+}
+void CoeffFitClass::release_quarantine() {
+    static_cast<MixtureEvaluator*>(m_eval.get())->release_quarantine();
+    m_shards.reset();
+}
+void CoeffFitClass::set_processes(std::size_t Nprocesses) {
+    m_shards.reset();
+    m_Nprocesses = Nprocesses;
+}
+void CoeffFitClass::evaluate_processes(const std::vector<double> &c0) {
+    if (m_Nprocesses < 1) { throw CoolProp::ValueError("The number of processes must be set with set_processes first"); }
+    auto startTime = std::chrono::high_resolution_clock::now();
     m_eval->set_coefficients(c0);
-    m_eval->evaluate_parallel(Nthreads);
+    MixtureEvaluator* mixeval = static_cast<MixtureEvaluator*>(m_eval.get());
+    const std::size_t Nc = c0.size(), Nprocs = m_Nprocesses;
+    // Results of each shard: its busy time, then for each output [y_calc, flags (1: failed, 2: quarantined), 
+    // telemetry of the pass, Jacobian row]; the error messages of the failed outputs come back, in order and 
+    // each ended by a NUL, as the message of the shard
+    const std::size_t Jstart = 2 + POINT_TELEMETRY_DOUBLES, stride = Jstart + Nc;
+    // The coefficients are broadcast followed by the options of the density solver, which change during a fit
+    const std::size_t Nbroadcast = Nc + 3;
+    if (!m_shards || m_shards->Ncoeffs() != Nbroadcast || m_shards->size() != Nprocs) {
+        m_shards.reset();
+        std::vector<std::size_t> sizes;
+        for (std::size_t k = 0; k < Nprocs; ++k) {
+            sizes.push_back(1 + (mixeval->block_start(k + 1, Nprocs) - mixeval->block_start(k, Nprocs))*stride);
+        }
+        // Run in the worker process, on its own copy of the evaluator
+        ProcessShards::Task task = [mixeval, Nprocs, Nc, Jstart, stride](std::size_t k, const std::vector<double> &broadcast, double *out, std::string &errors) {
+            auto shardStartTime = std::chrono::high_resolution_clock::now();
+            std::vector<double> c(broadcast.begin(), broadcast.begin() + Nc);
+            PTDensitySolverOptions &opts = mixeval->m_density_solver_options;
+            opts.rtol = broadcast[Nc];
+            opts.max_step = broadcast[Nc + 1];
+            opts.Nmax = static_cast<std::size_t>(broadcast[Nc + 2]);
+            std::size_t start = mixeval->block_start(k, Nprocs), end = mixeval->block_start(k + 1, Nprocs);
+            const std::vector<std::shared_ptr<AbstractOutput> > &outputs = mixeval->get_outputs();
+            // The counters of this pass only are sent back, to be added to those of the coordinator
+            for (std::size_t i = start; i < end; ++i) { static_cast<PhiFitOutput*>(outputs[i].get())->reset_telemetry(); }
+            mixeval->set_coefficients(c);
+            mixeval->evaluate_range(start, end, 0);
+            for (std::size_t i = start; i < end; ++i) {
+                PhiFitOutput *o = static_cast<PhiFitOutput*>(outputs[i].get());
+                double *row = out + 1 + (i - start)*stride;
+                const std::vector<double> &J = o->get_Jacobian_row();
+                const std::string error = o->error_message();
+                row[0] = o->y_calc();
+                row[1] = (error.empty() ? 0 : 1) + (o->quarantine().quarantined ? 2 : 0);
+                if (!error.empty()) { errors += error; errors.push_back('\0'); }
+                pack_point_telemetry(o->telemetry(), row + 2);
+                for (std::size_t j = 0; j < stride - Jstart; ++j) { row[Jstart + j] = (j < J.size()) ? J[j] : 0; }
+            }
+            out[0] = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - shardStartTime).count();
+        };
+        m_shards.reset(new ProcessShards(sizes, Nbroadcast, task));
+    }
+    std::vector<double> broadcast = c0;
+    broadcast.push_back(mixeval->m_density_solver_options.rtol);
+    broadcast.push_back(mixeval->m_density_solver_options.max_step);
+    broadcast.push_back(static_cast<double>(mixeval->m_density_solver_options.Nmax));
+    auto evalTime = std::chrono::high_resolution_clock::now();
+    m_phase_times.install_sec += std::chrono::duration<double>(evalTime - startTime).count();
+
+    m_shards->run(broadcast);
+
+    // Gather the results into the outputs of this process
+    const std::vector<std::shared_ptr<AbstractOutput> > &outputs = mixeval->get_outputs();
+    std::vector<double> busy(Nprocs);
+    for (std::size_t k = 0; k < Nprocs; ++k) {
+        const double *out = m_shards->result(k);
+        busy[k] = out[0];
+        const std::string &errors = m_shards->message(k);
+        std::size_t next_error = 0;
+        const std::size_t start = mixeval->block_start(k, Nprocs), end = mixeval->block_start(k + 1, Nprocs);
+        for (std::size_t i = start; i < end; ++i) {
+            const double *row = out + 1 + (i - start)*stride;
+            int flags = static_cast<int>(row[1]);
+            std::string error;
+            if (flags & 1) {
+                std::size_t stop = std::min(errors.find('\0', next_error), errors.size());
+                error = (next_error < errors.size()) ? errors.substr(next_error, stop - next_error) : fmt::format("Evaluation failed in worker process %d", k);
+                next_error = stop + 1;
+            }
+            PhiFitOutput *o = static_cast<PhiFitOutput*>(outputs[i].get());
+            o->set_result(row[0], row + Jstart, Nc, error, (flags & 2) != 0);
+            PointTelemetry t = unpack_point_telemetry(row + 2);
+            t.last_error = error;
+            o->add_telemetry(t);
+        }
+    }
+    m_phase_times.add_pass(std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - evalTime).count(), busy);
+}
+void CoeffFitClass::set_thread_pinning(bool pin) {
+    if (pin != m_pin_threads) { m_pool.reset(); }
+    m_pin_threads = pin;
+}
+void CoeffFitClass::set_batch_PT_densities(bool batch) {
+    MixtureEvaluator* mixeval = static_cast<MixtureEvaluator*>(m_eval.get());
+    mixeval->m_batch_PT_densities = batch;
+    if (!batch) {
+        // Densities solved for outputs that were then not evaluated (quarantined, say) must not be used later
+        mixeval->clear_solved_densities();
+    }
+    m_shards.reset();
+    m_replicas.clear();
+}
+std::string CoeffFitClass::scaling_report(const std::vector<double> &c0, const std::vector<short> &thread_counts) {
+    if (thread_counts.empty()) { throw CoolProp::ValueError("At least one thread count is required"); }
+    rapidjson::Document doc;
+    doc.SetObject();
+    doc.AddMember("outputs", static_cast<double>(m_eval->get_outputs_size()), doc.GetAllocator());
+
+    // Timings are relative to the first thread count
+    double T0 = 0, N0 = thread_counts[0];
+    // Sums for the least-squares fit of Amdahl's law T(N)/T0 = f*(1-N0/N) + N0/N for the serial fraction f
+    double sum_ab = 0, sum_bb = 0;
+    rapidjson::Value runs(rapidjson::kArrayType);
+    for (std::size_t k = 0; k < thread_counts.size(); ++k) {
+        short Nthreads = thread_counts[k];
+        run(Nthreads > 1, Nthreads, c0);
+        const PhiFitPhaseTimes &t = m_phase_times;
+        double T = m_elap_sec;
+        if (k == 0) { T0 = T; }
+        double speedup = T0/T, p = Nthreads/N0;
+
+        rapidjson::Value val; val.SetObject();
+        val.AddMember("threads", static_cast<double>(Nthreads), doc.GetAllocator());
+        val.AddMember("elapsed (s)", T, doc.GetAllocator());
+        val.AddMember("passes", static_cast<double>(t.Npasses), doc.GetAllocator());
+        val.AddMember("coefficient installation (s)", t.install_sec, doc.GetAllocator());
+        val.AddMember("residual evaluation (s)", t.evaluate_sec, doc.GetAllocator());
+        val.AddMember("Jacobian assembly (s)", t.assemble_sec, doc.GetAllocator());
+        val.AddMember("linear solve (s)", t.solve_sec, doc.GetAllocator());
+        val.AddMember("other (s)", T - t.install_sec - t.evaluate_sec - t.assemble_sec - t.solve_sec, doc.GetAllocator());
+        cpjson::set_double_array("busy per thread (s)", t.busy_sec, val, doc);
+        cpjson::set_double_array("idle per thread (s)", t.idle_sec, val, doc);
+        val.AddMember("speedup", speedup, doc.GetAllocator());
+        val.AddMember("parallel efficiency", speedup/p, doc.GetAllocator());
+        if (p > 1) {
+            // Karp-Flatt metric: the experimentally determined serial fraction
+            val.AddMember("serial fraction", (1/speedup - 1/p)/(1 - 1/p), doc.GetAllocator());
+            double a = T/T0 - 1/p, b = 1 - 1/p;
+            sum_ab += a*b; sum_bb += b*b;
+        }
+        runs.PushBack(val, doc.GetAllocator());
+    }
+    doc.AddMember("runs", runs, doc.GetAllocator());
+    if (sum_bb > 0) {
+        doc.AddMember("Amdahl serial fraction", sum_ab/sum_bb, doc.GetAllocator());
+    }
+    return cpjson::json2string(doc);
 }
 double CoeffFitClass::sum_of_squares() { return m_eval->get_error_vector().squaredNorm(); }
 std::vector<double> CoeffFitClass::errorvec(){
@@ -806,7 +2595,35 @@ std::vector<double> CoeffFitClass::errorvec(){
 }
 std::string CoeffFitClass::dump_outputs_to_JSON() {
     MixtureEvaluator* mixeval = static_cast<MixtureEvaluator*>(m_eval.get());
-    return mixeval->dump_outputs_to_JSON();
+    rapidjson::Document doc;
+    mixeval->outputs_to_JSON(doc);
+    if (!m_trace.empty()) {
+        rapidjson::Value trace(rapidjson::kArrayType);
+        ::trace_to_JSON(m_trace, trace, doc);
+        doc.AddMember("trace", trace, doc.GetAllocator());
+    }
+    return cpjson::json2string(doc);
+}
+std::string CoeffFitClass::trace_to_JSON() {
+    rapidjson::Document doc;
+    doc.SetArray();
+    ::trace_to_JSON(m_trace, doc, doc);
+    return cpjson::json2string(doc);
+}
+std::vector<PointTelemetry> CoeffFitClass::point_telemetry(){
+    MixtureEvaluator* mixeval = static_cast<MixtureEvaluator*>(m_eval.get());
+    return mixeval->get_point_telemetry();
+}
+TelemetrySummary CoeffFitClass::telemetry_summary(){
+    MixtureEvaluator* mixeval = static_cast<MixtureEvaluator*>(m_eval.get());
+    return mixeval->get_telemetry_summary();
+}
+std::string CoeffFitClass::telemetry_to_JSON(){
+    return ::telemetry_to_JSON(telemetry_summary());
+}
+void CoeffFitClass::reset_telemetry(){
+    MixtureEvaluator* mixeval = static_cast<MixtureEvaluator*>(m_eval.get());
+    mixeval->reset_telemetry();
 }
 std::string CoeffFitClass::departure_function_to_JSON(){
     MixtureEvaluator* mixeval = static_cast<MixtureEvaluator*>(m_eval.get());
@@ -828,6 +2645,8 @@ double simplefit(const std::string &JSON_data_string, const std::string &JSON_fi
 
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
+#include <pybind11/functional.h>
+#include "phifit/evolution.h"
 namespace py = pybind11;
 
 
@@ -872,13 +2691,236 @@ PYBIND11_PLUGIN(MixtureCoefficientFitter) {
         .def_readwrite("ldelta", &Coefficients::ldelta)
         .def_readwrite("cdelta", &Coefficients::cdelta);
 
+    py::class_<GeneSpec>(m, "GeneSpec")
+        .def(py::init<double, double, double, bool>(), py::arg("lower") = 0, py::arg("upper") = 1, py::arg("sigma") = 0.5, py::arg("integer") = false)
+        .def_readwrite("lower", &GeneSpec::lower)
+        .def_readwrite("upper", &GeneSpec::upper)
+        .def_readwrite("sigma", &GeneSpec::sigma)
+        .def_readwrite("integer", &GeneSpec::integer);
+
+    py::class_<IndividualLayout>(m, "IndividualLayout")
+        .def(py::init<>())
+        .def_readwrite("Nterms", &IndividualLayout::Nterms)
+        .def_readwrite("u_dims", &IndividualLayout::u_dims)
+        .def("size", &IndividualLayout::size);
+
+    py::class_<EvolutionIndividual>(m, "EvolutionIndividual")
+        .def_readonly("x", &EvolutionIndividual::x)
+        .def_readonly("fitness", &EvolutionIndividual::fitness);
+
+    py::class_<EvolutionGeneration>(m, "EvolutionGeneration")
+        .def_readonly("gen", &EvolutionGeneration::gen)
+        .def_readonly("nevals", &EvolutionGeneration::Nevals)
+        .def_readonly("min_fitness", &EvolutionGeneration::min_fitness)
+        .def_readonly("stddev_fitness", &EvolutionGeneration::stddev_fitness)
+        .def_readonly("elapsed_sec", &EvolutionGeneration::elapsed_sec);
+
+    py::class_<EvolutionResult>(m, "EvolutionResult")
+        .def_readonly("population", &EvolutionResult::population)
+        .def_readonly("hall_of_fame", &EvolutionResult::hall_of_fame)
+        .def_readonly("log", &EvolutionResult::log);
+
+    py::class_<EvolutionOptions>(m, "EvolutionOptions")
+        .def(py::init<>())
+        .def_readwrite("layout", &EvolutionOptions::layout)
+        .def_readwrite("genes", &EvolutionOptions::genes)
+        .def_readwrite("Nindividuals", &EvolutionOptions::Nindividuals)
+        .def_readwrite("Ngenerations", &EvolutionOptions::Ngenerations)
+        .def_readwrite("Nhof", &EvolutionOptions::Nhof)
+        .def_readwrite("tournsize", &EvolutionOptions::tournsize)
+        .def_readwrite("cxpb", &EvolutionOptions::cxpb)
+        .def_readwrite("mutpb", &EvolutionOptions::mutpb)
+        .def_readwrite("alpha", &EvolutionOptions::alpha)
+        .def_readwrite("mu", &EvolutionOptions::mu)
+        .def_readwrite("Nworkers", &EvolutionOptions::Nworkers)
+        .def_readwrite("Nthreads", &EvolutionOptions::Nthreads)
+        .def_readwrite("seed", &EvolutionOptions::seed)
+        .def_readwrite("population", &EvolutionOptions::population)
+        .def_readwrite("callback", &EvolutionOptions::callback);
+
+    py::class_<FitnessMemo::Stats>(m, "FitnessMemoStats")
+        .def_readonly("hits", &FitnessMemo::Stats::hits)
+        .def_readonly("misses", &FitnessMemo::Stats::misses)
+        .def_readonly("size", &FitnessMemo::Stats::size)
+        .def_readonly("capacity", &FitnessMemo::Stats::capacity)
+        .def("hit_rate", &FitnessMemo::Stats::hit_rate);
+
+    py::class_<PhiFitTraceEntry>(m, "PhiFitTraceEntry")
+        .def_readonly("iter", &PhiFitTraceEntry::iter)
+        .def_readonly("start", &PhiFitTraceEntry::start)
+        .def_readonly("SSE", &PhiFitTraceEntry::SSE)
+        .def_readonly("mu", &PhiFitTraceEntry::mu)
+        .def_readonly("step_norm", &PhiFitTraceEntry::step_norm)
+        .def_readonly("gain", &PhiFitTraceEntry::gain)
+        .def_readonly("accepted", &PhiFitTraceEntry::accepted)
+        .def_readonly("residual_sec", &PhiFitTraceEntry::residual_sec)
+        .def_readonly("jacobian_sec", &PhiFitTraceEntry::jacobian_sec)
+        .def_readonly("solve_sec", &PhiFitTraceEntry::solve_sec);
+
+    py::enum_<FitStatus>(m, "FitStatus")
+        .value("FIT_QUEUED", FIT_QUEUED)
+        .value("FIT_RUNNING", FIT_RUNNING)
+        .value("FIT_CONVERGED", FIT_CONVERGED)
+        .value("FIT_STOPPED", FIT_STOPPED)
+        .value("FIT_CANCELLED", FIT_CANCELLED)
+        .value("FIT_FAILED", FIT_FAILED)
+        .export_values();
+
+    py::class_<FitProgress>(m, "FitProgress")
+        .def_readonly("status", &FitProgress::status)
+        .def_readonly("iter", &FitProgress::iter)
+        .def_readonly("Nthreads", &FitProgress::Nthreads)
+        .def_readonly("SSE", &FitProgress::SSE)
+        .def_readonly("mu", &FitProgress::mu)
+        .def_readonly("elapsed_sec", &FitProgress::elapsed_sec)
+        .def_readonly("error", &FitProgress::error);
+
+    py::class_<FitHandle, std::shared_ptr<FitHandle> >(m, "FitHandle")
+        .def("progress", &FitHandle::progress)
+        .def("cancel", &FitHandle::cancel)
+        .def("done", &FitHandle::done)
+        // Let other Python threads run while waiting
+        .def("wait", [](FitHandle &h, double timeout_sec) { py::gil_scoped_release release; return h.wait(timeout_sec); }, py::arg("timeout_sec") = -1.0)
+        .def("best_coefficients", &FitHandle::best_coefficients);
+
+    py::class_<DeviationStats>(m, "DeviationStats")
+        .def_readonly("key", &DeviationStats::key)
+        .def_readonly("N", &DeviationStats::N)
+        .def_readonly("Nfailed", &DeviationStats::Nfailed)
+        .def_readonly("AAD", &DeviationStats::AAD)
+        .def_readonly("bias", &DeviationStats::bias)
+        .def_readonly("RMS", &DeviationStats::RMS)
+        .def_readonly("max_abs", &DeviationStats::max_abs);
+
+    py::class_<DeviationSummary>(m, "DeviationSummary")
+        .def_readonly("overall", &DeviationSummary::overall)
+        .def_readonly("by_type", &DeviationSummary::by_type)
+        .def_readonly("by_source", &DeviationSummary::by_source);
+
+    py::class_<VLEIsotherm>(m, "VLEIsotherm")
+        .def_readonly("T", &VLEIsotherm::T)
+        .def_readonly("x0", &VLEIsotherm::x0)
+        .def_readonly("p", &VLEIsotherm::p)
+        .def_readonly("y0", &VLEIsotherm::y0);
+
+    py::class_<ValidationOptions>(m, "ValidationOptions")
+        .def(py::init<>())
+        .def_readwrite("Nthreads", &ValidationOptions::Nthreads)
+        .def_readwrite("isotherms", &ValidationOptions::isotherms)
+        .def_readwrite("Nx", &ValidationOptions::Nx)
+        .def_readwrite("x0min", &ValidationOptions::x0min)
+        .def_readwrite("x0max", &ValidationOptions::x0max);
+
+    py::class_<ValidationReport>(m, "ValidationReport")
+        .def_readonly("deviations", &ValidationReport::deviations)
+        .def_readonly("isotherms", &ValidationReport::isotherms)
+        .def_readonly("elapsed_sec", &ValidationReport::elapsed_sec);
+
+    py::class_<CrossValidationOptions>(m, "CrossValidationOptions")
+        .def(py::init<>())
+        .def_readwrite("k", &CrossValidationOptions::k)
+        .def_readwrite("seed", &CrossValidationOptions::seed)
+        .def_readwrite("stratify", &CrossValidationOptions::stratify)
+        .def_readwrite("Nthreads", &CrossValidationOptions::Nthreads)
+        .def_readwrite("c0", &CrossValidationOptions::c0);
+
+    py::class_<FoldResult>(m, "FoldResult")
+        .def_readonly("fold", &FoldResult::fold)
+        .def_readonly("Ntrain", &FoldResult::Ntrain)
+        .def_readonly("Nheld_out", &FoldResult::Nheld_out)
+        .def_readonly("iter", &FoldResult::iter)
+        .def_readonly("SSE_train", &FoldResult::SSE_train)
+        .def_readonly("SSE_held_out", &FoldResult::SSE_held_out)
+        .def_readonly("converged", &FoldResult::converged)
+        .def_readonly("c", &FoldResult::c);
+
+    py::class_<CrossValidationResult>(m, "CrossValidationResult")
+        .def_readonly("folds", &CrossValidationResult::folds)
+        .def_readonly("assignment", &CrossValidationResult::assignment)
+        .def_readonly("elapsed_sec", &CrossValidationResult::elapsed_sec)
+        .def("held_out_MSE", &CrossValidationResult::held_out_MSE)
+        .def("train_MSE", &CrossValidationResult::train_MSE);
+
+    py::class_<FitStage>(m, "FitStage")
+        .def(py::init<double, double, double, std::size_t>(), py::arg("fraction") = 1, py::arg("epsilon1") = 1e-12, py::arg("epsilon2") = 1e-10, py::arg("Nmax") = 100)
+        .def_readwrite("fraction", &FitStage::fraction)
+        .def_readwrite("epsilon1", &FitStage::epsilon1)
+        .def_readwrite("epsilon2", &FitStage::epsilon2)
+        .def_readwrite("Nmax", &FitStage::Nmax);
+
+    py::class_<FitScheduleOptions>(m, "FitScheduleOptions")
+        .def(py::init<>())
+        .def_readwrite("stages", &FitScheduleOptions::stages)
+        .def_readwrite("seed", &FitScheduleOptions::seed)
+        .def_readwrite("stratify", &FitScheduleOptions::stratify);
+
+    py::class_<StageResult>(m, "StageResult")
+        .def_readonly("stage", &StageResult::stage)
+        .def_readonly("Npoints", &StageResult::Npoints)
+        .def_readonly("Nresiduals", &StageResult::Nresiduals)
+        .def_readonly("iter", &StageResult::iter)
+        .def_readonly("SSE", &StageResult::SSE)
+        .def_readonly("elapsed_sec", &StageResult::elapsed_sec)
+        .def_readonly("converged", &StageResult::converged)
+        .def_readonly("c", &StageResult::c);
+
+    py::class_<FitScheduleResult>(m, "FitScheduleResult")
+        .def_readonly("stages", &FitScheduleResult::stages)
+        .def_readonly("first_stage", &FitScheduleResult::first_stage)
+        .def_readonly("elapsed_sec", &FitScheduleResult::elapsed_sec);
+
+    py::class_<PTDensitySolverOptions>(m, "PTDensitySolverOptions")
+        .def(py::init<>())
+        .def_readwrite("rtol", &PTDensitySolverOptions::rtol)
+        .def_readwrite("max_step", &PTDensitySolverOptions::max_step)
+        .def_readwrite("Nmax", &PTDensitySolverOptions::Nmax);
+
+    py::class_<AdaptiveToleranceOptions>(m, "AdaptiveToleranceOptions")
+        .def(py::init<>())
+        .def_readwrite("enabled", &AdaptiveToleranceOptions::enabled)
+        .def_readwrite("rtol_loose", &AdaptiveToleranceOptions::rtol_loose)
+        .def_readwrite("safety", &AdaptiveToleranceOptions::safety)
+        .def_readwrite("Nmax_loose", &AdaptiveToleranceOptions::Nmax_loose)
+        .def_readwrite("Nmax_polish", &AdaptiveToleranceOptions::Nmax_polish);
+
+    py::class_<QuarantinePolicy>(m, "QuarantinePolicy")
+        .def(py::init<>())
+        .def_readwrite("max_failures", &QuarantinePolicy::max_failures)
+        .def_readwrite("penalty", &QuarantinePolicy::penalty)
+        .def_readwrite("retry_shift", &QuarantinePolicy::retry_shift)
+        .def_readwrite("retry_every", &QuarantinePolicy::retry_every);
+
+    py::class_<PrepareOptions>(m, "PrepareOptions")
+        .def(py::init<>())
+        .def_readwrite("schema_path", &PrepareOptions::schema_path)
+        .def_readwrite("cache_dir", &PrepareOptions::cache_dir)
+        .def_readwrite("departure_JSON", &PrepareOptions::departure_JSON)
+        .def_readwrite("c_ref", &PrepareOptions::c_ref)
+        .def_readwrite("Nthreads", &PrepareOptions::Nthreads);
+
     py::class_<CoeffFitClass>(m, "CoeffFitClass")
         .def(py::init<const std::string &>())
+        .def(py::init<const std::string &, bool>())
+        .def(py::init<const std::string &, const PrepareOptions &, bool>(), py::arg("JSON_data_string"), py::arg("cache"), py::arg("slim_PRhoT") = true)
         .def("setup", (void (CoeffFitClass::*)(const std::string &)) &CoeffFitClass::setup)
         .def("setup", (void (CoeffFitClass::*)(const Coefficients &)) &CoeffFitClass::setup)
         .def("run", &CoeffFitClass::run)
+        // The handle keeps the fitter alive while the fit runs
+        .def("run_async", [](CoeffFitClass &cfc, bool threading, short Nthreads, const std::vector<double> &c0) { return cfc.run_async(threading, Nthreads, c0); }, py::keep_alive<0, 1>())
         .def("evaluate_parallel", &CoeffFitClass::evaluate_parallel)
         .def("evaluate_serial", &CoeffFitClass::evaluate_serial)
+        .def("set_thread_pinning", &CoeffFitClass::set_thread_pinning)
+        .def("set_processes", &CoeffFitClass::set_processes)
+        .def("set_quarantine_policy", &CoeffFitClass::set_quarantine_policy)
+        .def("set_adaptive_tolerance", &CoeffFitClass::set_adaptive_tolerance)
+        .def("set_damping_candidates", &CoeffFitClass::set_damping_candidates)
+        .def("adapt_solver_tolerance", &CoeffFitClass::adapt_solver_tolerance)
+        .def("solver_options", &CoeffFitClass::solver_options)
+        .def("quarantined_points", &CoeffFitClass::quarantined_points)
+        .def("release_quarantine", &CoeffFitClass::release_quarantine)
+        .def_readwrite("streaming_normal_equations", &CoeffFitClass::m_streaming_normal_equations)
+        .def("evaluate_processes", &CoeffFitClass::evaluate_processes)
+        .def("set_batch_PT_densities", &CoeffFitClass::set_batch_PT_densities)
         .def("cfinal", &CoeffFitClass::cfinal)
         .def("errorvec", &CoeffFitClass::errorvec)
         .def("dump_outputs_to_JSON", &CoeffFitClass::dump_outputs_to_JSON)
@@ -887,11 +2929,40 @@ PYBIND11_PLUGIN(MixtureCoefficientFitter) {
         .def("departure_function_to_JSON", &CoeffFitClass::departure_function_to_JSON)
         .def("set_departure_function_by_name", &CoeffFitClass::set_departure_function_by_name)
         .def("set_binary_interaction_double", &CoeffFitClass::set_binary_interaction_double)
+        .def("set_checkpointing", &CoeffFitClass::set_checkpointing)
+        .def("save_checkpoint", &CoeffFitClass::save_checkpoint)
+        .def("load_checkpoint", &CoeffFitClass::load_checkpoint)
+        .def("resume", &CoeffFitClass::resume)
+        .def("scaling_report", &CoeffFitClass::scaling_report)
+        .def("telemetry_to_JSON", &CoeffFitClass::telemetry_to_JSON)
+        .def("reset_telemetry", &CoeffFitClass::reset_telemetry)
+        .def("set_memo", &CoeffFitClass::set_memo)
+        .def("evaluate_sum_of_squares", &CoeffFitClass::evaluate_sum_of_squares)
+        .def("memoized_residuals", &CoeffFitClass::memoized_residuals)
+        .def("memo_stats", &CoeffFitClass::memo_stats)
+        .def("clear_memo", &CoeffFitClass::clear_memo)
+        .def("trace", &CoeffFitClass::trace)
+        .def("trace_to_JSON", &CoeffFitClass::trace_to_JSON)
+        .def("validate", &CoeffFitClass::validate, py::arg("c"), py::arg("options") = ValidationOptions())
+        .def("validation_to_JSON", &CoeffFitClass::validation_to_JSON, py::arg("c"), py::arg("options") = ValidationOptions())
+        .def("cross_validate", &CoeffFitClass::cross_validate)
+        .def("run_schedule", &CoeffFitClass::run_schedule, py::arg("threading"), py::arg("Nthreads"), py::arg("c0"), py::arg("options") = FitScheduleOptions())
+        .def("add_points", &CoeffFitClass::add_points)
+        .def("remove_points", &CoeffFitClass::remove_points)
+        .def("set_point_enabled", &CoeffFitClass::set_point_enabled)
+        .def("point_ids", &CoeffFitClass::point_ids)
+        .def("disabled_point_ids", &CoeffFitClass::disabled_point_ids)
+        .def("points_of_source", &CoeffFitClass::points_of_source)
         ;
     
     init_CoolProp(m);
     m.def("set_departure_function", &set_departure_function);
     m.def("update_departure_function", &update_departure_function);
+    m.def("evolve", &evolve);
+    m.def("cross_validation_to_JSON", &cross_validation_to_JSON);
+    m.def("assign_stages", &assign_stages, py::arg("sources"), py::arg("fractions"), py::arg("seed"), py::arg("stratify") = true);
+    m.def("fit_schedule_to_JSON", &fit_schedule_to_JSON);
+    m.def("prepare_dataset", &prepare_dataset);
     m.def("factory", [](const std::string &backend, const std::string &fluids) { return CoolProp::AbstractState::factory(backend, fluids); });
 
     return m.ptr();
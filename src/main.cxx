@@ -1,16 +1,64 @@
-
 #include "phifit/data_generation.h"
 #include "phifit/fitter.h"
+#include "phifit/prepare.h"
 
 #include "AbstractState.h"
 
-int main() {
+#include <thread>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <cstdlib>
+
+int main(int argc, char **argv) {
+    std::vector<double> c0 = { 0.911640,0.9111660,1.0541730, 1.3223907 }, cfinal;
+    if (argc > 1 && std::string(argv[1]) == "--scaling-report") {
+        // Break each fit into its phases for thread counts 1, 2, 4, ... up to the number of hardware threads
+        if (argc < 3) {
+            std::cerr << "Usage: Main --scaling-report data.json [fit0.json]" << std::endl;
+            return EXIT_FAILURE;
+        }
+        CoeffFitClass CFC(get_file_contents(argv[2]));
+        if (argc > 3) { CFC.setup(get_file_contents(argv[3])); }
+        std::vector<short> thread_counts;
+        for (short Nthreads = 1; Nthreads <= static_cast<short>(std::max(std::thread::hardware_concurrency(), 1u)); Nthreads *= 2) {
+            thread_counts.push_back(Nthreads);
+        }
+        std::cout << CFC.scaling_report(c0, thread_counts) << std::endl;
+        return EXIT_SUCCESS;
+    }
+    if (argc > 1 && std::string(argv[1]) == "--gen-data") {
+        // Generate a synthetic dataset as described by the options file (see gen_data_options_from_JSON)
+        if (argc < 4) {
+            std::cerr << "Usage: Main --gen-data options.json out.json" << std::endl;
+            return EXIT_FAILURE;
+        }
+        std::ofstream ofs(argv[3]);
+        std::size_t N = gen_data(gen_data_options_from_JSON(get_file_contents(argv[2])), ofs);
+        std::cout << N << " points written to " << argv[3] << std::endl;
+        return EXIT_SUCCESS;
+    }
+    if (argc > 1 && std::string(argv[1]) == "--prepare") {
+        // Validate the dataset and solve for its density guesses with the reference model, and cache the result
+        if (argc < 4) {
+            std::cerr << "Usage: Main --prepare data.json cache_dir [fit0.json] [schema.json]" << std::endl;
+            return EXIT_FAILURE;
+        }
+        PrepareOptions o;
+        o.cache_dir = argv[3];
+        if (argc > 4) { o.departure_JSON = get_file_contents(argv[4]); }
+        if (argc > 5) { o.schema_path = argv[5]; }
+        o.Nthreads = static_cast<short>(std::max(std::thread::hardware_concurrency(), 1u));
+        std::string data = get_file_contents(argv[2]);
+        prepare_dataset(data, o);
+        std::cout << "Prepared dataset cached as " << dataset_cache_key(data, o) << ".json in " << o.cache_dir << std::endl;
+        return EXIT_SUCCESS;
+    }
     std::string JSON_data_string = get_file_contents("../../ammonia_water.json");
     std::string JSON_fit0_string = get_file_contents("../../fit0.json");
-    std::vector<double> c0 = { 0.911640,0.9111660,1.0541730, 1.3223907 }, cfinal;
     fmt::printf("%g\n", simplefit(JSON_data_string, JSON_fit0_string, false, 4, c0, cfinal));
     for (int i = 0; i < cfinal.size(); i += 1) { std::cout << cfinal[i] << "," << std::endl; }
     for (auto &Nthreads : { 1,2,3,4,5,6,7,8 }) {
         fmt::printf("%d %g\n", Nthreads, simplefit(JSON_data_string, JSON_fit0_string, true, Nthreads, c0, cfinal));
     }
-}
\ No newline at end of file
+}
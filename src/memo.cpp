@@ -0,0 +1,73 @@
+#include "phifit/memo.h"
+
+std::uint64_t fnv1a_hash(const void *data, std::size_t N, std::uint64_t h) {
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    for (std::size_t i = 0; i < N; ++i) {
+        h ^= bytes[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+std::uint64_t FitnessMemo::key(const std::vector<double> &c, std::uint64_t model_key) {
+    std::uint64_t h = fnv1a_hash(&model_key, sizeof(model_key));
+    return c.empty() ? h : fnv1a_hash(&(c[0]), c.size()*sizeof(double), h);
+}
+
+bool FitnessMemo::find(const std::vector<double> &c, std::uint64_t model_key, Entry &e, bool count) {
+    std::uint64_t k = key(c, model_key);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto range = m_index.equal_range(k);
+    for (auto it = range.first; it != range.second; ++it) {
+        // The hash only narrows the search; the candidate itself must match
+        const Entry &candidate = *(it->second);
+        if (candidate.model_key == model_key && candidate.c == c) {
+            m_entries.splice(m_entries.begin(), m_entries, it->second);
+            e = candidate;
+            if (count) { m_hits++; }
+            return true;
+        }
+    }
+    if (count) { m_misses++; }
+    return false;
+}
+
+void FitnessMemo::insert(const std::vector<double> &c, std::uint64_t model_key, double SSE, const std::vector<double> &residuals) {
+    if (m_capacity == 0) { return; }
+    std::uint64_t k = key(c, model_key);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto range = m_index.equal_range(k);
+    for (auto it = range.first; it != range.second; ++it) {
+        // Another thread got here first
+        if (it->second->model_key == model_key && it->second->c == c) { return; }
+    }
+    Entry e;
+    e.c = c; e.model_key = model_key; e.SSE = SSE;
+    if (m_store_residuals) { e.residuals = residuals; }
+    m_entries.push_front(e);
+    m_index.insert(std::make_pair(k, m_entries.begin()));
+    while (m_entries.size() > m_capacity) {
+        // Drop the least recently used entry
+        EntryList::iterator last = --m_entries.end();
+        std::uint64_t klast = FitnessMemo::key(last->c, last->model_key);
+        auto r = m_index.equal_range(klast);
+        for (auto it = r.first; it != r.second; ++it) {
+            if (it->second == last) { m_index.erase(it); break; }
+        }
+        m_entries.erase(last);
+    }
+}
+
+FitnessMemo::Stats FitnessMemo::stats() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Stats s;
+    s.hits = m_hits; s.misses = m_misses; s.size = m_entries.size(); s.capacity = m_capacity;
+    return s;
+}
+
+void FitnessMemo::clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries.clear();
+    m_index.clear();
+    m_hits = 0; m_misses = 0;
+}
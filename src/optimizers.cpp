@@ -0,0 +1,170 @@
+#include "phifit/optimizers.h"
+
+#include <cmath>
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+/// One iteration that tries the damping parameter times each of opts.mu_factors
+void candidate_step(PhiFitResidualProvider &provider, const PhiFitLMOptions &opts, PhiFitLMState &state, PhiFitNormalEquations &ne)
+{
+    const std::size_t N = state.c.size(), Ncand = opts.mu_factors.size();
+    std::vector<double> mus;
+    for (double f : opts.mu_factors) { mus.push_back(state.mu*f); }
+    std::vector<Eigen::VectorXd> hs = provider.solve_candidates(ne, mus);
+
+    Eigen::Map<const Eigen::VectorXd> c(&(state.c[0]), N);
+    state.last = PhiFitLMIteration();
+    state.last.iter = state.iter;
+    state.last.mu = state.mu;
+    state.last.SSE = state.SSE;
+    state.last.gain = std::numeric_limits<double>::quiet_NaN();
+    // Converged if even the longest step is negligible
+    double longest = 0;
+    for (auto &h : hs) { h *= opts.omega; longest = std::max(longest, h.norm()); }
+    state.last.step_norm = longest;
+    if (longest <= opts.epsilon2*(c.norm() + opts.epsilon2)) {
+        state.converged = true;
+        return;
+    }
+
+    std::vector<std::vector<double> > cs(Ncand, std::vector<double>(N));
+    for (std::size_t j = 0; j < Ncand; ++j) {
+        Eigen::Map<Eigen::VectorXd>(&(cs[j][0]), N) = c + hs[j];
+    }
+    std::vector<PhiFitNormalEquations> nes;
+    provider.evaluate_candidates(cs, nes);
+
+    // The best of the candidates that reduce the sum of squares
+    std::size_t best = Ncand;
+    double best_gain = 0;
+    for (std::size_t j = 0; j < Ncand; ++j) {
+        double predicted = -hs[j].dot(ne.Jtr) - 0.5*hs[j].dot(ne.JtJ*hs[j]);
+        double gain = 0.5*(state.SSE - nes[j].SSE)/predicted;
+        if (gain > 0 && std::isfinite(nes[j].SSE) && (best == Ncand || nes[j].SSE < nes[best].SSE)) {
+            best = j; best_gain = gain;
+        }
+    }
+    if (best < Ncand) {
+        state.last.mu = mus[best];
+        state.last.step_norm = hs[best].norm();
+        state.last.SSE = nes[best].SSE;
+        state.last.gain = best_gain;
+        state.last.accepted = true;
+        state.c = cs[best];
+        state.SSE = nes[best].SSE;
+        std::swap(ne, nes[best]);
+        state.converged = ne.Jtr.lpNorm<Eigen::Infinity>() <= opts.epsilon1;
+        state.mu = mus[best]*std::max(1.0/3.0, 1 - std::pow(2*best_gain - 1, 3));
+        state.nu = 2;
+    }
+    else {
+        // Reject them all and increase the damping beyond the largest one tried
+        state.mu = *std::max_element(mus.begin(), mus.end())*state.nu;
+        state.nu *= 2;
+    }
+}
+
+}
+
+void PhiFitLevenbergMarquardt(PhiFitResidualProvider &provider, const PhiFitLMOptions &opts, PhiFitLMState &state, const PhiFitLMCallback &callback)
+{
+    if (!state.initialized) {
+        state = PhiFitLMState();
+        state.c = opts.c0;
+    }
+    const std::size_t N = state.c.size();
+
+    // Evaluate at the starting point; when resuming, this rebuilds the normal equations
+    // at the last accepted coefficients, the damping parameters are kept
+    PhiFitNormalEquations ne, ne_new;
+    provider.evaluate(state.c, ne);
+    state.SSE = ne.SSE;
+    if (!state.initialized) {
+        state.mu = opts.tau0*ne.JtJ.diagonal().maxCoeff();
+        state.nu = 2;
+        state.initialized = true;
+    }
+    state.converged = ne.Jtr.lpNorm<Eigen::Infinity>() <= opts.epsilon1;
+    state.last = PhiFitLMIteration();
+    state.last.iter = state.iter;
+    state.last.start = true;
+    state.last.SSE = state.SSE;
+    state.last.mu = state.mu;
+    state.last.gain = std::numeric_limits<double>::quiet_NaN();
+    state.last.accepted = true;
+    if (callback) { callback(state); }
+
+    // Whether the residuals currently held by the provider are those at state.c
+    bool at_accepted = true;
+    std::vector<double> cnew(N);
+    while (!state.converged && state.iter < opts.Nmax && !(opts.cancel != nullptr && *opts.cancel)) {
+        state.iter++;
+
+        if (!opts.mu_factors.empty()) {
+            candidate_step(provider, opts, state, ne);
+            // The provider holds the residuals of whichever candidate it evaluated last
+            at_accepted = false;
+            if (callback) { callback(state); }
+            continue;
+        }
+
+        // Solve for the step
+        Eigen::VectorXd h = opts.omega*provider.solve(ne, state.mu);
+        state.last = PhiFitLMIteration();
+        state.last.iter = state.iter;
+        state.last.mu = state.mu;
+        state.last.step_norm = h.norm();
+        state.last.SSE = state.SSE;
+        state.last.gain = std::numeric_limits<double>::quiet_NaN();
+
+        Eigen::Map<const Eigen::VectorXd> c(&(state.c[0]), N);
+        if (h.norm() <= opts.epsilon2*(c.norm() + opts.epsilon2)) {
+            state.converged = true;
+        }
+        else {
+            Eigen::Map<Eigen::VectorXd>(&(cnew[0]), N) = c + h;
+            provider.evaluate(cnew, ne_new);
+
+            // Ratio of the actual reduction of 1/2*SSE to that predicted by the linear model
+            double predicted = -h.dot(ne.Jtr) - 0.5*h.dot(ne.JtJ*h);
+            double gain = 0.5*(state.SSE - ne_new.SSE)/predicted;
+            state.last.SSE = ne_new.SSE;
+            state.last.gain = gain;
+            state.last.accepted = gain > 0 && std::isfinite(ne_new.SSE);
+            if (state.last.accepted) {
+                // Accept the step
+                state.c = cnew;
+                state.SSE = ne_new.SSE;
+                std::swap(ne, ne_new);
+                state.converged = ne.Jtr.lpNorm<Eigen::Infinity>() <= opts.epsilon1;
+                state.mu *= std::max(1.0/3.0, 1 - std::pow(2*gain - 1, 3));
+                state.nu = 2;
+                at_accepted = true;
+            }
+            else {
+                // Reject the step and increase the damping
+                state.mu *= state.nu;
+                state.nu *= 2;
+                at_accepted = false;
+            }
+        }
+        if (callback) { callback(state); }
+    }
+    // Leave the provider holding the residuals at the final coefficients
+    if (!at_accepted) {
+        provider.evaluate(state.c, ne);
+    }
+}
+
+void reduce_normal_equations(std::vector<PhiFitNormalEquations> &parts)
+{
+    for (std::size_t stride = 1; stride < parts.size(); stride *= 2) {
+        for (std::size_t i = 0; i + stride < parts.size(); i += 2*stride) {
+            parts[i].JtJ += parts[i + stride].JtJ;
+            parts[i].Jtr += parts[i + stride].Jtr;
+            parts[i].SSE += parts[i + stride].SSE;
+        }
+    }
+}
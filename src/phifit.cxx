@@ -0,0 +1,40 @@
+//
+//  Batch driver: carry out all the fits in a job manifest
+//
+//  Usage: phifit manifest.json [max threads]
+//
+//  See load_manifest in phifit/batch.h for the format of the manifest; the number of threads 
+//  given on the command line takes precedence over "max threads" in the manifest
+//
+
+#include "phifit/batch.h"
+
+// Includes from CoolProp
+#include "AbstractState.h"
+
+// Includes from c++
+#include <iostream>
+#include <cstdlib>
+
+int main(int argc, char **argv) {
+    if (argc < 2 || argc > 3) {
+        std::cerr << "Usage: phifit manifest.json [max threads]" << std::endl;
+        return EXIT_FAILURE;
+    }
+    try {
+        FitManifest manifest = load_manifest(argv[1]);
+        if (argc > 2) { manifest.Nthreads = static_cast<std::size_t>(std::max(std::atoi(argv[2]), 0)); }
+        ThreadBudget budget(manifest.Nthreads);
+        std::cout << fmt::format("%d job(s), up to %d thread(s)", static_cast<int>(manifest.jobs.size()), static_cast<int>(budget.total())) << std::endl;
+        std::size_t Nfailed = run_fit_jobs(manifest.jobs, budget);
+        if (Nfailed > 0) {
+            std::cerr << fmt::format("%d job(s) failed", static_cast<int>(Nfailed)) << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    catch (std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,192 @@
+#include "phifit/prepare.h"
+#include "phifit/departure_function.h"
+#include "phifit/memo.h"
+
+// Includes from CoolProp
+#include "AbstractState.h"
+#include "rapidjson_include.h"
+#include "Backends/Helmholtz/HelmholtzEOSMixtureBackend.h"
+
+// Includes from c++
+#include <thread>
+#include <memory>
+#include <exception>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+
+namespace {
+
+/// 64-bit FNV-1a hash, enough to tell datasets apart (this is not a cryptographic hash)
+std::uint64_t fnv1a(const std::string &s) { return fnv1a_hash(s.data(), s.size()); }
+
+std::string hex(std::uint64_t h) {
+    char buf[17];
+    std::snprintf(buf, sizeof(buf), "%016llx", static_cast<unsigned long long>(h));
+    return buf;
+}
+
+std::string cache_path(const std::string &key, const PrepareOptions &o) {
+    std::string dir = o.cache_dir;
+    if (!dir.empty() && dir[dir.size() - 1] != '/' && dir[dir.size() - 1] != '\\') { dir += "/"; }
+    return dir + key + ".json";
+}
+
+bool file_exists(const std::string &path) {
+    std::ifstream ifs(path.c_str());
+    return ifs.good();
+}
+
+/// An AbstractState of the reference model
+std::shared_ptr<CoolProp::AbstractState> reference_state(const std::string &fluids, const PrepareOptions &o, rapidjson::Document &departure) {
+    std::shared_ptr<CoolProp::AbstractState> AS(CoolProp::AbstractState::factory("HEOS", fluids));
+    if (o.c_ref.size() != 4) { throw CoolProp::ValueError(fmt::format("The reference model needs 4 binary interaction parameters; %d were given", o.c_ref.size())); }
+    const char *params[] = { "betaT", "gammaT", "betaV", "gammaV" };
+    for (std::size_t k = 0; k < 4; ++k) {
+        AS->set_binary_interaction_double(0, 1, params[k], o.c_ref[k]);
+    }
+    if (!o.departure_JSON.empty()) {
+        CoolProp::HelmholtzEOSMixtureBackend *HEOS = static_cast<CoolProp::HelmholtzEOSMixtureBackend*>(AS.get());
+        for (std::size_t i = 0; i <= 1; ++i) {
+            std::size_t j = 1 - i;
+            HEOS->residual_helmholtz->Excess.DepartureFunctionMatrix[i][j].reset(new PhiFitDepartureFunction(departure["departure[ij]"]));
+            HEOS->SatL->residual_helmholtz->Excess.DepartureFunctionMatrix[i][j].reset(new PhiFitDepartureFunction(departure["departure[ij]"]));
+            HEOS->SatV->residual_helmholtz->Excess.DepartureFunctionMatrix[i][j].reset(new PhiFitDepartureFunction(departure["departure[ij]"]));
+            HEOS->set_binary_interaction_double(i, j, "Fij", 1.0); // Turn on departure term
+        }
+    }
+    return AS;
+}
+
+/// The density of the phase with composition z at T and p from a PT flash, or -1 if the flash fails
+double PT_density(CoolProp::AbstractState &AS, double T, double p, const std::vector<double> &z) {
+    try {
+        AS.set_mole_fractions(z);
+        AS.update(CoolProp::PT_INPUTS, p, T);
+        double rho = AS.rhomolar();
+        return (std::isfinite(rho) && rho > 0) ? rho : -1;
+    }
+    catch (...) {
+        return -1;
+    }
+}
+
+}
+
+void validate_dataset(const std::string &JSON_data, const std::string &schema_JSON) {
+    std::string errstr;
+    cpjson::schema_validation_code code = cpjson::validate_schema(schema_JSON, JSON_data, errstr);
+    switch (code) {
+        case cpjson::SCHEMA_VALIDATION_OK: return;
+        case cpjson::SCHEMA_INVALID_JSON: throw CoolProp::ValueError("The schema is not valid JSON");
+        case cpjson::INPUT_INVALID_JSON: throw CoolProp::ValueError("The dataset is not valid JSON");
+        default: throw CoolProp::ValueError(fmt::format("The dataset does not conform to the schema: %s", errstr.c_str()));
+    }
+}
+
+std::string dataset_cache_key(const std::string &JSON_data, const PrepareOptions &o) {
+    std::ostringstream model;
+    model.precision(17);
+    for (double c : o.c_ref) { model << c << ","; }
+    model << o.departure_JSON;
+    return hex(fnv1a(JSON_data)) + "-" + hex(fnv1a(model.str()));
+}
+
+std::string find_prepared_dataset(const std::string &JSON_data, const PrepareOptions &o) {
+    if (o.cache_dir.empty()) { return ""; }
+    std::string path = cache_path(dataset_cache_key(JSON_data, o), o);
+    return file_exists(path) ? get_file_contents(path.c_str()) : "";
+}
+
+std::string prepare_dataset(const std::string &JSON_data, const PrepareOptions &o) {
+    std::string cached = find_prepared_dataset(JSON_data, o);
+    if (!cached.empty()) { return cached; }
+
+    if (!o.schema_path.empty()) {
+        validate_dataset(JSON_data, get_file_contents(o.schema_path.c_str()));
+    }
+    rapidjson::Document doc;
+    cpjson::JSON_string_to_rapidjson(JSON_data, doc);
+    if (!doc.HasMember("data") || !doc["data"].IsArray()) { throw CoolProp::ValueError("The dataset has no \"data\" array"); }
+    std::string fluids = strjoin(cpjson::get_string_array(doc["about"], "names"), "&");
+    rapidjson::Document departure;
+    if (!o.departure_JSON.empty()) { cpjson::JSON_string_to_rapidjson(o.departure_JSON, departure); }
+
+    // The PTXY points that have no density guess for one or both phases
+    std::vector<rapidjson::Value*> points;
+    for (rapidjson::Value::ValueIterator itr = doc["data"].Begin(); itr != doc["data"].End(); ++itr) {
+        if (!itr->HasMember("type") || cpjson::get_string(*itr, "type") != "PTXY") { continue; }
+        bool have_guesses = itr->HasMember("rho' (guess,mol/m3)") && itr->HasMember("rho'' (guess,mol/m3)")
+            && cpjson::get_double(*itr, "rho' (guess,mol/m3)") > 0 && cpjson::get_double(*itr, "rho'' (guess,mol/m3)") > 0;
+        if (!have_guesses) { points.push_back(&(*itr)); }
+    }
+
+    // Solve for the densities, one AbstractState per thread; the points are dealt out round-robin
+    const std::size_t Nthreads = static_cast<std::size_t>(std::max(o.Nthreads, static_cast<short>(1)));
+    std::vector<std::shared_ptr<CoolProp::AbstractState> > states;
+    for (std::size_t i = 0; i < Nthreads; ++i) {
+        states.push_back(reference_state(fluids, o, departure));
+    }
+    std::vector<double> rhoL(points.size(), -1), rhoV(points.size(), -1);
+    // A malformed point (the schema check may have been skipped) makes its thread stop; the error is rethrown here
+    std::vector<std::exception_ptr> errors(Nthreads);
+    std::vector<std::thread> threads;
+    for (std::size_t i = 0; i < Nthreads; ++i) {
+        threads.push_back(std::thread([&, i]() {
+            try {
+                for (std::size_t j = i; j < points.size(); j += Nthreads) {
+                    rapidjson::Value &pt = *points[j];
+                    double T = cpjson::get_double(pt, "T (K)"), p = cpjson::get_double(pt, "p (Pa)");
+                    rhoL[j] = PT_density(*states[i], T, p, cpjson::get_double_array(pt, "x (molar)"));
+                    rhoV[j] = PT_density(*states[i], T, p, cpjson::get_double_array(pt, "y (molar)"));
+                }
+            }
+            catch (...) {
+                errors[i] = std::current_exception();
+            }
+        }));
+    }
+    for (auto &t : threads) { t.join(); }
+    for (auto &e : errors) {
+        if (e) { std::rethrow_exception(e); }
+    }
+
+    // Write the densities back into the dataset
+    std::size_t Nunsolved = 0;
+    for (std::size_t j = 0; j < points.size(); ++j) {
+        rapidjson::Value &pt = *points[j];
+        const char *keys[] = { "rho' (guess,mol/m3)", "rho'' (guess,mol/m3)" };
+        double rho[] = { rhoL[j], rhoV[j] };
+        for (std::size_t k = 0; k < 2; ++k) {
+            if (pt.HasMember(keys[k])) { pt[keys[k]].SetDouble(rho[k]); }
+            else { pt.AddMember(rapidjson::Value(keys[k], doc.GetAllocator()).Move(), rho[k], doc.GetAllocator()); }
+            if (rho[k] < 0) { Nunsolved++; }
+        }
+    }
+    std::string key = dataset_cache_key(JSON_data, o);
+    rapidjson::Value prepared; prepared.SetObject();
+    cpjson::set_string("key", key, prepared, doc);
+    cpjson::set_double_array("reference c", o.c_ref, prepared, doc);
+    prepared.AddMember("solved points", static_cast<double>(points.size()), doc.GetAllocator());
+    prepared.AddMember("unsolved phases", static_cast<double>(Nunsolved), doc.GetAllocator());
+    if (doc["about"].HasMember("prepared")) { doc["about"].RemoveMember("prepared"); }
+    doc["about"].AddMember("prepared", prepared, doc.GetAllocator());
+    std::string out = cpjson::json2string(doc);
+
+    if (!o.cache_dir.empty()) {
+        // Write to a temporary file and then move it into place, so that a reader never sees a partial file
+        std::string path = cache_path(key, o), tmp_path = path + ".tmp";
+        {
+            std::ofstream ofs(tmp_path.c_str(), std::ios::trunc);
+            if (!ofs) { throw CoolProp::ValueError(fmt::format("Unable to open %s for writing", tmp_path.c_str())); }
+            ofs << out;
+        }
+        if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+            throw CoolProp::ValueError(fmt::format("Unable to move the prepared dataset into place at %s", path.c_str()));
+        }
+    }
+    return out;
+}
@@ -0,0 +1,191 @@
+#include "phifit/process_shards.h"
+
+// Includes from CoolProp
+#include "AbstractState.h"
+
+// Includes from c++
+#include <string>
+#include <algorithm>
+#include <cstdint>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define PHIFIT_HAVE_FORK
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+namespace {
+
+const char command_evaluate = 'e', command_quit = 'q', reply_done = 'd', reply_failed = 'x';
+
+#if defined(PHIFIT_HAVE_FORK)
+/// Read one byte, retrying if interrupted; returns false at end of file or on error
+bool read_byte(int fd, char &c) {
+    for (;;) {
+        ssize_t n = read(fd, &c, 1);
+        if (n == 1) { return true; }
+        if (n < 0 && errno == EINTR) { continue; }
+        return false;
+    }
+}
+bool write_byte(int fd, char c) {
+    for (;;) {
+        ssize_t n = write(fd, &c, 1);
+        if (n == 1) { return true; }
+        if (n < 0 && errno == EINTR) { continue; }
+        return false;
+    }
+}
+/// Write all the bytes, retrying if interrupted or cut short
+bool write_all(int fd, const char *buf, std::size_t N) {
+    while (N > 0) {
+        ssize_t n = write(fd, buf, N);
+        if (n < 0 && errno == EINTR) { continue; }
+        if (n <= 0) { return false; }
+        buf += n; N -= static_cast<std::size_t>(n);
+    }
+    return true;
+}
+/// Read exactly N bytes; returns false at end of file or on error
+bool read_all(int fd, char *buf, std::size_t N) {
+    while (N > 0) {
+        ssize_t n = read(fd, buf, N);
+        if (n < 0 && errno == EINTR) { continue; }
+        if (n <= 0) { return false; }
+        buf += n; N -= static_cast<std::size_t>(n);
+    }
+    return true;
+}
+/// A message goes as its length, then its characters
+bool write_message(int fd, const std::string &message) {
+    std::uint64_t N = message.size();
+    return write_all(fd, reinterpret_cast<const char *>(&N), sizeof(N)) && write_all(fd, message.data(), message.size());
+}
+bool read_message(int fd, std::string &message) {
+    std::uint64_t N = 0;
+    if (!read_all(fd, reinterpret_cast<char *>(&N), sizeof(N))) { return false; }
+    message.resize(static_cast<std::size_t>(N));
+    return N == 0 || read_all(fd, &message[0], message.size());
+}
+#endif
+
+}
+
+ProcessShards::ProcessShards(const std::vector<std::size_t> &shard_sizes, std::size_t Ncoeffs, const Task &task) : m_Ncoeffs(Ncoeffs), m_bytes(0), m_shared(nullptr) {
+#if defined(PHIFIT_HAVE_FORK)
+    if (shard_sizes.empty()) { throw CoolProp::ValueError("At least one shard is required"); }
+    std::size_t Ndoubles = Ncoeffs;
+    for (std::size_t size : shard_sizes) {
+        m_offsets.push_back(Ndoubles);
+        Ndoubles += size;
+    }
+    m_bytes = std::max(Ndoubles, static_cast<std::size_t>(1))*sizeof(double);
+    void *shared = mmap(nullptr, m_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (shared == MAP_FAILED) { throw CoolProp::ValueError("Unable to map shared memory for the worker processes"); }
+    m_shared = static_cast<double*>(shared);
+
+    for (std::size_t shard = 0; shard < shard_sizes.size(); ++shard) {
+        int command[2], reply[2];
+        if (pipe(command) != 0) { stop(); throw CoolProp::ValueError("Unable to create a pipe for a worker process"); }
+        if (pipe(reply) != 0) { close(command[0]); close(command[1]); stop(); throw CoolProp::ValueError("Unable to create a pipe for a worker process"); }
+        pid_t pid = fork();
+        if (pid < 0) {
+            close(command[0]); close(command[1]); close(reply[0]); close(reply[1]);
+            stop();
+            throw CoolProp::ValueError("Unable to fork a worker process");
+        }
+        if (pid == 0) {
+            // The worker: close the ends that belong to the coordinator, including those of the workers forked earlier
+            close(command[1]); close(reply[0]);
+            for (int fd : m_command_fds) { close(fd); }
+            for (int fd : m_reply_fds) { close(fd); }
+            std::vector<double> c(m_Ncoeffs);
+            std::string message;
+            char cmd;
+            while (read_byte(command[0], cmd) && cmd == command_evaluate) {
+                c.assign(m_shared, m_shared + m_Ncoeffs);
+                char status = reply_done;
+                message.clear();
+                try {
+                    task(shard, c, m_shared + m_offsets[shard], message);
+                }
+                catch (std::exception &e) {
+                    status = reply_failed;
+                    message = e.what();
+                }
+                catch (...) {
+                    status = reply_failed;
+                    message = "Undefined error";
+                }
+                if (!write_byte(reply[1], status) || !write_message(reply[1], message)) { break; }
+            }
+            // Leave without running any destructors or exit handlers of the coordinator's state
+            _exit(0);
+        }
+        close(command[0]); close(reply[1]);
+        m_pids.push_back(pid);
+        m_command_fds.push_back(command[1]);
+        m_reply_fds.push_back(reply[0]);
+    }
+    m_messages.resize(shard_sizes.size());
+#else
+    (void)shard_sizes; (void)task;
+    throw CoolProp::NotImplementedError("Evaluation in worker processes is only available on POSIX platforms");
+#endif
+}
+
+ProcessShards::~ProcessShards() {
+    stop();
+}
+
+void ProcessShards::run(const std::vector<double> &c) {
+#if defined(PHIFIT_HAVE_FORK)
+    if (c.size() != m_Ncoeffs) {
+        throw CoolProp::ValueError(fmt::format("The worker processes were started for %d coefficients, but %d were given", m_Ncoeffs, c.size()));
+    }
+    std::copy(c.begin(), c.end(), m_shared);
+    for (std::size_t shard = 0; shard < size(); ++shard) {
+        if (!write_byte(m_command_fds[shard], command_evaluate)) {
+            throw CoolProp::ValueError(fmt::format("Worker process %d has gone away", shard));
+        }
+    }
+    // Collect every reply before reporting a failure, so that the workers are all idle again
+    std::string failures;
+    for (std::size_t shard = 0; shard < size(); ++shard) {
+        char status;
+        m_messages[shard].clear();
+        if (!read_byte(m_reply_fds[shard], status) || !read_message(m_reply_fds[shard], m_messages[shard])) {
+            failures += fmt::format(" worker %d exited;", shard);
+        }
+        else if (status != reply_done) {
+            failures += fmt::format(" worker %d threw: %s;", shard, m_messages[shard].c_str());
+        }
+    }
+    if (!failures.empty()) {
+        throw CoolProp::ValueError("Evaluation in worker processes failed:" + failures);
+    }
+#else
+    (void)c;
+#endif
+}
+
+void ProcessShards::stop() {
+#if defined(PHIFIT_HAVE_FORK)
+    for (int fd : m_command_fds) {
+        write_byte(fd, command_quit);
+        close(fd);
+    }
+    for (int fd : m_reply_fds) { close(fd); }
+    for (int pid : m_pids) {
+        int status;
+        while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {};
+    }
+    m_pids.clear(); m_command_fds.clear(); m_reply_fds.clear();
+    if (m_shared != nullptr) {
+        munmap(m_shared, m_bytes);
+        m_shared = nullptr;
+    }
+#endif
+}
@@ -0,0 +1,31 @@
+#include "phifit/quarantine.h"
+
+#include <cmath>
+
+bool PointQuarantine::skip(const QuarantinePolicy &policy, const std::vector<double> &c) {
+    if (!quarantined) { return false; }
+    if (policy.retry_every > 0 && Nskipped >= policy.retry_every) { return false; }
+    if (c.size() != c_failed.size()) { return false; }
+    double diff2 = 0, norm2 = 0;
+    for (std::size_t i = 0; i < c.size(); ++i) {
+        diff2 += (c[i] - c_failed[i])*(c[i] - c_failed[i]);
+        norm2 += c_failed[i]*c_failed[i];
+    }
+    if (std::sqrt(diff2) > policy.retry_shift*std::sqrt(norm2)) { return false; }
+    Nskipped++;
+    return true;
+}
+
+void PointQuarantine::record(const QuarantinePolicy &policy, bool failed, const std::vector<double> &c) {
+    Nskipped = 0;
+    if (!failed) {
+        Nconsecutive = 0;
+        quarantined = false;
+        return;
+    }
+    Nconsecutive++;
+    c_failed = c;
+    if (policy.max_failures > 0 && Nconsecutive >= policy.max_failures) {
+        quarantined = true;
+    }
+}
@@ -0,0 +1,75 @@
+#include "phifit/schedule.h"
+
+// Includes from CoolProp
+#include "AbstractState.h"
+#include "rapidjson_include.h"
+
+// Includes from c++
+#include <map>
+#include <random>
+#include <cmath>
+#include <algorithm>
+
+std::vector<std::size_t> assign_stages(const std::vector<std::string> &sources, const std::vector<double> &fractions, unsigned long long seed, bool stratify) {
+    if (fractions.empty()) { throw CoolProp::ValueError("At least one stage is needed"); }
+    for (std::size_t s = 0; s < fractions.size(); ++s) {
+        if (!(fractions[s] > 0 && fractions[s] <= 1) || (s > 0 && !(fractions[s] > fractions[s - 1]))) {
+            throw CoolProp::ValueError(fmt::format("The fraction of stage %d is %g; the fractions must increase and be in (0, 1]", s, fractions[s]));
+        }
+    }
+    if (fractions.back() != 1) { throw CoolProp::ValueError(fmt::format("The last stage has a fraction of %g; it must have all the points", fractions.back())); }
+    std::mt19937_64 rng(seed);
+
+    // The points of each stratum, in order of the first appearance of the stratum
+    std::vector<std::vector<std::size_t> > strata;
+    std::map<std::string, std::size_t> index;
+    for (std::size_t i = 0; i < sources.size(); ++i) {
+        const std::string key = stratify ? sources[i] : std::string();
+        std::map<std::string, std::size_t>::iterator it = index.find(key);
+        if (it == index.end()) {
+            it = index.insert(std::make_pair(key, strata.size())).first;
+            strata.push_back(std::vector<std::size_t>());
+        }
+        strata[it->second].push_back(i);
+    }
+    // The share of each stratum is rounded against the running total, so that the stage sizes come out right
+    // even when the sources are small
+    std::vector<std::size_t> first(sources.size());
+    std::size_t before = 0;
+    for (auto &stratum : strata) {
+        std::shuffle(stratum.begin(), stratum.end(), rng);
+        const std::size_t after = before + stratum.size();
+        std::size_t r = 0;
+        for (std::size_t s = 0; s < fractions.size(); ++s) {
+            const std::size_t n = static_cast<std::size_t>(std::round(fractions[s]*after) - std::round(fractions[s]*before));
+            for (; r < std::min(n, stratum.size()); ++r) { first[stratum[r]] = s; }
+        }
+        before = after;
+    }
+    if (!sources.empty() && std::round(fractions[0]*sources.size()) < 1) {
+        throw CoolProp::ValueError(fmt::format("The first stage has no points; %g of %d points rounds to zero", fractions[0], sources.size()));
+    }
+    return first;
+}
+
+std::string fit_schedule_to_JSON(const FitScheduleResult &result) {
+    rapidjson::Document doc;
+    doc.SetObject();
+    doc.AddMember("elapsed (s)", result.elapsed_sec, doc.GetAllocator());
+    rapidjson::Value stages(rapidjson::kArrayType);
+    for (auto &st : result.stages) {
+        rapidjson::Value val; val.SetObject();
+        val.AddMember("stage", static_cast<double>(st.stage), doc.GetAllocator());
+        val.AddMember("points", static_cast<double>(st.Npoints), doc.GetAllocator());
+        val.AddMember("residuals", static_cast<double>(st.Nresiduals), doc.GetAllocator());
+        val.AddMember("iterations", static_cast<double>(st.iter), doc.GetAllocator());
+        val.AddMember("SSE", st.SSE, doc.GetAllocator());
+        val.AddMember("elapsed (s)", st.elapsed_sec, doc.GetAllocator());
+        val.AddMember("converged", st.converged, doc.GetAllocator());
+        cpjson::set_double_array("c", st.c, val, doc);
+        flash_counts_to_JSON(st.Nflash, val, doc);
+        stages.PushBack(val, doc.GetAllocator());
+    }
+    doc.AddMember("stages", stages, doc.GetAllocator());
+    return cpjson::json2string(doc);
+}
@@ -0,0 +1,139 @@
+#include "phifit/telemetry.h"
+
+// Includes from c++
+#include <map>
+#include <algorithm>
+
+const char *flash_type_name(PhiFitFlashType type) {
+    switch (type) {
+    case FLASH_NONE: return "none";
+    case FLASH_LOCAL_PT: return "local PT";
+    case FLASH_GLOBAL_PT: return "global PT";
+    case FLASH_DIRECT_DT: return "direct DT";
+    case FLASH_BATCH_PT: return "batch PT";
+    default: return "unknown";
+    }
+}
+
+void PointTelemetry::add(const PointTelemetry &t) {
+    Nevals += t.Nevals;
+    Nexceptions += t.Nexceptions;
+    Nskipped += t.Nskipped;
+    for (std::size_t i = 0; i < FLASH_TYPE_COUNT; ++i) { Nflash[i] += t.Nflash[i]; }
+    elapsed_sec += t.elapsed_sec;
+    max_sec = std::max(max_sec, t.max_sec);
+    if (t.last_flash != FLASH_NONE) { last_flash = t.last_flash; }
+    if (!t.last_error.empty()) { last_error = t.last_error; }
+}
+
+void pack_point_telemetry(const PointTelemetry &t, double *out) {
+    out[0] = static_cast<double>(t.Nevals);
+    out[1] = static_cast<double>(t.Nexceptions);
+    out[2] = static_cast<double>(t.Nskipped);
+    out[3] = t.elapsed_sec;
+    out[4] = t.max_sec;
+    out[5] = static_cast<double>(t.last_flash);
+    for (std::size_t i = 0; i < FLASH_TYPE_COUNT; ++i) { out[6 + i] = static_cast<double>(t.Nflash[i]); }
+}
+
+PointTelemetry unpack_point_telemetry(const double *in) {
+    PointTelemetry t;
+    t.Nevals = static_cast<std::size_t>(in[0]);
+    t.Nexceptions = static_cast<std::size_t>(in[1]);
+    t.Nskipped = static_cast<std::size_t>(in[2]);
+    t.elapsed_sec = in[3];
+    t.max_sec = in[4];
+    t.last_flash = static_cast<PhiFitFlashType>(static_cast<int>(in[5]));
+    for (std::size_t i = 0; i < FLASH_TYPE_COUNT; ++i) { t.Nflash[i] = static_cast<std::size_t>(in[6 + i]); }
+    return t;
+}
+
+void TelemetryAggregate::add(const PointTelemetry &t, bool failing) {
+    Npoints++;
+    Nevals += t.Nevals;
+    Nexceptions += t.Nexceptions;
+    Nskipped += t.Nskipped;
+    if (failing) { Nfailing++; }
+    for (std::size_t i = 0; i < FLASH_TYPE_COUNT; ++i) { Nflash[i] += t.Nflash[i]; }
+    elapsed_sec += t.elapsed_sec;
+    max_sec = std::max(max_sec, t.max_sec);
+    if (!t.last_error.empty()) { last_error = t.last_error; }
+}
+
+void flash_counts_to_JSON(const std::size_t *Nflash, rapidjson::Value &val, rapidjson::Document &doc) {
+    rapidjson::Value counts; counts.SetObject();
+    for (std::size_t i = 1; i < FLASH_TYPE_COUNT; ++i) {
+        counts.AddMember(rapidjson::Value(flash_type_name(static_cast<PhiFitFlashType>(i)), doc.GetAllocator()).Move(),
+                         static_cast<double>(Nflash[i]), doc.GetAllocator());
+    }
+    val.AddMember("flashes", counts, doc.GetAllocator());
+}
+
+namespace {
+
+/// Add the point to the group with the given key, creating the group (in order of first appearance) if needed
+void add_to_group(std::vector<TelemetryAggregate> &groups, std::map<std::string, std::size_t> &index, const std::string &key, const PointTelemetry &t, bool failing) {
+    std::map<std::string, std::size_t>::iterator it = index.find(key);
+    if (it == index.end()) {
+        it = index.insert(std::make_pair(key, groups.size())).first;
+        groups.push_back(TelemetryAggregate());
+        groups.back().key = key;
+    }
+    groups[it->second].add(t, failing);
+}
+
+void aggregates_to_JSON(const char *key, const std::vector<TelemetryAggregate> &groups, rapidjson::Value &parent, rapidjson::Document &doc) {
+    rapidjson::Value list(rapidjson::kArrayType);
+    for (std::size_t i = 0; i < groups.size(); ++i) {
+        const TelemetryAggregate &g = groups[i];
+        rapidjson::Value val; val.SetObject();
+        cpjson::set_string("key", g.key, val, doc);
+        val.AddMember("points", static_cast<double>(g.Npoints), doc.GetAllocator());
+        val.AddMember("evaluations", static_cast<double>(g.Nevals), doc.GetAllocator());
+        val.AddMember("exceptions", static_cast<double>(g.Nexceptions), doc.GetAllocator());
+        val.AddMember("skipped (quarantined)", static_cast<double>(g.Nskipped), doc.GetAllocator());
+        val.AddMember("failing points", static_cast<double>(g.Nfailing), doc.GetAllocator());
+        val.AddMember("elapsed (s)", g.elapsed_sec, doc.GetAllocator());
+        val.AddMember("mean per evaluation (s)", (g.Nevals > 0) ? g.elapsed_sec/g.Nevals : 0.0, doc.GetAllocator());
+        val.AddMember("max per evaluation (s)", g.max_sec, doc.GetAllocator());
+        flash_counts_to_JSON(g.Nflash, val, doc);
+        cpjson::set_string("last error", g.last_error, val, doc);
+        list.PushBack(val, doc.GetAllocator());
+    }
+    parent.AddMember(rapidjson::Value(key, doc.GetAllocator()).Move(), list, doc.GetAllocator());
+}
+
+}
+
+TelemetrySummary summarize_telemetry(const std::vector<PointTelemetry> &points, const std::vector<std::string> &types, const std::vector<std::string> &sources, const std::vector<bool> &failing) {
+    TelemetrySummary summary;
+    std::map<std::string, std::size_t> type_index, source_index;
+    for (std::size_t i = 0; i < points.size(); ++i) {
+        add_to_group(summary.by_type, type_index, types[i], points[i], failing[i]);
+        add_to_group(summary.by_source, source_index, sources[i], points[i], failing[i]);
+    }
+    return summary;
+}
+
+void point_telemetry_to_JSON(const PointTelemetry &t, rapidjson::Value &val, rapidjson::Document &doc) {
+    val.AddMember("evaluations", static_cast<double>(t.Nevals), doc.GetAllocator());
+    val.AddMember("exceptions", static_cast<double>(t.Nexceptions), doc.GetAllocator());
+    val.AddMember("skipped (quarantined)", static_cast<double>(t.Nskipped), doc.GetAllocator());
+    val.AddMember("elapsed (s)", t.elapsed_sec, doc.GetAllocator());
+    val.AddMember("max per evaluation (s)", t.max_sec, doc.GetAllocator());
+    flash_counts_to_JSON(t.Nflash, val, doc);
+    cpjson::set_string("last flash", flash_type_name(t.last_flash), val, doc);
+    cpjson::set_string("last error", t.last_error, val, doc);
+}
+
+void telemetry_summary_to_JSON(const TelemetrySummary &summary, rapidjson::Value &val, rapidjson::Document &doc) {
+    aggregates_to_JSON("by type", summary.by_type, val, doc);
+    aggregates_to_JSON("by source", summary.by_source, val, doc);
+}
+
+std::string telemetry_to_JSON(const TelemetrySummary &summary) {
+    rapidjson::Document doc;
+    doc.SetObject();
+    telemetry_summary_to_JSON(summary, doc, doc);
+    return cpjson::json2string(doc);
+}
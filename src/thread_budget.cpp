@@ -0,0 +1,40 @@
+#include "phifit/thread_budget.h"
+
+#include <thread>
+#include <chrono>
+#include <algorithm>
+
+ThreadBudget::ThreadBudget(std::size_t total) {
+    if (total == 0) { total = std::max(std::thread::hardware_concurrency(), 1u); }
+    m_total = total;
+    m_available = total;
+}
+
+std::size_t ThreadBudget::acquire(std::size_t N, const std::atomic<bool> *cancel) {
+    N = std::min(std::max(N, static_cast<std::size_t>(1)), m_total);
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (cancel == nullptr) {
+        m_cv.wait(lock, [this, N]() { return m_available >= N; });
+    }
+    else {
+        // Nothing notifies the budget of a cancellation, so poll the flag while waiting
+        while (!m_cv.wait_for(lock, std::chrono::milliseconds(10), [this, N]() { return m_available >= N; })) {
+            if (*cancel) { return 0; }
+        }
+    }
+    m_available -= N;
+    return N;
+}
+
+void ThreadBudget::release(std::size_t N) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_available += N;
+    }
+    m_cv.notify_all();
+}
+
+const std::shared_ptr<ThreadBudget> &ThreadBudget::global() {
+    static std::shared_ptr<ThreadBudget> budget(new ThreadBudget());
+    return budget;
+}
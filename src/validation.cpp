@@ -0,0 +1,176 @@
+#include "phifit/validation.h"
+#include "phifit/data_generation.h"
+
+// Includes from CoolProp
+#include "AbstractState.h"
+#include "rapidjson_include.h"
+
+// Includes from c++
+#include <map>
+#include <thread>
+#include <exception>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+namespace {
+
+/// Running sums of one group
+struct DeviationSums {
+    double sum, sum_abs, sum2, max_abs;
+    DeviationSums() : sum(0), sum_abs(0), sum2(0), max_abs(0) {};
+};
+
+void add_to_group(std::vector<DeviationStats> &groups, std::vector<DeviationSums> &sums, std::map<std::string, std::size_t> &index, const std::string &key, double dev, bool failed) {
+    std::map<std::string, std::size_t>::iterator it = index.find(key);
+    if (it == index.end()) {
+        it = index.insert(std::make_pair(key, groups.size())).first;
+        groups.push_back(DeviationStats());
+        groups.back().key = key;
+        sums.push_back(DeviationSums());
+    }
+    DeviationStats &g = groups[it->second];
+    if (failed) { g.Nfailed++; return; }
+    DeviationSums &s = sums[it->second];
+    g.N++;
+    s.sum += dev;
+    s.sum_abs += std::abs(dev);
+    s.sum2 += dev*dev;
+    s.max_abs = std::max(s.max_abs, std::abs(dev));
+}
+
+void finish(std::vector<DeviationStats> &groups, const std::vector<DeviationSums> &sums) {
+    for (std::size_t i = 0; i < groups.size(); ++i) {
+        DeviationStats &g = groups[i];
+        if (g.N == 0) { continue; }
+        g.AAD = sums[i].sum_abs/g.N;
+        g.bias = sums[i].sum/g.N;
+        g.RMS = std::sqrt(sums[i].sum2/g.N);
+        g.max_abs = sums[i].max_abs;
+    }
+}
+
+rapidjson::Value number(double val) {
+    rapidjson::Value v;
+    if (std::isfinite(val)) { v.SetDouble(val); }
+    return v;
+}
+
+rapidjson::Value columns(const std::vector<std::string> &names, rapidjson::Document &doc) {
+    rapidjson::Value cols(rapidjson::kArrayType);
+    for (auto &name : names) { cols.PushBack(rapidjson::Value(name.c_str(), doc.GetAllocator()).Move(), doc.GetAllocator()); }
+    return cols;
+}
+
+rapidjson::Value stats_table(const std::vector<DeviationStats> &groups, rapidjson::Document &doc) {
+    rapidjson::Value table; table.SetObject();
+    table.AddMember("columns", columns({ "key", "N", "failed", "AAD", "bias", "RMS", "max" }, doc).Move(), doc.GetAllocator());
+    rapidjson::Value rows(rapidjson::kArrayType);
+    for (auto &g : groups) {
+        rapidjson::Value row(rapidjson::kArrayType);
+        row.PushBack(rapidjson::Value(g.key.c_str(), doc.GetAllocator()).Move(), doc.GetAllocator());
+        row.PushBack(static_cast<double>(g.N), doc.GetAllocator());
+        row.PushBack(static_cast<double>(g.Nfailed), doc.GetAllocator());
+        row.PushBack(number(g.AAD).Move(), doc.GetAllocator());
+        row.PushBack(number(g.bias).Move(), doc.GetAllocator());
+        row.PushBack(number(g.RMS).Move(), doc.GetAllocator());
+        row.PushBack(number(g.max_abs).Move(), doc.GetAllocator());
+        rows.PushBack(row, doc.GetAllocator());
+    }
+    table.AddMember("rows", rows, doc.GetAllocator());
+    return table;
+}
+
+}
+
+DeviationSummary summarize_deviations(const std::vector<double> &dev, const std::vector<std::string> &types, const std::vector<std::string> &sources, const std::vector<bool> &failed) {
+    DeviationSummary summary;
+    std::vector<DeviationStats> overall;
+    std::vector<DeviationSums> overall_sums, type_sums, source_sums;
+    std::map<std::string, std::size_t> overall_index, type_index, source_index;
+    for (std::size_t i = 0; i < dev.size(); ++i) {
+        add_to_group(overall, overall_sums, overall_index, "all", dev[i], failed[i]);
+        add_to_group(summary.by_type, type_sums, type_index, types[i], dev[i], failed[i]);
+        add_to_group(summary.by_source, source_sums, source_index, sources[i], dev[i], failed[i]);
+    }
+    finish(overall, overall_sums);
+    finish(summary.by_type, type_sums);
+    finish(summary.by_source, source_sums);
+    if (!overall.empty()) { summary.overall = overall[0]; }
+    summary.overall.key = "all";
+    return summary;
+}
+
+std::vector<VLEIsotherm> evaluate_isotherms(const ModelStateFactory &factory, const std::vector<double> &T, const ValidationOptions &o) {
+    std::vector<double> x0 = linspace(o.x0min, o.x0max, o.Nx);
+    std::vector<VLEIsotherm> isotherms(T.size());
+    const std::size_t Nthreads = std::min(static_cast<std::size_t>(std::max(o.Nthreads, static_cast<short>(1))), std::max(T.size(), static_cast<std::size_t>(1)));
+    // A failed flash is left as NaN, but a failure to build the model is rethrown after the join
+    std::vector<std::exception_ptr> errors(Nthreads);
+    std::vector<std::thread> threads;
+    for (std::size_t i = 0; i < Nthreads; ++i) {
+        threads.push_back(std::thread([&, i]() {
+            std::shared_ptr<CoolProp::AbstractState> AS;
+            try {
+                AS = factory();
+            }
+            catch (...) {
+                errors[i] = std::current_exception();
+                return;
+            }
+            for (std::size_t j = i; j < T.size(); j += Nthreads) {
+                VLEIsotherm &iso = isotherms[j];
+                iso.T = T[j];
+                iso.x0 = x0;
+                iso.p.assign(x0.size(), std::numeric_limits<double>::quiet_NaN());
+                iso.y0.assign(x0.size(), std::numeric_limits<double>::quiet_NaN());
+                for (std::size_t k = 0; k < x0.size(); ++k) {
+                    try {
+                        std::vector<double> z(2, x0[k]); z[1] = 1 - x0[k];
+                        AS->set_mole_fractions(z);
+                        AS->update(CoolProp::QT_INPUTS, 0, T[j]);
+                        iso.p[k] = AS->p();
+                        iso.y0[k] = AS->mole_fractions_vapor()[0];
+                    }
+                    catch (...) {
+                        // Left as NaN
+                    }
+                }
+            }
+        }));
+    }
+    for (auto &t : threads) { t.join(); }
+    for (auto &e : errors) {
+        if (e) { std::rethrow_exception(e); }
+    }
+    return isotherms;
+}
+
+std::string validation_to_JSON(const ValidationReport &report) {
+    rapidjson::Document doc;
+    doc.SetObject();
+    doc.AddMember("elapsed (s)", report.elapsed_sec, doc.GetAllocator());
+    doc.AddMember("overall", stats_table(std::vector<DeviationStats>(1, report.deviations.overall), doc).Move(), doc.GetAllocator());
+    doc.AddMember("by type", stats_table(report.deviations.by_type, doc).Move(), doc.GetAllocator());
+    doc.AddMember("by source", stats_table(report.deviations.by_source, doc).Move(), doc.GetAllocator());
+    if (!report.isotherms.empty()) {
+        rapidjson::Value isotherms(rapidjson::kArrayType);
+        for (auto &iso : report.isotherms) {
+            rapidjson::Value table; table.SetObject();
+            table.AddMember("T (K)", iso.T, doc.GetAllocator());
+            table.AddMember("columns", columns({ "x0 (molar)", "p (Pa)", "y0 (molar)" }, doc).Move(), doc.GetAllocator());
+            rapidjson::Value rows(rapidjson::kArrayType);
+            for (std::size_t k = 0; k < iso.x0.size(); ++k) {
+                rapidjson::Value row(rapidjson::kArrayType);
+                row.PushBack(number(iso.x0[k]).Move(), doc.GetAllocator());
+                row.PushBack(number(iso.p[k]).Move(), doc.GetAllocator());
+                row.PushBack(number(iso.y0[k]).Move(), doc.GetAllocator());
+                rows.PushBack(row, doc.GetAllocator());
+            }
+            table.AddMember("rows", rows, doc.GetAllocator());
+            isotherms.PushBack(table, doc.GetAllocator());
+        }
+        doc.AddMember("isotherms", isotherms, doc.GetAllocator());
+    }
+    return cpjson::json2string(doc);
+}
@@ -0,0 +1,86 @@
+#include "phifit/worker_pool.h"
+
+#include <chrono>
+#include <algorithm>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+
+/// Pin the thread to one CPU; returns false if that is not possible here
+bool pin_thread(std::thread &t, std::size_t cpu) {
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(t.native_handle(), sizeof(cpu_set_t), &set) == 0;
+#else
+    (void)t; (void)cpu;
+    return false;
+#endif
+}
+
+}
+
+WorkerPool::WorkerPool(std::size_t Nworkers, bool pin) : m_busy(Nworkers, 0.0), m_generation(0), m_Nremaining(0), m_stop(false), m_pinned(pin) {
+    if (Nworkers < 1) { Nworkers = 1; m_busy.resize(1, 0.0); }
+    std::size_t Ncpu = std::max(std::thread::hardware_concurrency(), 1u);
+    for (std::size_t i = 0; i < Nworkers; ++i) {
+        m_threads.push_back(std::thread(&WorkerPool::worker_loop, this, i));
+        if (pin) { m_pinned = pin_thread(m_threads.back(), i % Ncpu) && m_pinned; }
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cv_start.notify_all();
+    for (auto &t : m_threads) { t.join(); }
+}
+
+void WorkerPool::run(const Task &task, std::vector<double> &busy) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_task = task;
+    m_error = nullptr;
+    m_Nremaining = m_threads.size();
+    m_generation++;
+    m_cv_start.notify_all();
+    m_cv_done.wait(lock, [this]() { return m_Nremaining == 0; });
+    m_task = Task();
+    busy = m_busy;
+    if (m_error) { std::rethrow_exception(m_error); }
+}
+
+void WorkerPool::worker_loop(std::size_t i) {
+    std::size_t seen = 0;
+    for (;;) {
+        Task task;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv_start.wait(lock, [this, seen]() { return m_stop || m_generation != seen; });
+            if (m_stop) { return; }
+            seen = m_generation;
+            task = m_task;
+        }
+        auto startTime = std::chrono::high_resolution_clock::now();
+        std::exception_ptr error;
+        try {
+            task(i);
+        }
+        catch (...) {
+            error = std::current_exception();
+        }
+        double elapsed = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_busy[i] = elapsed;
+            if (error && !m_error) { m_error = error; }
+            if (--m_Nremaining == 0) { m_cv_done.notify_one(); }
+        }
+    }
+}
@@ -4,12 +4,25 @@
 // Includes from PhiFit
 #include "phifit/data_generation.h"
 #include "phifit/fitter.h"
+#include "phifit/batch.h"
+#include "phifit/density_solver.h"
+#include "phifit/worker_pool.h"
+#include "phifit/prepare.h"
+#include "phifit/evolution.h"
+#include "phifit/async_fit.h"
+#include "phifit/thread_budget.h"
 
 // Includes from CoolProp
 #include "AbstractState.h"
 
 // Includes from standard library
 #include<memory>
+#include<cstdio>
+#include<cstdlib>
+#include<fstream>
+#include<thread>
+#include<stdexcept>
+#include<algorithm>
 
 TEST_CASE("Test fitting betas,gammas", "[simple]") {
     std::string backend = "HEOS", names="Ethane&n-Propane";
@@ -78,4 +91,843 @@ TEST_CASE("Test applying new departure function", "[set_departure_function]") {
     for (std::size_t i = 0; i < cfinal0.size(); ++i) {
         CHECK(std::abs(cfinal1[i] - cfinal0[i]) < 1e-6);
     }
-}
\ No newline at end of file
+}
+
+TEST_CASE("Test checkpointing and resuming a fit", "[checkpoint]") {
+    std::string backend = "HEOS", names = "Ethane&n-Propane";
+    std::string data = gen_JSON_data(backend, names);
+    std::vector<double> c0 = { 1,1,1,1 }, cfinal;
+    std::string path = "phifit_test_checkpoint.bin";
+
+    CoeffFitClass CFC(data);
+    CFC.set_checkpointing(path, 1);
+    bool threading = false; int Nthreads = 1;
+    REQUIRE_NOTHROW(CFC.run(threading, Nthreads, c0));
+    cfinal = CFC.cfinal();
+
+    // A fresh instance picks up the state of the fit, and the user data, from the checkpoint
+    CoeffFitClass CFC2(data);
+    CFC2.save_checkpoint(path + ".user", "generation 7");
+    CHECK(CFC2.load_checkpoint(path + ".user") == "generation 7");
+    REQUIRE(CFC2.load_checkpoint(path) == "");
+    REQUIRE(CFC2.cfinal().size() == cfinal.size());
+    for (std::size_t i = 0; i < cfinal.size(); ++i) {
+        CHECK(CFC2.cfinal()[i] == cfinal[i]);
+    }
+
+    // Resuming the converged fit gives back the same coefficients
+    REQUIRE_NOTHROW(CFC2.resume(threading, Nthreads, path));
+    for (std::size_t i = 0; i < cfinal.size(); ++i) {
+        CHECK(std::abs(CFC2.cfinal()[i] - cfinal[i]) < 1e-8);
+    }
+
+    // A departure function set by name is restored by name
+    CoeffFitClass named(data);
+    named.set_departure_function_by_name("GeneralizedAirWater");
+    named.save_checkpoint(path + ".named");
+    CoeffFitClass CFC3(data);
+    CFC3.load_checkpoint(path + ".named");
+    named.evaluate_serial(c0);
+    CFC3.evaluate_serial(c0);
+    CHECK(CFC3.sum_of_squares() == named.sum_of_squares());
+    // A checkpoint without a departure function cannot be loaded into an instance that has one
+    CHECK_THROWS(CFC3.load_checkpoint(path + ".user"));
+    std::remove(path.c_str());
+    std::remove((path + ".user").c_str());
+    std::remove((path + ".named").c_str());
+}
+
+TEST_CASE("Test per-point evaluation telemetry", "[telemetry]") {
+    std::string backend = "HEOS", names = "Ethane&n-Propane";
+    std::string data = gen_JSON_data(backend, names);
+    std::vector<double> c0 = { 1,1,1,1 };
+
+    CoeffFitClass CFC(data);
+    CFC.evaluate_serial(c0);
+    CFC.evaluate_serial(c0);
+    std::vector<PointTelemetry> points = CFC.point_telemetry();
+    // Each PTXY point has one residual per component, from one pair of flash calculations
+    REQUIRE(2*points.size() == CFC.errorvec().size());
+    for (auto &t : points) {
+        CHECK(t.Nevals == 2);
+        // Generated data carries no density guesses, so both phases need a global flash
+        CHECK(t.Nflash[FLASH_GLOBAL_PT] == 4);
+        CHECK(t.elapsed_sec > 0);
+    }
+    TelemetrySummary summary = CFC.telemetry_summary();
+    REQUIRE(summary.by_type.size() == 1);
+    CHECK(summary.by_type[0].key == "PTXY");
+    CHECK(summary.by_type[0].Npoints == points.size());
+    CHECK(summary.by_type[0].Nevals == 2*points.size());
+
+    CFC.reset_telemetry();
+    CHECK(CFC.point_telemetry()[0].Nevals == 0);
+}
+
+TEST_CASE("Test phase timing of a threaded fit", "[scaling]") {
+    std::string backend = "HEOS", names = "Ethane&n-Propane";
+    std::string data = gen_JSON_data(backend, names);
+    std::vector<double> c0 = { 1,1,1,1 };
+
+    CoeffFitClass CFC(data);
+    REQUIRE_NOTHROW(CFC.run(true, 2, c0));
+    const PhiFitPhaseTimes &t = CFC.phase_times();
+    CHECK(t.Npasses > 0);
+    REQUIRE(t.busy_sec.size() == 2);
+    for (std::size_t i = 0; i < 2; ++i) {
+        CHECK(t.busy_sec[i] > 0);
+        CHECK(t.busy_sec[i] <= t.evaluate_sec);
+        CHECK(t.idle_sec[i] >= 0);
+    }
+    CHECK(t.evaluate_sec + t.assemble_sec + t.solve_sec + t.install_sec <= CFC.elapsed_sec());
+}
+
+TEST_CASE("Test batch fitting from a job manifest", "[batch]") {
+    std::string backend = "HEOS", names = "Ethane&n-Propane";
+    { std::ofstream ofs("batch_data.json"); ofs << gen_JSON_data(backend, names); }
+    {
+        // Two jobs on the same data, both wanting the whole budget, so they run one after the other
+        std::ofstream ofs("batch_manifest.json");
+        ofs << R"({"max threads": 2, "jobs": [
+            {"name": "a", "data": ["batch_data.json"], "c0": [1,1,1,1], "threads": 2, "output": "batch_a.json"},
+            {"name": "b", "data": ["batch_data.json"], "c0": [[1,1,1,1], [0.9,1.1,1,1]], "threads": 4, "output": "batch_b.json"}
+        ]})";
+    }
+    FitManifest manifest = load_manifest("batch_manifest.json");
+    REQUIRE(manifest.jobs.size() == 2);
+    CHECK(manifest.Nthreads == 2);
+    CHECK(manifest.jobs[1].c0.size() == 2);
+    CHECK(manifest.jobs[0].dataset_key() == manifest.jobs[1].dataset_key());
+
+    ThreadBudget budget(manifest.Nthreads);
+    CHECK(run_fit_jobs(manifest.jobs, budget) == 0);
+    for (const std::string path : { "batch_a.json", "batch_b.json" }) {
+        rapidjson::Document doc;
+        cpjson::JSON_string_to_rapidjson(get_file_contents(path.c_str()), doc);
+        CHECK(!doc.HasMember("error"));
+        CHECK(cpjson::get_double_array(doc, "cfinal").size() == 4);
+        // The job asking for more than the budget is held to the budget
+        CHECK(cpjson::get_double(doc, "threads") <= 2);
+        std::remove(path.c_str());
+    }
+
+    // A fitter handed back to the cache is reset before the next job gets it
+    DatasetCache cache;
+    FitJob job = manifest.jobs[0];
+    job.departure_path = "fit0.json";
+    {
+        FitterLease CFC(cache, job);
+        CFC->set_point_enabled(CFC->point_ids()[0], false);
+    }
+    std::shared_ptr<CoeffFitClass> reused = cache.checkout(job);
+    CHECK(reused->disabled_point_ids().empty());
+    std::remove("batch_data.json");
+    std::remove("batch_manifest.json");
+}
+
+TEST_CASE("Test parallel generation of synthetic data", "[generation]") {
+    gen_data_options o;
+    o.names = "Ethane&n-Propane";
+    o.T = linspace(200, 240, 3);
+    o.x0 = linspace(0.2, 0.8, 3);
+    o.p = linspace(1e6, 3e6, 2);
+    o.PTXY = true; o.PRhoT = true; o.critical = true;
+    o.sigma_T = 0.01; o.sigma_p = 1e-4; o.sigma_x = 1e-3; o.sigma_rho = 1e-4;
+    o.seed = 42;
+
+    o.Nthreads = 1;
+    std::string serial = gen_data(o);
+    o.Nthreads = 3;
+    std::string parallel = gen_data(o);
+    // The noise is tied to the point, not to the thread that generated it
+    CHECK(serial == parallel);
+
+    CoeffFitClass CFC(parallel);
+    CHECK(CFC.m_eval->get_outputs_size() > 9 + 18); // PTXY, PRhoT and at least one critical point
+    TelemetrySummary summary = CFC.telemetry_summary();
+    CHECK(summary.by_type.size() == 3);
+}
+
+TEST_CASE("Test slim PRhoT evaluation against the full AbstractState", "[slim]") {
+    gen_data_options o;
+    o.names = "Ethane&n-Propane";
+    o.PTXY = false; o.PRhoT = true;
+    o.T = linspace(250, 350, 3);
+    o.p = linspace(1e5, 5e6, 3);
+    std::string data = gen_data(o);
+    std::vector<double> c = { 1.01, 0.99, 1.02, 0.98 };
+
+    CoeffFitClass full(data, false), slim(data, true);
+    full.evaluate_serial(c);
+    slim.evaluate_serial(c);
+    std::vector<double> rfull = full.errorvec(), rslim = slim.errorvec();
+    REQUIRE(rfull.size() == rslim.size());
+    for (std::size_t i = 0; i < rfull.size(); ++i) {
+        CHECK(std::abs(rfull[i] - rslim[i]) < 1e-12*(1 + std::abs(rfull[i])));
+    }
+    Eigen::MatrixXd Jfull = full.m_eval->get_Jacobian_matrix(), Jslim = slim.m_eval->get_Jacobian_matrix();
+    CHECK((Jfull - Jslim).norm() < 1e-10*(1 + Jfull.norm()));
+}
+
+TEST_CASE("Test batched PT density solver against the PT flash", "[density]") {
+    gen_data_options o;
+    o.names = "Ethane&n-Propane";
+    o.T = linspace(200, 240, 3);
+    o.x0 = linspace(0.2, 0.8, 3);
+    o.density_guesses = true;
+    std::string data = gen_data(o);
+    std::vector<double> c = { 1.01, 0.99, 1.02, 0.98 };
+
+    CoeffFitClass flash(data), batch(data);
+    flash.set_batch_PT_densities(false);
+    flash.evaluate_serial(c);
+    batch.evaluate_serial(c);
+    std::vector<double> rflash = flash.errorvec(), rbatch = batch.errorvec();
+    REQUIRE(rflash.size() == rbatch.size());
+    for (std::size_t i = 0; i < rflash.size(); ++i) {
+        CHECK(std::abs(rflash[i] - rbatch[i]) < 1e-8*(1 + std::abs(rflash[i])));
+    }
+    // Every phase either came from the batched solver or fell back to the local flash
+    std::size_t Nbatch = 0;
+    for (auto &t : batch.point_telemetry()) {
+        CHECK(t.Nflash[FLASH_BATCH_PT] + t.Nflash[FLASH_LOCAL_PT] == 2);
+        Nbatch += t.Nflash[FLASH_BATCH_PT];
+    }
+    CHECK(Nbatch > 0);
+
+    // The solver on its own: the ideal gas converges, a state with dp/drho < 0 is masked off, and so is a 
+    // state whose guess is on the liquid side of rho_split when the root is on the vapor side
+    PTDensityBatch b;
+    b.add(300, 1e5, 30);
+    b.add(300, 1e5, 50);
+    b.add(300, 1e5, 60, 45);
+    PTDensityEvaluator ideal_gas = [](const std::vector<std::size_t> &active, const std::vector<double> &rho, std::vector<double> &p, std::vector<double> &dpdrho) {
+        for (std::size_t k : active) {
+            double RT = 8.314462618*300;
+            p[k] = rho[k]*RT;
+            dpdrho[k] = (k == 1) ? -RT : RT;
+        }
+    };
+    CHECK(solve_PT_densities(b, ideal_gas) == 1);
+    CHECK(b.converged[0] == 1);
+    CHECK(std::abs(b.rho[0] - 1e5/(8.314462618*300)) < 1e-9);
+    CHECK(b.converged[1] == 0);
+    CHECK(b.converged[2] == 0);
+}
+
+TEST_CASE("Test persistent worker pool", "[pool]") {
+    WorkerPool pool(3);
+    std::vector<std::thread::id> first(3), second(3);
+    std::vector<double> busy;
+    pool.run([&first](std::size_t i) { first[i] = std::this_thread::get_id(); }, busy);
+    pool.run([&second](std::size_t i) { second[i] = std::this_thread::get_id(); }, busy);
+    REQUIRE(busy.size() == 3);
+    // Each part of the work lands on the same thread every time
+    CHECK(first == second);
+    CHECK(first[0] != first[1]);
+    CHECK_THROWS(pool.run([](std::size_t i) { if (i == 1) { throw std::runtime_error("worker 1"); } }, busy));
+
+    std::string backend = "HEOS", names = "Ethane&n-Propane";
+    std::string data = gen_JSON_data(backend, names);
+    std::vector<double> c0 = { 1,1,1,1 };
+    CoeffFitClass serial(data), parallel(data);
+    parallel.set_thread_pinning(true);
+    serial.evaluate_serial(c0);
+    for (std::size_t pass = 0; pass < 3; ++pass) {
+        parallel.evaluate_parallel(c0, 2);
+        CHECK(parallel.errorvec() == serial.errorvec());
+    }
+}
+
+TEST_CASE("Test evaluation sharded over worker processes", "[processes]") {
+    std::string backend = "HEOS", names = "Ethane&n-Propane";
+    std::string data = gen_JSON_data(backend, names);
+    std::vector<double> c0 = { 1.01, 0.99, 1.02, 0.98 };
+
+    CoeffFitClass local(data), sharded(data);
+    sharded.set_processes(2);
+    local.evaluate_serial(c0);
+    sharded.evaluate_processes(c0);
+    CHECK(sharded.errorvec() == local.errorvec());
+    Eigen::MatrixXd Jlocal = local.m_eval->get_Jacobian_matrix(), Jsharded = sharded.m_eval->get_Jacobian_matrix();
+    CHECK((Jlocal - Jsharded).norm() == 0);
+    CHECK(sharded.phase_times().busy_sec.size() == 2);
+
+    // A change to the model reaches the workers
+    local.set_binary_interaction_double(0, 1, "Fij", 0.5);
+    sharded.set_binary_interaction_double(0, 1, "Fij", 0.5);
+    local.evaluate_serial(c0);
+    sharded.evaluate_processes(c0);
+    CHECK(sharded.errorvec() == local.errorvec());
+
+    // The telemetry of the workers is added to that of this process
+    std::vector<PointTelemetry> tlocal = local.point_telemetry(), tsharded = sharded.point_telemetry();
+    REQUIRE(tlocal.size() == tsharded.size());
+    for (std::size_t i = 0; i < tlocal.size(); ++i) {
+        CHECK(tsharded[i].Nevals == tlocal[i].Nevals);
+        CHECK(tsharded[i].Nflash[FLASH_GLOBAL_PT] == tlocal[i].Nflash[FLASH_GLOBAL_PT]);
+    }
+
+    // And the optimizer can run on them
+    REQUIRE_NOTHROW(sharded.run(false, 1, c0));
+    CHECK(sharded.sum_of_squares() < 1e10);
+}
+
+TEST_CASE("Test streaming assembly of the normal equations", "[normal equations]") {
+    std::string backend = "HEOS", names = "Ethane&n-Propane";
+    std::string data = gen_JSON_data(backend, names);
+    std::vector<double> c0 = { 1.01, 0.99, 1.02, 0.98 };
+
+    CoeffFitClass CFC(data);
+    CFC.evaluate_serial(c0);
+    Eigen::MatrixXd J = CFC.m_eval->get_Jacobian_matrix();
+    Eigen::VectorXd r = CFC.m_eval->get_error_vector();
+
+    PhiFitNormalEquations ne1, ne2;
+    CFC.evaluate_normal_equations(c0, true, 3, ne1);
+    CHECK((ne1.JtJ - J.transpose()*J).norm() < 1e-10*(J.transpose()*J).norm());
+    CHECK((ne1.Jtr - J.transpose()*r).norm() < 1e-10*(1 + (J.transpose()*r).norm()));
+    CHECK(std::abs(ne1.SSE - r.squaredNorm()) < 1e-10*(1 + r.squaredNorm()));
+    CHECK(ne1.JtJ == ne1.JtJ.transpose());
+
+    // The reduction order is fixed, so repeating the pass gives the same bits
+    CFC.evaluate_normal_equations(c0, true, 3, ne2);
+    CHECK(ne1.JtJ == ne2.JtJ);
+    CHECK(ne1.Jtr == ne2.Jtr);
+
+    CoeffFitClass streaming(data);
+    streaming.m_streaming_normal_equations = true;
+    CFC.run(false, 1, c0);
+    streaming.run(false, 1, c0);
+    REQUIRE(streaming.cfinal().size() == CFC.cfinal().size());
+    for (std::size_t i = 0; i < CFC.cfinal().size(); ++i) {
+        CHECK(std::abs(streaming.cfinal()[i] - CFC.cfinal()[i]) < 1e-6);
+    }
+}
+
+TEST_CASE("Test quarantine of failing data points", "[quarantine]") {
+    QuarantinePolicy policy;
+    policy.max_failures = 2; policy.retry_every = 3; policy.retry_shift = 0.1;
+    std::vector<double> c = { 1,1,1,1 }, c_moved = { 1.5,1,1,1 };
+    PointQuarantine q;
+    q.record(policy, true, c);
+    CHECK(!q.quarantined);
+    q.record(policy, true, c);
+    CHECK(q.quarantined);
+    // Skipped until it has been skipped retry_every times, or the coefficients move
+    CHECK(q.skip(policy, c));
+    CHECK(q.skip(policy, c));
+    CHECK(q.skip(policy, c));
+    CHECK(!q.skip(policy, c));
+    q.record(policy, true, c);
+    CHECK(q.skip(policy, c));
+    CHECK(!q.skip(policy, c_moved));
+    q.record(policy, false, c_moved);
+    CHECK(!q.quarantined);
+
+    // Add a point that can never be evaluated (negative temperature) to generated data
+    std::string backend = "HEOS", names = "Ethane&n-Propane";
+    rapidjson::Document doc;
+    cpjson::JSON_string_to_rapidjson(gen_JSON_data(backend, names), doc);
+    rapidjson::Value bad(*doc["data"].Begin(), doc.GetAllocator());
+    bad["T (K)"].SetDouble(-10);
+    doc["data"].PushBack(bad, doc.GetAllocator());
+    CoeffFitClass CFC(cpjson::json2string(doc));
+    CFC.set_quarantine_policy(policy);
+    // The bad point is a PTXY point, so its two residuals are the last two outputs, and they are quarantined together
+    std::size_t ibad = CFC.m_eval->get_outputs_size() - 2;
+    CFC.evaluate_serial(c);
+    CHECK(CFC.quarantined_points().empty());
+    CFC.evaluate_serial(c);
+    REQUIRE(CFC.quarantined_points() == std::vector<std::size_t>({ ibad, ibad + 1 }));
+    CFC.evaluate_serial(c);
+    PointTelemetry t = CFC.point_telemetry().back();
+    CHECK(t.Nexceptions == 2);
+    CHECK(t.Nskipped == 1);
+    CHECK(CFC.errorvec()[ibad] != 0);
+    CHECK(CFC.errorvec()[ibad + 1] != 0);
+
+    CFC.release_quarantine();
+    CHECK(CFC.quarantined_points().empty());
+}
+
+TEST_CASE("Test dataset preparation and its cache", "[prepare]") {
+    std::string backend = "HEOS", names = "Ethane&n-Propane";
+    std::string data = gen_JSON_data(backend, names);
+
+    // The cache goes in a directory of its own, so that no stale entries are found
+    char dir[] = "/tmp/phifit-cache-XXXXXX";
+    REQUIRE(mkdtemp(dir) != nullptr);
+    PrepareOptions o;
+    o.schema_path = "";
+    o.cache_dir = dir;
+    o.Nthreads = 3;
+    std::string key = dataset_cache_key(data, o), path = std::string(dir) + "/" + key + ".json";
+    CHECK(find_prepared_dataset(data, o).empty());
+
+    std::string prepared = prepare_dataset(data, o);
+    CHECK(find_prepared_dataset(data, o) == prepared);
+    // A different reference model is a different entry
+    PrepareOptions o2 = o;
+    o2.c_ref[0] = 1.01;
+    CHECK(dataset_cache_key(data, o2) != key);
+    CHECK(find_prepared_dataset(data, o2).empty());
+
+    rapidjson::Document doc;
+    cpjson::JSON_string_to_rapidjson(prepared, doc);
+    for (rapidjson::Value::ValueIterator itr = doc["data"].Begin(); itr != doc["data"].End(); ++itr) {
+        CHECK(cpjson::get_double(*itr, "rho' (guess,mol/m3)") > cpjson::get_double(*itr, "rho'' (guess,mol/m3)"));
+    }
+
+    // Loading the raw data picks up the cached densities, so no global flashes are needed
+    CoeffFitClass CFC(data, o);
+    std::vector<double> c0 = { 1,1,1,1 };
+    CFC.evaluate_serial(c0);
+    for (auto &t : CFC.point_telemetry()) {
+        CHECK(t.Nflash[FLASH_GLOBAL_PT] == 0);
+    }
+    std::remove(path.c_str());
+    std::remove(dir);
+
+    // Validation
+    std::string schema = R"({"type": "object", "required": ["data", "about"]})";
+    CHECK_NOTHROW(validate_dataset(data, schema));
+    CHECK_THROWS(validate_dataset(R"({"data": []})", schema));
+
+    // Without validation, a malformed point is reported rather than taking down the solver threads
+    PrepareOptions unchecked;
+    unchecked.schema_path = "";
+    unchecked.Nthreads = 2;
+    CHECK_THROWS(prepare_dataset(R"json({"about": {"names": ["Ethane", "n-Propane"]}, "data": [{"type": "PTXY", "T (K)": 250, "x (molar)": [0.5, 0.5], "y (molar)": [0.5, 0.5]}]})json", unchecked));
+}
+
+TEST_CASE("Test native evolutionary optimizer", "[evolution]") {
+    std::string backend = "HEOS", names = "Ethane&n-Propane";
+    gen_JSON_data_options go;
+    go.Tmax = 220;
+    CoeffFitClass CFC(gen_JSON_data(backend, names, go));
+    CFC.setup(R"({"departure[ij]": {"n": [0.0], "d": [1.0], "t": [1.0], "ldelta": [[0.0]], "cdelta": [[0.0]], "ltau": [[0.0]], "ctau": [[0.0]]}})");
+
+    EvolutionOptions o;
+    o.layout.Nterms = 1;
+    o.layout.u_dims = { 1 };
+    for (std::size_t i = 0; i < 4; ++i) { o.genes.push_back(GeneSpec(0.9, 1.1, 0.05)); }
+    o.genes.push_back(GeneSpec(-0.1, 0.1, 0.05)); // n
+    o.genes.push_back(GeneSpec(0.25, 3, 0.5)); // t
+    o.genes.push_back(GeneSpec(1, 5, 1, true)); // d
+    o.genes.push_back(GeneSpec(1, 5, 1, true)); // ldelta
+    for (std::size_t i = 0; i < 3; ++i) { o.genes.push_back(GeneSpec(0, 0, 0)); } // cdelta, ltau, ctau held at zero
+    REQUIRE(o.layout.size() == o.genes.size());
+    o.Nindividuals = 12; o.Ngenerations = 2; o.Nhof = 5; o.seed = 3;
+
+    o.Nworkers = 1;
+    EvolutionResult serial = evolve(CFC, o);
+    o.Nworkers = 3;
+    EvolutionResult parallel = evolve(CFC, o);
+
+    REQUIRE(serial.log.size() == 3);
+    CHECK(serial.log[0].Nevals == 12);
+    REQUIRE(serial.hall_of_fame.size() == 5);
+    for (std::size_t i = 1; i < serial.hall_of_fame.size(); ++i) {
+        CHECK(serial.hall_of_fame[i - 1].fitness <= serial.hall_of_fame[i].fitness);
+    }
+    for (auto &ind : serial.population) {
+        // Integer genes stay integers
+        CHECK(ind.x[6] == std::round(ind.x[6]));
+    }
+    // The same seed gives the same evolution, however many workers evaluate it
+    for (std::size_t i = 0; i < serial.hall_of_fame.size(); ++i) {
+        CHECK(serial.hall_of_fame[i].x == parallel.hall_of_fame[i].x);
+        CHECK(serial.hall_of_fame[i].fitness == parallel.hall_of_fame[i].fitness);
+    }
+}
+
+TEST_CASE("Test fitness memo", "[memo]") {
+    std::string backend = "HEOS", names = "Ethane&n-Propane";
+    gen_JSON_data_options go;
+    go.Tmax = 220;
+    CoeffFitClass CFC(gen_JSON_data(backend, names, go));
+    CFC.setup(R"({"departure[ij]": {"n": [0.0], "d": [1.0], "t": [1.0], "ldelta": [[0.0]], "cdelta": [[0.0]], "ltau": [[0.0]], "ctau": [[0.0]]}})");
+    CFC.set_memo(2, true);
+    std::vector<double> c0 = { 1.0, 1.0, 1.0, 1.0 }, c1 = { 1.01, 1.0, 1.0, 1.0 }, c2 = { 1.02, 1.0, 1.0, 1.0 };
+
+    double SSE0 = CFC.evaluate_sum_of_squares(c0);
+    CHECK(CFC.memo_stats().misses == 1);
+    CHECK(CFC.evaluate_sum_of_squares(c0) == SSE0);
+    CHECK(CFC.memo_stats().hits == 1);
+    CHECK(CFC.memoized_residuals(c0) == CFC.errorvec());
+
+    // A different Fij is a different candidate
+    CFC.set_binary_interaction_double(0, 1, "Fij", 0.5);
+    CFC.evaluate_sum_of_squares(c0);
+    CHECK(CFC.memo_stats().misses == 2);
+    CFC.set_binary_interaction_double(0, 1, "Fij", 1.0);
+
+    // So is a different quarantine policy
+    QuarantinePolicy q;
+    q.max_failures = 3;
+    CFC.set_quarantine_policy(q);
+    CFC.evaluate_sum_of_squares(c0);
+    CHECK(CFC.memo_stats().misses == 3);
+    CFC.set_quarantine_policy(QuarantinePolicy());
+
+    // A clone starts with an empty memo of its own
+    std::shared_ptr<CoeffFitClass> other = CFC.clone();
+    CHECK(other->memo_stats().size == 0);
+    CHECK(other->memo_stats().capacity == 2);
+    other->evaluate_sum_of_squares(c0);
+    CHECK(CFC.memo_stats().misses == 3);
+
+    // With room for two entries, the least recently used one is dropped
+    CFC.evaluate_sum_of_squares(c1);
+    CFC.evaluate_sum_of_squares(c2);
+    FitnessMemo::Stats stats = CFC.memo_stats();
+    CHECK(stats.size == 2);
+    CHECK(CFC.memoized_residuals(c0).empty());
+    CHECK(CFC.memoized_residuals(c2).size() == CFC.errorvec().size());
+    CHECK(stats.hit_rate() == Approx(1.0/6));
+}
+
+TEST_CASE("Test per-iteration optimizer trace", "[trace]") {
+    std::string backend = "HEOS", names = "Ethane&n-Propane";
+    CoeffFitClass CFC(gen_JSON_data(backend, names));
+    std::vector<double> c0 = { 1,1,1,1 };
+    REQUIRE_NOTHROW(CFC.run(false, 1, c0));
+
+    const std::vector<PhiFitTraceEntry> &trace = CFC.trace();
+    REQUIRE(trace.size() == CFC.m_LM_state.iter + 1);
+    CHECK(trace[0].start);
+    CHECK(trace[0].residual_sec > 0);
+    double SSE = trace[0].SSE;
+    for (std::size_t i = 1; i < trace.size(); ++i) {
+        CHECK(trace[i].iter == i);
+        CHECK(!trace[i].start);
+        CHECK(trace[i].step_norm > 0);
+        if (trace[i].accepted) {
+            // Accepted steps never increase the sum of squares
+            CHECK(trace[i].SSE <= SSE);
+            SSE = trace[i].SSE;
+        }
+    }
+    CHECK(SSE == CFC.m_LM_state.SSE);
+
+    rapidjson::Document doc;
+    cpjson::JSON_string_to_rapidjson(CFC.dump_outputs_to_JSON(), doc);
+    REQUIRE(doc.HasMember("trace"));
+    CHECK(doc["trace"].Size() == trace.size());
+}
+
+TEST_CASE("Test asynchronous fits sharing a thread budget", "[async]") {
+    std::string backend = "HEOS", names = "Ethane&n-Propane";
+    std::string data = gen_JSON_data(backend, names);
+    std::vector<double> c0 = { 1,1,1,1 };
+    std::shared_ptr<ThreadBudget> budget(new ThreadBudget(1));
+
+    // Two fits that can only run one at a time
+    CoeffFitClass A(data), B(data);
+    std::shared_ptr<FitHandle> ha = A.run_async(false, 1, c0, budget), hb = B.run_async(false, 1, c0, budget);
+    REQUIRE(ha->wait());
+    REQUIRE(hb->wait());
+    for (auto h : { ha, hb }) {
+        CHECK(h->done());
+        CHECK(h->progress().status != FIT_FAILED);
+        CHECK(h->progress().Nthreads == 1);
+    }
+    CHECK(ha->best_coefficients() == A.cfinal());
+    CHECK(ha->progress().SSE == Approx(hb->progress().SSE));
+
+    // A fit cancelled while it waits for its threads never starts
+    CoeffFitClass C(data);
+    std::shared_ptr<FitHandle> hc;
+    {
+        ThreadBudgetLease hold(*budget, 1);
+        hc = C.run_async(false, 1, c0, budget);
+        CHECK(!hc->wait(0.01));
+        CHECK(hc->progress().status == FIT_QUEUED);
+        // Only one fit at a time on an instance
+        CHECK_THROWS(C.run_async(false, 1, c0, budget));
+        // The fit stops waiting as soon as it is cancelled, while the threads are still held
+        hc->cancel();
+        REQUIRE(hc->wait(5));
+        CHECK(hc->progress().status == FIT_CANCELLED);
+        CHECK(hc->progress().Nthreads == 0);
+
+        // Destroying the fitter cancels its queued fit and waits for it
+        std::shared_ptr<FitHandle> hd;
+        {
+            CoeffFitClass D(data);
+            hd = D.run_async(false, 1, c0, budget);
+        }
+        CHECK(hd->done());
+        CHECK(hd->progress().status == FIT_CANCELLED);
+    }
+    CHECK(hc->best_coefficients() == c0);
+}
+
+TEST_CASE("Test deviation statistics by type and source", "[validation]") {
+    std::vector<double> dev = { 0.1, -0.3, 10000, 0.2 };
+    std::vector<std::string> types = { "PTXY", "PTXY", "PTXY", "PRhoT" }, sources = { "a", "b", "b", "a" };
+    std::vector<bool> failed = { false, false, true, false };
+    DeviationSummary s = summarize_deviations(dev, types, sources, failed);
+    CHECK(s.overall.N == 3);
+    CHECK(s.overall.Nfailed == 1);
+    CHECK(s.overall.AAD == Approx(0.2));
+    CHECK(s.overall.bias == Approx(0.0).margin(1e-15));
+    CHECK(s.overall.max_abs == Approx(0.3));
+    REQUIRE(s.by_type.size() == 2);
+    CHECK(s.by_type[0].key == "PTXY");
+    CHECK(s.by_type[0].RMS == Approx(std::sqrt(0.05)));
+    REQUIRE(s.by_source.size() == 2);
+    CHECK(s.by_source[1].key == "b");
+    CHECK(s.by_source[1].N == 1);
+    CHECK(s.by_source[1].Nfailed == 1);
+
+    // A fitted model: every point is evaluated, and the isotherms are at the temperatures of the data
+    std::string backend = "HEOS", names = "Ethane&n-Propane";
+    CoeffFitClass CFC(gen_JSON_data(backend, names));
+    std::vector<double> c0 = { 1,1,1,1 };
+    REQUIRE_NOTHROW(CFC.run(false, 1, c0));
+    ValidationOptions o;
+    o.Nthreads = 2; o.isotherms = true; o.Nx = 5;
+    ValidationReport report = CFC.validate(CFC.cfinal(), o);
+    CHECK(report.deviations.overall.N + report.deviations.overall.Nfailed == CFC.errorvec().size());
+    CHECK(report.deviations.overall.RMS*report.deviations.overall.RMS*report.deviations.overall.N == Approx(CFC.sum_of_squares()));
+    REQUIRE(report.isotherms.size() == 3);
+    CHECK(report.isotherms[0].T == Approx(200));
+    CHECK(report.isotherms[0].p.size() == 5);
+    rapidjson::Document doc;
+    cpjson::JSON_string_to_rapidjson(validation_to_JSON(report), doc);
+    CHECK(doc["by source"]["rows"].Size() == report.deviations.by_source.size());
+
+    // A model that cannot be built is reported to the caller
+    ModelStateFactory broken = []() -> std::shared_ptr<CoolProp::AbstractState> { throw CoolProp::ValueError("no model"); };
+    CHECK_THROWS(evaluate_isotherms(broken, { 200, 210 }, o));
+}
+
+TEST_CASE("Test k-fold cross-validation", "[cross-validation]") {
+    // Each source is spread over the folds, and the folds differ in size by at most one
+    std::vector<std::string> sources = { "a", "a", "a", "b", "b", "b", "b", "c" };
+    std::vector<std::size_t> folds = assign_folds(sources, 3, 1);
+    REQUIRE(folds.size() == sources.size());
+    std::vector<std::size_t> sizes(3, 0);
+    for (auto f : folds) { sizes[f]++; }
+    CHECK(*std::max_element(sizes.begin(), sizes.end()) - *std::min_element(sizes.begin(), sizes.end()) <= 1);
+    std::vector<bool> seen(3, false);
+    for (std::size_t i = 0; i < 3; ++i) { seen[folds[i]] = true; }
+    CHECK(seen == std::vector<bool>(3, true));
+    CHECK(assign_folds(sources, 3, 1) == folds);
+    CHECK_THROWS(assign_folds(sources, 1, 1));
+
+    std::string backend = "HEOS", names = "Ethane&n-Propane";
+    CoeffFitClass CFC(gen_JSON_data(backend, names));
+    CrossValidationOptions o;
+    o.k = 3; o.c0 = { 1,1,1,1 };
+    CrossValidationResult result = CFC.cross_validate(o);
+    REQUIRE(result.folds.size() == 3);
+    // The folds are fitted by evaluators of their own, so the outputs are counted from the assignment
+    const std::size_t N = CFC.point_ids().size();
+    REQUIRE(result.assignment.size() == N);
+    std::size_t Nheld_out = 0;
+    for (auto &f : result.folds) {
+        CHECK(f.Ntrain + f.Nheld_out == N);
+        CHECK(f.SSE_train >= 0);
+        CHECK(f.SSE_held_out >= 0);
+        Nheld_out += f.Nheld_out;
+    }
+    // Every point is held out exactly once
+    CHECK(Nheld_out == N);
+
+    // Splitting the points of each fold over several threads, each with an AbstractState of its own, gives the same fits
+    o.Nthreads = 2;
+    CrossValidationResult threaded = CFC.cross_validate(o);
+    REQUIRE(threaded.folds.size() == 3);
+    for (std::size_t f = 0; f < 3; ++f) {
+        CHECK(threaded.folds[f].SSE_held_out == Approx(result.folds[f].SSE_held_out).epsilon(1e-6));
+    }
+}
+
+TEST_CASE("Test adding, removing and disabling data points", "[mutation]") {
+    std::string backend = "HEOS", names = "Ethane&n-Propane";
+    gen_JSON_data_options o;
+    o.Tmin = 200; o.Tmax = 220;
+    CoeffFitClass CFC(gen_JSON_data(backend, names, o));
+    std::vector<double> c0 = { 1,1,1,1 };
+    std::vector<std::size_t> ids0 = CFC.point_ids();
+    REQUIRE(ids0.size() > 4);
+    CFC.evaluate_parallel(c0, 1);
+    std::vector<double> err0 = CFC.errorvec();
+
+    // The new points get new identifiers, and the old points keep their residuals
+    o.Tmin = 230; o.Tmax = 240;
+    std::vector<std::size_t> added = CFC.add_points(gen_JSON_data(backend, names, o));
+    REQUIRE(!added.empty());
+    CHECK(added.front() == ids0.back() + 1);
+    CFC.evaluate_parallel(c0, 1);
+    std::vector<double> err1 = CFC.errorvec();
+    REQUIRE(err1.size() == err0.size() + added.size());
+    for (std::size_t i = 0; i < err0.size(); ++i) { CHECK(err1[i] == err0[i]); }
+
+    // A disabled point drops out of the residuals and comes back in the same place
+    std::vector<std::size_t> ids1 = CFC.point_ids();
+    CFC.set_point_enabled(ids0[1], false);
+    CHECK(CFC.point_ids().size() == err1.size() - std::count(ids1.begin(), ids1.end(), ids0[1]));
+    CHECK(CFC.disabled_point_ids() == std::vector<std::size_t>(1, ids0[1]));
+    CFC.set_point_enabled(ids0[1], true);
+    CHECK(CFC.point_ids() == ids1);
+    CFC.evaluate_parallel(c0, 1);
+    CHECK(CFC.errorvec() == err1);
+
+    // Removing the added points restores the original dataset
+    CFC.remove_points(added);
+    CHECK(CFC.point_ids() == ids0);
+    CFC.evaluate_parallel(c0, 1);
+    CHECK(CFC.errorvec() == err0);
+    CHECK_THROWS(CFC.remove_points(added));
+}
+
+TEST_CASE("Test one residual per component for PTXY points", "[PTXY components]") {
+    std::string backend = "HEOS", names = "Ethane&n-Propane";
+    CoeffFitClass CFC(gen_JSON_data(backend, names));
+    std::vector<double> c0 = { 1.01, 0.99, 1.01, 0.99 };
+    PhiFitNormalEquations ne;
+    CFC.evaluate_normal_equations(c0, false, 1, ne);
+
+    // The two residuals of a point follow each other and share its identifier
+    std::vector<std::size_t> ids = CFC.point_ids();
+    REQUIRE(ids.size() == CFC.errorvec().size());
+    REQUIRE(ids.size() % 2 == 0);
+    for (std::size_t i = 0; i < ids.size(); i += 2) { CHECK(ids[i] == ids[i + 1]); }
+
+    // The gradient J^T*r of 1/2*SSE, including the rows of the second component, agrees with finite differences
+    double h = 1e-6, scale = ne.Jtr.lpNorm<Eigen::Infinity>();
+    for (std::size_t k = 0; k < c0.size(); ++k) {
+        std::vector<double> cp = c0, cm = c0;
+        cp[k] += h; cm[k] -= h;
+        CFC.evaluate_serial(cp); double SSEp = CFC.sum_of_squares();
+        CFC.evaluate_serial(cm); double SSEm = CFC.sum_of_squares();
+        CHECK(std::abs((SSEp - SSEm)/(4*h) - ne.Jtr[k]) < 1e-3*scale);
+    }
+}
+
+TEST_CASE("Test coarse-to-fine fitting schedule", "[schedule]") {
+    // The stages are nested, have the right sizes, and each has its share of every source
+    std::vector<std::string> sources = { "a", "a", "a", "a", "b", "b", "b", "b", "c", "c", "c", "c" };
+    std::vector<std::size_t> first = assign_stages(sources, { 0.25, 0.5, 1 }, 3);
+    REQUIRE(first.size() == sources.size());
+    std::vector<std::size_t> sizes(3, 0);
+    for (auto s : first) { sizes[s]++; }
+    CHECK(sizes == std::vector<std::size_t>({ 3, 3, 6 }));
+    for (std::size_t i = 0; i < sources.size(); i += 4) {
+        CHECK(std::count(first.begin() + i, first.begin() + i + 4, std::size_t(0)) == 1);
+    }
+    CHECK(assign_stages(sources, { 0.25, 0.5, 1 }, 3) == first);
+    CHECK_THROWS(assign_stages(sources, { 0.5, 0.25, 1 }, 3));
+    CHECK_THROWS(assign_stages(sources, { 0.25, 0.5 }, 3));
+
+    std::string backend = "HEOS", names = "Ethane&n-Propane";
+    CoeffFitClass CFC(gen_JSON_data(backend, names));
+    std::vector<std::size_t> ids = CFC.point_ids();
+    FitScheduleOptions o;
+    o.stages = { FitStage(0.5, 1e-6, 1e-5, 10), FitStage(1) };
+    FitScheduleResult result = CFC.run_schedule(false, 1, { 1,1,1,1 }, o);
+    REQUIRE(result.stages.size() == 2);
+    CHECK(result.stages[0].Npoints < result.stages[1].Npoints);
+    CHECK(result.stages[1].Nresiduals == ids.size());
+    CHECK(result.stages[1].c == CFC.cfinal());
+    // All the points are back at the end
+    CHECK(CFC.point_ids() == ids);
+
+    // The generated data carry no density guesses, so the first stage needs global flashes; the points it fitted start 
+    // the flashes of the next stage from the densities it found, leaving only the few new points to flash globally
+    CoeffFitClass CFC2(gen_JSON_data(backend, names));
+    o.stages = { FitStage(0.95, 1e-6, 1e-5, 5), FitStage(1, 1e-6, 1e-5, 5) };
+    FitScheduleResult warm = CFC2.run_schedule(false, 1, { 1,1,1,1 }, o);
+    REQUIRE(warm.stages.size() == 2);
+    CHECK(warm.stages[0].Nflash[FLASH_GLOBAL_PT] > 0);
+    CHECK(warm.stages[1].Nflash[FLASH_GLOBAL_PT] < warm.stages[0].Nflash[FLASH_GLOBAL_PT]);
+}
+
+TEST_CASE("Test adaptive density solver tolerance", "[tolerance]") {
+    PTDensitySolverOptions full;
+    AdaptiveToleranceOptions o;
+    // Opt-in: off unless asked for
+    CHECK(!o.enabled);
+    CHECK(o.options(std::numeric_limits<double>::infinity(), full).rtol == full.rtol);
+    o.enabled = true;
+    // No step yet: as loose as allowed, with the smallest budget
+    PTDensitySolverOptions loose = o.options(std::numeric_limits<double>::infinity(), full);
+    CHECK(loose.rtol == o.rtol_loose);
+    CHECK(loose.Nmax == o.Nmax_loose);
+    // The tolerance follows the progress, rounded down to a whole decade
+    PTDensitySolverOptions mid = o.options(3e-7, full);
+    CHECK(std::abs(mid.rtol/1e-9 - 1) < 1e-12);
+    CHECK(mid.Nmax > loose.Nmax);
+    CHECK(mid.Nmax < full.Nmax);
+    // Full precision when there is no progress left to make, or when turned off
+    CHECK(o.options(0, full).rtol == full.rtol);
+    CHECK(o.options(0, full).Nmax == full.Nmax);
+    o.enabled = false;
+    CHECK(o.options(1, full).rtol == full.rtol);
+
+    // A fit leaves the solver at full precision
+    std::string backend = "HEOS", names = "Ethane&n-Propane";
+    CoeffFitClass CFC(gen_JSON_data(backend, names));
+    o.enabled = true;
+    CFC.set_adaptive_tolerance(o);
+    CFC.run(false, 1, { 1,1,1,1 });
+    CHECK(CFC.solver_options().rtol == full.rtol);
+}
+
+/// Residuals of y = a*exp(b*x) against exact data with a = 2, b = -0.5
+class ExponentialResiduals : public PhiFitResidualProvider {
+public:
+    std::size_t Nevals;
+    ExponentialResiduals() : Nevals(0) {};
+    void evaluate(const std::vector<double> &c, PhiFitNormalEquations &ne) {
+        Nevals++;
+        ne.reset(2);
+        for (std::size_t i = 0; i < 20; ++i) {
+            double x = 0.2*i, e = std::exp(c[1]*x);
+            double J[2] = { e, c[0]*x*e };
+            ne.add_row(J, c[0]*e - 2*std::exp(-0.5*x));
+        }
+        ne.symmetrize();
+    }
+};
+
+TEST_CASE("Test several damping candidates per iteration", "[damping candidates]") {
+    // The steps from one eigendecomposition match those from solving each damped system
+    ExponentialResiduals provider;
+    PhiFitNormalEquations ne;
+    provider.evaluate({ 1, 0.1 }, ne);
+    std::vector<Eigen::VectorXd> hs = provider.solve_candidates(ne, { 1e-3, 1, 100 });
+    CHECK((hs[0] - provider.solve(ne, 1e-3)).norm() < 1e-8*hs[0].norm());
+    CHECK((hs[2] - provider.solve(ne, 100)).norm() < 1e-8*hs[2].norm());
+
+    PhiFitLMOptions opts;
+    opts.c0 = { 1, 0.1 };
+    PhiFitLMState single, several;
+    PhiFitLevenbergMarquardt(provider, opts, single);
+    opts.mu_factors = { 0.1, 1, 10 };
+    PhiFitLevenbergMarquardt(provider, opts, several);
+    CHECK(several.converged);
+    CHECK(std::abs(several.c[0] - 2) < 1e-6);
+    CHECK(std::abs(several.c[1] + 0.5) < 1e-6);
+    CHECK(several.iter <= single.iter);
+
+    // With the fitter, the candidates are evaluated by replicas
+    std::string backend = "HEOS", names = "Ethane&n-Propane";
+    CoeffFitClass CFC(gen_JSON_data(backend, names));
+    CFC.set_damping_candidates({ 0.1, 1, 10 });
+    CFC.run(true, 3, { 1,1,1,1 });
+    CHECK(std::isfinite(CFC.sum_of_squares()));
+    CHECK(CFC.errorvec().size() == CFC.point_ids().size());
+    CHECK_THROWS(CFC.set_damping_candidates({ 0 }));
+
+    // Without threading, the fitter evaluates the candidates itself, one after the other
+    CoeffFitClass serial(gen_JSON_data(backend, names));
+    serial.set_damping_candidates({ 0.1, 1, 10 });
+    serial.run(false, 1, { 1,1,1,1 });
+    CHECK(std::isfinite(serial.m_LM_state.SSE));
+    CHECK(serial.m_LM_state.iter > 0);
+}